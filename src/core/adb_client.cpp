@@ -0,0 +1,533 @@
+#include "adb_client.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/error.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace mirrolink {
+
+namespace {
+
+// Largest DATA chunk the sync protocol accepts
+constexpr size_t kSyncChunk = 64 * 1024;
+
+void appendLittleEndian(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+uint32_t readLittleEndian(const uint8_t* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+std::string syncHeader(const char id[4], uint32_t length) {
+    std::string header(id, 4);
+    appendLittleEndian(header, length);
+    return header;
+}
+
+void setTimeouts(int sockfd, int milliseconds) {
+    struct timeval timeout{};
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+std::string socketError(const char* what) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return std::string(what) + ": timed out";
+    }
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+AdbStream::~AdbStream() {
+    close();
+}
+
+AdbStream::AdbStream(AdbStream&& other) noexcept : sockfd(other.sockfd) {
+    other.sockfd = -1;
+}
+
+AdbStream& AdbStream::operator=(AdbStream&& other) noexcept {
+    if (this != &other) {
+        close();
+        sockfd = other.sockfd;
+        other.sockfd = -1;
+    }
+    return *this;
+}
+
+bool AdbStream::writeAll(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(sockfd, bytes + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool AdbStream::readExact(void* data, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = ::recv(sockfd, bytes + received, size - received, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) {
+                errno = ECONNRESET;
+            }
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool AdbStream::readToEnd(std::string& out) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = ::recv(sockfd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        out.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+void AdbStream::close() {
+    if (sockfd >= 0) {
+        ::close(sockfd);
+        sockfd = -1;
+    }
+}
+
+class AdbClient::Impl {
+public:
+    explicit Impl(uint16_t port) : port(port) {}
+
+    ~Impl() {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        if (syncStream.isOpen()) {
+            const std::string quit = syncHeader("QUIT", 0);
+            syncStream.writeAll(quit.data(), quit.size());
+        }
+    }
+
+    void setSerial(const std::string& newSerial) {
+        {
+            std::lock_guard<std::mutex> lock(serialMutex);
+            if (newSerial == serial) {
+                return;
+            }
+            serial = newSerial;
+        }
+        // The kept sync connection belongs to the old device
+        std::lock_guard<std::mutex> lock(syncMutex);
+        syncStream.close();
+    }
+
+    std::string getSerial() const {
+        std::lock_guard<std::mutex> lock(serialMutex);
+        return serial;
+    }
+
+    void setTimeout(int milliseconds) {
+        timeoutMs = milliseconds;
+    }
+
+    AdbResult<int> version() {
+        AdbResult<int> result;
+        AdbStream stream = connectServer(result);
+        std::string reply;
+        if (stream.isOpen() && request(stream, "host:version", result) && readString(stream, reply, result)) {
+            result.value = static_cast<int>(std::strtol(reply.c_str(), nullptr, 16));
+        }
+        return result;
+    }
+
+    AdbResult<std::vector<AdbDevice>> devices() {
+        AdbResult<std::vector<AdbDevice>> result;
+        AdbStream stream = connectServer(result);
+        std::string reply;
+        if (!stream.isOpen() || !request(stream, "host:devices", result) || !readString(stream, reply, result)) {
+            return result;
+        }
+
+        // One "serial<TAB>state" line per device
+        std::istringstream lines(reply);
+        std::string line;
+        while (std::getline(lines, line)) {
+            const size_t tab = line.find('\t');
+            if (tab != std::string::npos) {
+                result.value.push_back({line.substr(0, tab), line.substr(tab + 1)});
+            }
+        }
+        return result;
+    }
+
+    AdbResult<std::string> shell(const std::string& command) {
+        AdbResult<std::string> result;
+        AdbStream stream = openService("shell:" + command, result);
+        if (stream.isOpen() && !stream.readToEnd(result.value)) {
+            result.error = socketError("Reading shell output failed");
+        }
+        return result;
+    }
+
+    AdbResult<AdbStream> openShell(const std::string& command) {
+        AdbResult<AdbStream> result;
+        result.value = openService("shell:" + command, result);
+        if (result.value.isOpen()) {
+            // Runs for as long as the caller keeps it
+            setTimeouts(result.value.fd(), 0);
+        }
+        return result;
+    }
+
+    AdbStatus forward(const std::string& local, const std::string& remote) {
+        return hostForward("forward:" + local + ";" + remote);
+    }
+
+    AdbStatus removeForward(const std::string& local) {
+        return hostForward("killforward:" + local);
+    }
+
+    AdbStatus push(const std::vector<uint8_t>& data, const std::string& remotePath, uint32_t mode) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        AdbStatus status;
+        const bool reused = syncStream.isOpen();
+        if (sendFile(data, remotePath, mode, status) || !reused || !staleConnection) {
+            return status;
+        }
+        // The kept connection died, e.g. with the device; retry once on a
+        // fresh one
+        status = AdbStatus();
+        sendFile(data, remotePath, mode, status);
+        return status;
+    }
+
+private:
+    AdbStream connectServer(AdbStatus& status) {
+        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sockfd < 0) {
+            status.error = socketError("Failed to create socket");
+            return AdbStream();
+        }
+        AdbStream stream(sockfd);
+        if (timeoutMs > 0) {
+            setTimeouts(sockfd, timeoutMs);
+        }
+
+        struct sockaddr_in serverAddr{};
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(port);
+        serverAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(sockfd, reinterpret_cast<struct sockaddr*>(&serverAddr), sizeof(serverAddr)) < 0) {
+            if (errno == ECONNREFUSED && startServer()) {
+                return connectServer(status);
+            }
+            status.error = socketError("Cannot reach the adb server");
+            return AdbStream();
+        }
+        return stream;
+    }
+
+    // Like the adb binary, start the server if nobody is listening. Only
+    // tried once, and only for the standard port.
+    bool startServer() {
+        if (port != kDefaultPort || serverStartAttempted.exchange(true)) {
+            return false;
+        }
+        utils::Logger::getInstance().info("adb server not running, starting it");
+        return std::system("adb start-server > /dev/null 2>&1") == 0;
+    }
+
+    bool request(AdbStream& stream, const std::string& service, AdbStatus& status) {
+        const std::string message = encodeRequest(service);
+        if (!stream.writeAll(message.data(), message.size())) {
+            status.error = socketError("Sending request failed");
+            return false;
+        }
+        return readStatus(stream, status);
+    }
+
+    bool readStatus(AdbStream& stream, AdbStatus& status) {
+        char reply[4];
+        if (!stream.readExact(reply, sizeof(reply))) {
+            status.error = socketError("No reply from the adb server");
+            return false;
+        }
+        if (std::memcmp(reply, "OKAY", 4) == 0) {
+            return true;
+        }
+        if (std::memcmp(reply, "FAIL", 4) == 0) {
+            std::string message;
+            status.error = readString(stream, message, status) ? message : status.error;
+            if (status.error.empty()) {
+                status.error = "adb request failed";
+            }
+            return false;
+        }
+        status.error = "Unexpected reply from the adb server: " + std::string(reply, 4);
+        return false;
+    }
+
+    // 4 hex digits of length, then the payload
+    bool readString(AdbStream& stream, std::string& out, AdbStatus& status) {
+        char lengthHex[5] = {};
+        if (!stream.readExact(lengthHex, 4)) {
+            status.error = socketError("Truncated reply");
+            return false;
+        }
+        char* end = nullptr;
+        const long length = std::strtol(lengthHex, &end, 16);
+        if (end != lengthHex + 4 || length < 0) {
+            status.error = "Malformed reply length";
+            return false;
+        }
+        out.resize(static_cast<size_t>(length));
+        if (length > 0 && !stream.readExact(&out[0], out.size())) {
+            status.error = socketError("Truncated reply");
+            return false;
+        }
+        return true;
+    }
+
+    // host:transport selects the device, then the service takes over the
+    // connection
+    AdbStream openService(const std::string& service, AdbStatus& status) {
+        AdbStream stream = connectServer(status);
+        if (!stream.isOpen()) {
+            return stream;
+        }
+        const std::string device = getSerial();
+        const std::string transport = device.empty() ? "host:transport-any" : "host:transport:" + device;
+        if (!request(stream, transport, status) || !request(stream, service, status)) {
+            return AdbStream();
+        }
+        return stream;
+    }
+
+    // The server answers forward requests twice: once for the device, once
+    // for the forward itself
+    AdbStatus hostForward(const std::string& command) {
+        AdbStatus status;
+        AdbStream stream = connectServer(status);
+        if (!stream.isOpen()) {
+            return status;
+        }
+        const std::string device = getSerial();
+        const std::string service = device.empty() ? "host:" + command
+                                                   : "host-serial:" + device + ":" + command;
+        if (request(stream, service, status)) {
+            readStatus(stream, status);
+        }
+        return status;
+    }
+
+    bool sendFile(const std::vector<uint8_t>& data, const std::string& remotePath,
+                  uint32_t mode, AdbStatus& status) {
+        staleConnection = false;
+        if (!syncStream.isOpen()) {
+            syncStream = openService("sync:", status);
+            if (!syncStream.isOpen()) {
+                return false;
+            }
+        }
+
+        const std::string target = remotePath + "," + std::to_string(S_IFREG | (mode & 07777));
+        std::string message = syncHeader("SEND", static_cast<uint32_t>(target.size())) + target;
+        bool sent = syncStream.writeAll(message.data(), message.size());
+        for (size_t offset = 0; sent && offset < data.size(); offset += kSyncChunk) {
+            const size_t chunk = std::min(kSyncChunk, data.size() - offset);
+            const std::string header = syncHeader("DATA", static_cast<uint32_t>(chunk));
+            sent = syncStream.writeAll(header.data(), header.size()) &&
+                   syncStream.writeAll(data.data() + offset, chunk);
+        }
+        if (sent) {
+            const std::string done = syncHeader("DONE", static_cast<uint32_t>(std::time(nullptr)));
+            sent = syncStream.writeAll(done.data(), done.size());
+        }
+
+        uint8_t reply[8];
+        if (!sent || !syncStream.readExact(reply, sizeof(reply))) {
+            status.error = socketError("Sync connection failed");
+            staleConnection = true;
+            syncStream.close();
+            return false;
+        }
+        if (std::memcmp(reply, "OKAY", 4) == 0) {
+            return true;
+        }
+
+        const uint32_t length = readLittleEndian(reply + 4);
+        std::string failure(length, '\0');
+        if (std::memcmp(reply, "FAIL", 4) == 0 && length > 0 && length < 65536 &&
+            syncStream.readExact(&failure[0], length)) {
+            status.error = "Push to " + remotePath + " failed: " + failure;
+        } else {
+            status.error = "Push to " + remotePath + " failed";
+        }
+        // The device ends the sync service after a failure
+        syncStream.close();
+        return false;
+    }
+
+    const uint16_t port;
+    std::atomic<int> timeoutMs{10000};
+    std::atomic<bool> serverStartAttempted{false};
+
+    mutable std::mutex serialMutex;
+    std::string serial;
+
+    // Kept open between pushes
+    std::mutex syncMutex;
+    AdbStream syncStream;
+    bool staleConnection = false;
+};
+
+AdbClient::AdbClient(uint16_t port) : pimpl(std::make_unique<Impl>(port)) {}
+
+AdbClient::~AdbClient() = default;
+
+void AdbClient::setSerial(const std::string& serial) {
+    pimpl->setSerial(serial);
+}
+
+std::string AdbClient::getSerial() const {
+    return pimpl->getSerial();
+}
+
+void AdbClient::setTimeout(int milliseconds) {
+    pimpl->setTimeout(milliseconds);
+}
+
+AdbResult<int> AdbClient::version() {
+    return pimpl->version();
+}
+
+AdbResult<std::vector<AdbDevice>> AdbClient::devices() {
+    return pimpl->devices();
+}
+
+AdbResult<std::string> AdbClient::shell(const std::string& command) {
+    return pimpl->shell(command);
+}
+
+AdbResult<AdbStream> AdbClient::openShell(const std::string& command) {
+    return pimpl->openShell(command);
+}
+
+AdbStatus AdbClient::forward(const std::string& local, const std::string& remote) {
+    return pimpl->forward(local, remote);
+}
+
+AdbStatus AdbClient::removeForward(const std::string& local) {
+    return pimpl->removeForward(local);
+}
+
+AdbStatus AdbClient::push(const std::string& localPath, const std::string& remotePath, uint32_t mode) {
+    std::ifstream file(localPath, std::ios::binary);
+    if (!file) {
+        AdbStatus status;
+        status.error = "Cannot open " + localPath;
+        return status;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return pimpl->push(data, remotePath, mode);
+}
+
+AdbStatus AdbClient::push(const std::vector<uint8_t>& data, const std::string& remotePath, uint32_t mode) {
+    return pimpl->push(data, remotePath, mode);
+}
+
+std::string AdbClient::encodeRequest(const std::string& service) {
+    char length[5];
+    std::snprintf(length, sizeof(length), "%04zx", service.size() & 0xFFFF);
+    return std::string(length, 4) + service;
+}
+
+AdbClient& AdbCommand::client() {
+    static AdbClient shared;
+    return shared;
+}
+
+std::string AdbCommand::execute(const std::string& command, bool checkResult) {
+    const size_t split = command.find(' ');
+    const std::string verb = command.substr(0, split);
+    std::string args = split == std::string::npos ? std::string() : command.substr(split + 1);
+    args.erase(0, args.find_first_not_of(' '));
+
+    AdbClient& adb = client();
+    std::string output;
+    AdbStatus status;
+    if (verb == "shell") {
+        AdbResult<std::string> result = adb.shell(args);
+        status = result;
+        output = std::move(result.value);
+    } else if (verb == "devices") {
+        AdbResult<std::vector<AdbDevice>> result = adb.devices();
+        status = result;
+        output = "List of devices attached\n";
+        for (const AdbDevice& device : result.value) {
+            output += device.serial + "\t" + device.state + "\n";
+        }
+    } else if (verb == "version") {
+        AdbResult<int> result = adb.version();
+        status = result;
+        output = "Android Debug Bridge version 1.0." + std::to_string(result.value) + "\n";
+    } else if (verb == "forward") {
+        std::istringstream words(args);
+        std::string first;
+        std::string second;
+        words >> first >> second;
+        status = first == "--remove" ? adb.removeForward(second) : adb.forward(first, second);
+    } else {
+        throw utils::Error("Unsupported ADB command: " + command);
+    }
+
+    if (!status) {
+        throw utils::ConnectionError("ADB command failed: " + command + ": " + status.error);
+    }
+    if (checkResult && output.find("error") != std::string::npos) {
+        throw utils::Error("ADB command failed: " + output);
+    }
+    return output;
+}
+
+} // namespace mirrolink
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mirrolink {
+
+// Outcome of a request to the adb server; error holds its FAIL message or
+// what went wrong on the socket
+struct AdbStatus {
+    std::string error;
+
+    bool ok() const { return error.empty(); }
+    explicit operator bool() const { return ok(); }
+};
+
+template <typename T>
+struct AdbResult : AdbStatus {
+    T value{};
+};
+
+struct AdbDevice {
+    std::string serial;
+    std::string state;  // "device", "unauthorized", "offline", ...
+};
+
+// Connection to a service on the device, e.g. a running shell command.
+// Closing it ends the service.
+class AdbStream {
+public:
+    AdbStream() = default;
+    explicit AdbStream(int sockfd) : sockfd(sockfd) {}
+    ~AdbStream();
+
+    AdbStream(AdbStream&& other) noexcept;
+    AdbStream& operator=(AdbStream&& other) noexcept;
+    AdbStream(const AdbStream&) = delete;
+    AdbStream& operator=(const AdbStream&) = delete;
+
+    bool isOpen() const { return sockfd >= 0; }
+    int fd() const { return sockfd; }
+
+    bool writeAll(const void* data, size_t size);
+    // Read exactly size bytes; false on error or end of stream
+    bool readExact(void* data, size_t size);
+    // Read until the service closes the stream
+    bool readToEnd(std::string& out);
+
+    void close();
+
+private:
+    int sockfd = -1;
+};
+
+// Client for the adb host protocol, talking to the adb server on
+// localhost:5037 directly instead of running the adb binary for every
+// command. Requests are a 4-digit hex length and the service name; the
+// server answers OKAY or FAIL with a message. Each device service takes
+// over its connection, so only the sync connection used for pushes is
+// kept open and reused. All methods are safe to call from any thread.
+class AdbClient {
+public:
+    static constexpr uint16_t kDefaultPort = 5037;
+
+    explicit AdbClient(uint16_t port = kDefaultPort);
+    ~AdbClient();
+
+    AdbClient(const AdbClient&) = delete;
+    AdbClient& operator=(const AdbClient&) = delete;
+
+    // Device to talk to; empty picks the only connected one
+    void setSerial(const std::string& serial);
+    std::string getSerial() const;
+
+    // Socket timeout for requests and one-shot commands, 0 for none
+    void setTimeout(int milliseconds);
+
+    // host:version
+    AdbResult<int> version();
+
+    // host:devices
+    AdbResult<std::vector<AdbDevice>> devices();
+
+    // shell:<command>, run to completion; value is its output
+    AdbResult<std::string> shell(const std::string& command);
+
+    // shell:<command>, left running; the command ends when the stream is
+    // closed
+    AdbResult<AdbStream> openShell(const std::string& command);
+
+    // forward:<local>;<remote>, e.g. "tcp:27183" and "localabstract:scrcpy"
+    AdbStatus forward(const std::string& local, const std::string& remote);
+    AdbStatus removeForward(const std::string& local);
+
+    // sync: SEND of a local file or a buffer to remotePath
+    AdbStatus push(const std::string& localPath, const std::string& remotePath, uint32_t mode = 0644);
+    AdbStatus push(const std::vector<uint8_t>& data, const std::string& remotePath, uint32_t mode = 0644);
+
+    // Wire form of a request: 4 hex digits of length, then the service
+    static std::string encodeRequest(const std::string& service);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+// Drop-in for the old `adb <command>` subprocess, on top of a shared
+// AdbClient: "shell ...", "devices", "version", "forward <local> <remote>"
+// and "forward --remove <local>" are supported. Throws utils::Error on
+// failure, and when checkResult is set and the output reports an error.
+class AdbCommand {
+public:
+    static std::string execute(const std::string& command, bool checkResult = true);
+
+    // The client execute() goes through
+    static AdbClient& client();
+};
+
+} // namespace mirrolink
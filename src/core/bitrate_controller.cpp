@@ -0,0 +1,77 @@
+#include "bitrate_controller.hpp"
+#include <algorithm>
+
+namespace mirrolink {
+
+BitrateController::BitrateController(const BitrateControllerConfig& config) {
+    reset(config);
+}
+
+void BitrateController::reset(const BitrateControllerConfig& newConfig) {
+    config = newConfig;
+    config.minBitrate = std::min(config.minBitrate, config.maxBitrate);
+    config.minFps = std::min(config.minFps, config.maxFps);
+    bitrate = config.maxBitrate;
+    fps = config.maxFps;
+    stable = 0;
+    hold = 0;
+}
+
+void BitrateController::resume(int newBitrate, int newFps) {
+    bitrate = std::clamp(newBitrate, config.minBitrate, config.maxBitrate);
+    fps = std::clamp(newFps, config.minFps, config.maxFps);
+    stable = 0;
+    hold = config.holdIntervals;
+}
+
+BitrateDecision BitrateController::update(const LinkSample& sample) {
+    BitrateDecision decision;
+    const int previousBitrate = bitrate;
+    const int previousFps = fps;
+
+    if (hold > 0) {
+        // The last cut has not reached us yet; anything queued is older
+        hold--;
+    } else {
+        const bool congested = sample.lagMs >= config.congestedLagMs ||
+            sample.droppedPackets > 0 ||
+            (sample.queueDepth > 0 && sample.queued * 2 > sample.queueDepth);
+        // Decoding takes most of the frame interval: fewer frames helps,
+        // a lower bitrate barely does
+        const int64_t frameUs = 1000000 / std::max(fps, 1);
+        const bool decodeBound = sample.decodeUs * 10 > frameUs * 8;
+
+        if (congested || decodeBound) {
+            if (decodeBound) {
+                fps = std::max(config.minFps, fps * 3 / 4);
+            }
+            if (congested && !decodeBound) {
+                bitrate = std::max(config.minBitrate, static_cast<int>(bitrate * config.decreaseFactor));
+            }
+            stable = 0;
+            hold = config.holdIntervals;
+        } else if (++stable >= config.stableIntervals) {
+            stable = 0;
+            // Only probe upwards if the encoder is actually using what it
+            // has; a static screen sends far less than the cap
+            if (sample.receivedBps >= bitrate * 0.7) {
+                bitrate = std::min(config.maxBitrate, bitrate + config.increaseStep);
+            }
+            if (sample.decodeUs * 2 < frameUs) {
+                fps = std::min(config.maxFps, fps + config.fpsStep);
+            }
+        }
+    }
+
+    decision.bitrate = bitrate;
+    decision.maxFps = fps;
+    decision.changed = bitrate != previousBitrate || fps != previousFps;
+    if (bitrate < previousBitrate || fps < previousFps) {
+        decreases++;
+    } else if (decision.changed) {
+        increases++;
+    }
+    return decision;
+}
+
+} // namespace mirrolink
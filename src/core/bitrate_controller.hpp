@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mirrolink {
+
+struct BitrateControllerConfig {
+    int minBitrate = 1000000;
+    int maxBitrate = 8000000;
+    int minFps = 15;
+    int maxFps = 60;
+    double decreaseFactor = 0.7;   // Multiplicative cut on congestion
+    int increaseStep = 500000;     // Additive probe once stable
+    int fpsStep = 5;
+    int stableIntervals = 3;       // Clean intervals before probing upwards
+    int holdIntervals = 2;         // Intervals to ignore after a cut, while it takes effect
+    int64_t congestedLagMs = 150;  // Packet lag that counts as congestion
+};
+
+// What the pipeline saw over one control interval
+struct LinkSample {
+    double receivedBps = 0.0;      // Video payload actually received
+    int64_t decodeUs = 0;          // Mean decode time per frame
+    int64_t lagMs = 0;             // How far behind live the latest packet was
+    size_t queued = 0;             // Packets waiting for the decoder
+    size_t queueDepth = 0;
+    uint64_t droppedPackets = 0;   // Packets the decoder had to shed
+};
+
+struct BitrateDecision {
+    int bitrate = 0;
+    int maxFps = 0;
+    bool changed = false;
+};
+
+// AIMD control of the encoder: back off the bitrate multiplicatively when
+// packets pile up on the way in, and add to it slowly once the link has
+// been clean for a while. Frame rate is cut separately when decoding, not
+// the link, is the bottleneck. Thresholds on both sides and a hold-off
+// after each cut keep it from oscillating.
+class BitrateController {
+public:
+    explicit BitrateController(const BitrateControllerConfig& config = BitrateControllerConfig());
+
+    // Restart from the top of the new bounds
+    void reset(const BitrateControllerConfig& config);
+    // Carry on from settings the encoder already runs at, such as after a
+    // session restart that applied them; holds off as after a cut
+    void resume(int bitrate, int maxFps);
+
+    BitrateDecision update(const LinkSample& sample);
+
+    int getBitrate() const { return bitrate; }
+    int getMaxFps() const { return fps; }
+    uint64_t getDecreases() const { return decreases; }
+    uint64_t getIncreases() const { return increases; }
+
+private:
+    BitrateControllerConfig config;
+    int bitrate = 0;
+    int fps = 0;
+    int stable = 0;
+    int hold = 0;
+    uint64_t decreases = 0;
+    uint64_t increases = 0;
+};
+
+} // namespace mirrolink
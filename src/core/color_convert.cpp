@@ -0,0 +1,442 @@
+#include "color_convert.hpp"
+#include "../utils/thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIRROLINK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mirrolink {
+
+namespace {
+
+// Coefficients in Q13 fixed point. Every kernel computes
+//   R = (Y'*y + V'*rv + 4096) >> 13
+//   G = (Y'*y + U'*gu + V'*gv + 4096) >> 13
+//   B = (Y'*y + U'*bu + 4096) >> 13
+// with Y' = Y - yOffset, U' = U - 128, V' = V - 128, clamped to 0..255.
+struct Coefficients {
+    int16_t yOffset;
+    int16_t y;
+    int16_t rv;
+    int16_t gu;
+    int16_t gv;
+    int16_t bu;
+};
+
+constexpr int kShift = 13;
+constexpr int kRound = 1 << (kShift - 1);
+
+int16_t toFixed(double value) {
+    return static_cast<int16_t>(std::lround(value * (1 << kShift)));
+}
+
+Coefficients makeCoefficients(ColorMatrix matrix, ColorRange range) {
+    const double kr = matrix == ColorMatrix::BT709 ? 0.2126 : 0.299;
+    const double kb = matrix == ColorMatrix::BT709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+
+    const bool limited = range == ColorRange::Limited;
+    const double yScale = limited ? 255.0 / 219.0 : 1.0;
+    const double chromaScale = limited ? 255.0 / 224.0 : 1.0;
+
+    Coefficients c;
+    c.yOffset = limited ? 16 : 0;
+    c.y = toFixed(yScale);
+    c.rv = toFixed(2.0 * (1.0 - kr) * chromaScale);
+    c.gu = toFixed(-2.0 * kb * (1.0 - kb) / kg * chromaScale);
+    c.gv = toFixed(-2.0 * kr * (1.0 - kr) / kg * chromaScale);
+    c.bu = toFixed(2.0 * (1.0 - kb) * chromaScale);
+    return c;
+}
+
+inline uint8_t clampToByte(int value) {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+// Each row kernel converts a prefix of the row and returns how many pixels
+// it handled; the scalar kernel finishes the rest.
+using RowKernel = int (*)(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                          uint8_t* dst, int width, const Coefficients& c, bool bgra);
+
+void convertRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                      uint8_t* dst, int begin, int width, const Coefficients& c, bool bgra) {
+    const int rIndex = bgra ? 2 : 0;
+    const int bIndex = bgra ? 0 : 2;
+
+    for (int x = begin; x < width; ++x) {
+        const int luma = (y[x] - c.yOffset) * c.y;
+        const int cb = u[x >> 1] - 128;
+        const int cr = v[x >> 1] - 128;
+
+        uint8_t* pixel = dst + x * 4;
+        pixel[rIndex] = clampToByte((luma + c.rv * cr + kRound) >> kShift);
+        pixel[1] = clampToByte((luma + c.gu * cb + c.gv * cr + kRound) >> kShift);
+        pixel[bIndex] = clampToByte((luma + c.bu * cb + kRound) >> kShift);
+        pixel[3] = 255;
+    }
+}
+
+int scalarRow(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*, int, const Coefficients&, bool) {
+    return 0;
+}
+
+// Pack two 16-bit coefficients for madd against interleaved (first, second)
+// 16-bit lanes
+inline int32_t coefficientPair(int16_t first, int16_t second) {
+    return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16) |
+                                static_cast<uint16_t>(first));
+}
+
+#ifdef MIRROLINK_X86
+
+__attribute__((target("sse2")))
+int sse2Row(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+            uint8_t* dst, int width, const Coefficients& c, bool bgra) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i coefR = _mm_set1_epi32(coefficientPair(c.y, c.rv));
+    const __m128i coefGU = _mm_set1_epi32(coefficientPair(c.y, c.gu));
+    const __m128i coefGV = _mm_set1_epi32(coefficientPair(c.gv, 0));
+    const __m128i coefB = _mm_set1_epi32(coefficientPair(c.y, c.bu));
+    const __m128i round = _mm_set1_epi32(kRound);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        int32_t uBytes, vBytes;
+        std::memcpy(&uBytes, u + x / 2, sizeof(uBytes));
+        std::memcpy(&vBytes, v + x / 2, sizeof(vBytes));
+
+        // Each chroma sample covers two horizontal pixels
+        __m128i u8 = _mm_cvtsi32_si128(uBytes);
+        __m128i v8 = _mm_cvtsi32_si128(vBytes);
+        u8 = _mm_unpacklo_epi8(u8, u8);
+        v8 = _mm_unpacklo_epi8(v8, v8);
+
+        const __m128i y8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x));
+        const __m128i y16 = _mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), yOffset);
+        const __m128i u16 = _mm_sub_epi16(_mm_unpacklo_epi8(u8, zero), chromaOffset);
+        const __m128i v16 = _mm_sub_epi16(_mm_unpacklo_epi8(v8, zero), chromaOffset);
+
+        const __m128i yvLo = _mm_unpacklo_epi16(y16, v16);
+        const __m128i yvHi = _mm_unpackhi_epi16(y16, v16);
+        const __m128i yuLo = _mm_unpacklo_epi16(y16, u16);
+        const __m128i yuHi = _mm_unpackhi_epi16(y16, u16);
+        const __m128i vLo = _mm_unpacklo_epi16(v16, zero);
+        const __m128i vHi = _mm_unpackhi_epi16(v16, zero);
+
+        const __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo, coefR), round), kShift);
+        const __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi, coefR), round), kShift);
+        const __m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(
+            _mm_madd_epi16(yuLo, coefGU), _mm_madd_epi16(vLo, coefGV)), round), kShift);
+        const __m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(
+            _mm_madd_epi16(yuHi, coefGU), _mm_madd_epi16(vHi, coefGV)), round), kShift);
+        const __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, coefB), round), kShift);
+        const __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, coefB), round), kShift);
+
+        // Saturating packs clamp to 0..255 exactly like the scalar path
+        const __m128i r16 = _mm_packs_epi32(rLo, rHi);
+        const __m128i g16 = _mm_packs_epi32(gLo, gHi);
+        const __m128i b16 = _mm_packs_epi32(bLo, bHi);
+        __m128i r8 = _mm_packus_epi16(r16, r16);
+        const __m128i g8 = _mm_packus_epi16(g16, g16);
+        __m128i b8 = _mm_packus_epi16(b16, b16);
+        if (bgra) {
+            std::swap(r8, b8);
+        }
+
+        const __m128i rg = _mm_unpacklo_epi8(r8, g8);
+        const __m128i ba = _mm_unpacklo_epi8(b8, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+int avx2Row(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+            uint8_t* dst, int width, const Coefficients& c, bool bgra) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi8(-1);
+    const __m256i yOffset = _mm256_set1_epi16(c.yOffset);
+    const __m256i chromaOffset = _mm256_set1_epi16(128);
+    const __m256i coefR = _mm256_set1_epi32(coefficientPair(c.y, c.rv));
+    const __m256i coefGU = _mm256_set1_epi32(coefficientPair(c.y, c.gu));
+    const __m256i coefGV = _mm256_set1_epi32(coefficientPair(c.gv, 0));
+    const __m256i coefB = _mm256_set1_epi32(coefficientPair(c.y, c.bu));
+    const __m256i round = _mm256_set1_epi32(kRound);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2));
+        __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2));
+        u8 = _mm_unpacklo_epi8(u8, u8);
+        v8 = _mm_unpacklo_epi8(v8, v8);
+
+        const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        const __m256i y16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(y8), yOffset);
+        const __m256i u16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(u8), chromaOffset);
+        const __m256i v16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v8), chromaOffset);
+
+        // In-lane unpacks followed by in-lane packs leave pixels in order
+        const __m256i yvLo = _mm256_unpacklo_epi16(y16, v16);
+        const __m256i yvHi = _mm256_unpackhi_epi16(y16, v16);
+        const __m256i yuLo = _mm256_unpacklo_epi16(y16, u16);
+        const __m256i yuHi = _mm256_unpackhi_epi16(y16, u16);
+        const __m256i vLo = _mm256_unpacklo_epi16(v16, zero);
+        const __m256i vHi = _mm256_unpackhi_epi16(v16, zero);
+
+        const __m256i rLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvLo, coefR), round), kShift);
+        const __m256i rHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvHi, coefR), round), kShift);
+        const __m256i gLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(
+            _mm256_madd_epi16(yuLo, coefGU), _mm256_madd_epi16(vLo, coefGV)), round), kShift);
+        const __m256i gHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(
+            _mm256_madd_epi16(yuHi, coefGU), _mm256_madd_epi16(vHi, coefGV)), round), kShift);
+        const __m256i bLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, coefB), round), kShift);
+        const __m256i bHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, coefB), round), kShift);
+
+        const __m256i r16 = _mm256_packs_epi32(rLo, rHi);
+        const __m256i g16 = _mm256_packs_epi32(gLo, gHi);
+        const __m256i b16 = _mm256_packs_epi32(bLo, bHi);
+        __m256i r8 = _mm256_packus_epi16(r16, r16);
+        const __m256i g8 = _mm256_packus_epi16(g16, g16);
+        __m256i b8 = _mm256_packus_epi16(b16, b16);
+        if (bgra) {
+            std::swap(r8, b8);
+        }
+
+        const __m256i rg = _mm256_unpacklo_epi8(r8, g8);
+        const __m256i ba = _mm256_unpacklo_epi8(b8, alpha);
+        const __m256i lo = _mm256_unpacklo_epi16(rg, ba);  // pixels 0-3 | 8-11
+        const __m256i hi = _mm256_unpackhi_epi16(rg, ba);  // pixels 4-7 | 12-15
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return x;
+}
+
+// GCC's AVX-512 intrinsics headers trip -Wmaybe-uninitialized on their own
+// placeholder operands
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+__attribute__((target("avx512f,avx512bw")))
+int avx512Row(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+              uint8_t* dst, int width, const Coefficients& c, bool bgra) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i alpha = _mm512_set1_epi8(-1);
+    const __m512i yOffset = _mm512_set1_epi16(c.yOffset);
+    const __m512i chromaOffset = _mm512_set1_epi16(128);
+    const __m512i coefR = _mm512_set1_epi32(coefficientPair(c.y, c.rv));
+    const __m512i coefGU = _mm512_set1_epi32(coefficientPair(c.y, c.gu));
+    const __m512i coefGV = _mm512_set1_epi32(coefficientPair(c.gv, 0));
+    const __m512i coefB = _mm512_set1_epi32(coefficientPair(c.y, c.bu));
+    const __m512i round = _mm512_set1_epi32(kRound);
+    const __m512i firstHalf = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    const __m512i secondHalf = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m128i uSamples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x / 2));
+        const __m128i vSamples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x / 2));
+        const __m256i u8 = _mm256_set_m128i(_mm_unpackhi_epi8(uSamples, uSamples),
+                                            _mm_unpacklo_epi8(uSamples, uSamples));
+        const __m256i v8 = _mm256_set_m128i(_mm_unpackhi_epi8(vSamples, vSamples),
+                                            _mm_unpacklo_epi8(vSamples, vSamples));
+
+        const __m256i y8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + x));
+        const __m512i y16 = _mm512_sub_epi16(_mm512_cvtepu8_epi16(y8), yOffset);
+        const __m512i u16 = _mm512_sub_epi16(_mm512_cvtepu8_epi16(u8), chromaOffset);
+        const __m512i v16 = _mm512_sub_epi16(_mm512_cvtepu8_epi16(v8), chromaOffset);
+
+        const __m512i yvLo = _mm512_unpacklo_epi16(y16, v16);
+        const __m512i yvHi = _mm512_unpackhi_epi16(y16, v16);
+        const __m512i yuLo = _mm512_unpacklo_epi16(y16, u16);
+        const __m512i yuHi = _mm512_unpackhi_epi16(y16, u16);
+        const __m512i vLo = _mm512_unpacklo_epi16(v16, zero);
+        const __m512i vHi = _mm512_unpackhi_epi16(v16, zero);
+
+        const __m512i rLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yvLo, coefR), round), kShift);
+        const __m512i rHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yvHi, coefR), round), kShift);
+        const __m512i gLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_add_epi32(
+            _mm512_madd_epi16(yuLo, coefGU), _mm512_madd_epi16(vLo, coefGV)), round), kShift);
+        const __m512i gHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_add_epi32(
+            _mm512_madd_epi16(yuHi, coefGU), _mm512_madd_epi16(vHi, coefGV)), round), kShift);
+        const __m512i bLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuLo, coefB), round), kShift);
+        const __m512i bHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuHi, coefB), round), kShift);
+
+        const __m512i r16 = _mm512_packs_epi32(rLo, rHi);
+        const __m512i g16 = _mm512_packs_epi32(gLo, gHi);
+        const __m512i b16 = _mm512_packs_epi32(bLo, bHi);
+        __m512i r8 = _mm512_packus_epi16(r16, r16);
+        const __m512i g8 = _mm512_packus_epi16(g16, g16);
+        __m512i b8 = _mm512_packus_epi16(b16, b16);
+        if (bgra) {
+            std::swap(r8, b8);
+        }
+
+        const __m512i rg = _mm512_unpacklo_epi8(r8, g8);
+        const __m512i ba = _mm512_unpacklo_epi8(b8, alpha);
+        const __m512i lo = _mm512_unpacklo_epi16(rg, ba);  // 4 pixels from each group of 8
+        const __m512i hi = _mm512_unpackhi_epi16(rg, ba);  // the other 4
+        _mm512_storeu_si512(dst + x * 4, _mm512_permutex2var_epi64(lo, firstHalf, hi));
+        _mm512_storeu_si512(dst + x * 4 + 64, _mm512_permutex2var_epi64(lo, secondHalf, hi));
+    }
+    return x;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // MIRROLINK_X86
+
+RowKernel rowKernelFor(ColorKernel kernel) {
+    switch (kernel) {
+#ifdef MIRROLINK_X86
+        case ColorKernel::SSE2:
+            return sse2Row;
+        case ColorKernel::AVX2:
+            return avx2Row;
+        case ColorKernel::AVX512:
+            return avx512Row;
+#endif
+        default:
+            return scalarRow;
+    }
+}
+
+} // namespace
+
+class ColorConverter::Impl {
+public:
+    Impl(int threads, ColorKernel requested)
+        : kernel(resolveKernel(requested))
+        , rowKernel(rowKernelFor(kernel))
+        , bands(threads > 0 ? threads : std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, 4))
+    {
+        if (bands > 1) {
+            // The calling thread converts one band itself
+            pool = std::make_unique<utils::ThreadPool>(bands - 1);
+        }
+    }
+
+    void convert(const uint8_t* const planes[3], const int strides[3],
+                 int width, int height, uint8_t* dst, int dstStride,
+                 const ColorConversion& conversion) {
+        if (width <= 0 || height <= 0) {
+            return;
+        }
+
+        if (!coefficientsValid || conversion.matrix != cachedMatrix || conversion.range != cachedRange) {
+            coefficients = makeCoefficients(conversion.matrix, conversion.range);
+            cachedMatrix = conversion.matrix;
+            cachedRange = conversion.range;
+            coefficientsValid = true;
+        }
+
+        const Coefficients& c = coefficients;
+        const bool bgra = conversion.bgra;
+        auto convertRows = [&](int begin, int end) {
+            for (int row = begin; row < end; ++row) {
+                const uint8_t* y = planes[0] + static_cast<ptrdiff_t>(row) * strides[0];
+                const uint8_t* u = planes[1] + static_cast<ptrdiff_t>(row / 2) * strides[1];
+                const uint8_t* v = planes[2] + static_cast<ptrdiff_t>(row / 2) * strides[2];
+                uint8_t* out = dst + static_cast<ptrdiff_t>(row) * dstStride;
+
+                const int done = rowKernel(y, u, v, out, width, c, bgra);
+                convertRowScalar(y, u, v, out, done, width, c, bgra);
+            }
+        };
+
+        // Bands below ~32 rows cost more in wake-ups than they save
+        const int bandCount = pool ? std::min(bands, std::max(1, height / 32)) : 1;
+        if (bandCount > 1) {
+            pool->parallelFor(height, bandCount, convertRows);
+        } else {
+            convertRows(0, height);
+        }
+    }
+
+    static ColorKernel resolveKernel(ColorKernel requested) {
+        if (requested == ColorKernel::Auto || !ColorConverter::isSupported(requested)) {
+            return ColorConverter::bestKernel();
+        }
+        return requested;
+    }
+
+    const ColorKernel kernel;
+    const RowKernel rowKernel;
+    const int bands;
+    std::unique_ptr<utils::ThreadPool> pool;
+
+    Coefficients coefficients{};
+    ColorMatrix cachedMatrix = ColorMatrix::BT601;
+    ColorRange cachedRange = ColorRange::Limited;
+    bool coefficientsValid = false;
+};
+
+ColorConverter::ColorConverter(int threads, ColorKernel kernel)
+    : pimpl(std::make_unique<Impl>(threads, kernel)) {}
+
+ColorConverter::~ColorConverter() = default;
+
+void ColorConverter::convert(const uint8_t* const planes[3], const int strides[3],
+                             int width, int height, uint8_t* dst, int dstStride,
+                             const ColorConversion& conversion) {
+    pimpl->convert(planes, strides, width, height, dst, dstStride, conversion);
+}
+
+ColorKernel ColorConverter::getKernel() const {
+    return pimpl->kernel;
+}
+
+bool ColorConverter::isSupported(ColorKernel kernel) {
+    switch (kernel) {
+        case ColorKernel::Auto:
+        case ColorKernel::Scalar:
+            return true;
+#ifdef MIRROLINK_X86
+        case ColorKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case ColorKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case ColorKernel::AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+        default:
+            return false;
+    }
+}
+
+ColorKernel ColorConverter::bestKernel() {
+    for (ColorKernel kernel : {ColorKernel::AVX512, ColorKernel::AVX2, ColorKernel::SSE2}) {
+        if (isSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return ColorKernel::Scalar;
+}
+
+const char* ColorConverter::kernelName(ColorKernel kernel) {
+    switch (kernel) {
+        case ColorKernel::Auto: return "auto";
+        case ColorKernel::Scalar: return "scalar";
+        case ColorKernel::SSE2: return "sse2";
+        case ColorKernel::AVX2: return "avx2";
+        case ColorKernel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+} // namespace mirrolink
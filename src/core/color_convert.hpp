@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+namespace mirrolink {
+
+enum class ColorMatrix {
+    BT601,
+    BT709
+};
+
+enum class ColorRange {
+    Limited,  // Y in 16..235, chroma in 16..240 ("TV" / MPEG range)
+    Full      // All components in 0..255 ("PC" / JPEG range)
+};
+
+enum class ColorKernel {
+    Auto,    // Best kernel the CPU supports
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+struct ColorConversion {
+    ColorMatrix matrix = ColorMatrix::BT601;
+    ColorRange range = ColorRange::Limited;
+    bool bgra = false;  // Write B, G, R, A instead of R, G, B, A
+};
+
+// Same-size YUV420P to RGBA/BGRA conversion. All kernels share one
+// fixed-point formula, so the SIMD paths are bit-exact with the scalar one;
+// large images are split into row bands converted in parallel.
+class ColorConverter {
+public:
+    // 0 threads picks a band count from the number of CPU cores
+    explicit ColorConverter(int threads = 0, ColorKernel kernel = ColorKernel::Auto);
+    ~ColorConverter();
+
+    // Convert planes[0..2] (Y, U, V) into packed 32-bit pixels at dst
+    void convert(const uint8_t* const planes[3], const int strides[3],
+                 int width, int height,
+                 uint8_t* dst, int dstStride,
+                 const ColorConversion& conversion);
+
+    // Kernel in use after resolving Auto
+    ColorKernel getKernel() const;
+
+    static bool isSupported(ColorKernel kernel);
+    static ColorKernel bestKernel();
+    static const char* kernelName(ColorKernel kernel);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,476 @@
+#include "control_channel.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mirrolink {
+
+namespace {
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint8_t* writeBigEndian(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return out;
+}
+
+uint8_t* writePosition(uint8_t* out, const ControlPosition& position) {
+    out = writeBigEndian(out, static_cast<uint32_t>(position.x), 4);
+    out = writeBigEndian(out, static_cast<uint32_t>(position.y), 4);
+    out = writeBigEndian(out, position.screenWidth, 2);
+    return writeBigEndian(out, position.screenHeight, 2);
+}
+
+// [0, 1] as 16-bit unsigned fixed point, 1.0 saturating to 0xffff
+uint16_t toUnsignedFixed(float value) {
+    const float clamped = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint16_t>(std::min(clamped * 65536.0f, 65535.0f));
+}
+
+// [-1, 1] as 16-bit signed fixed point, 1.0 saturating to 0x7fff
+int16_t toSignedFixed(float value) {
+    const float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::min(clamped * 32768.0f, 32767.0f));
+}
+
+uint32_t readBigEndian32(const uint8_t* in) {
+    return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 |
+           static_cast<uint32_t>(in[2]) << 8 | in[3];
+}
+
+// How long the writer and reader wait for the socket before checking for
+// shutdown
+constexpr int kWriterPollMs = 100;
+
+// Largest device message scrcpy sends, a clipboard of 256 KiB
+constexpr size_t kMaxDeviceMessageSize = 1 << 18;
+
+// Length of the device message at the start of data: 0 if it has not
+// fully arrived yet, -1 if it cannot be framed
+ptrdiff_t deviceMessageLength(const uint8_t* data, size_t size) {
+    size_t length = 0;
+    switch (static_cast<DeviceMessageType>(data[0])) {
+    case DeviceMessageType::Clipboard:
+        if (size < 5) {
+            return 0;
+        }
+        length = 5 + static_cast<size_t>(readBigEndian32(data + 1));
+        break;
+    case DeviceMessageType::AckClipboard:
+        length = 9;
+        break;
+    case DeviceMessageType::UhidOutput:
+        if (size < 5) {
+            return 0;
+        }
+        length = 5 + (static_cast<size_t>(data[3]) << 8 | data[4]);
+        break;
+    case DeviceMessageType::Capabilities:
+        length = 5;
+        break;
+    default:
+        return -1;
+    }
+    if (length > kMaxDeviceMessageSize) {
+        return -1;
+    }
+    return size >= length ? static_cast<ptrdiff_t>(length) : 0;
+}
+
+} // namespace
+
+class ControlChannel::Impl {
+public:
+    Impl() : ring(kBufferSize) {}
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWriter.notify_one();
+        wakeReader.notify_one();
+        for (std::thread* thread : {&writer, &reader}) {
+            if (thread->joinable()) {
+                thread->join();
+            }
+        }
+        close();
+    }
+
+    void attach(int newSocket) {
+        std::lock_guard<std::mutex> lock(mutex);
+        closeLocked();
+        sockfd = newSocket;
+        if (!writer.joinable()) {
+            writer = std::thread(&Impl::writerLoop, this);
+            reader = std::thread(&Impl::readerLoop, this);
+        }
+        wakeReader.notify_one();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closeLocked();
+    }
+
+    bool isConnected() const {
+        return sockfd >= 0;
+    }
+
+    bool send(const uint8_t* message, size_t size) {
+        // Messages from different threads must not interleave on the wire,
+        // so each one is queued whole or not at all
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sockfd < 0) {
+            return false;
+        }
+        if (size > ring.size() - pending) {
+            utils::Logger::getInstance().warn("Control channel buffer full, dropping message");
+            return false;
+        }
+
+        // Write straight through while nothing is queued ahead
+        size_t written = 0;
+        if (pending == 0) {
+            const ssize_t n = writeSome(message, size);
+            if (n < 0) {
+                return false;
+            }
+            written = static_cast<size_t>(n);
+        }
+        if (written < size) {
+            enqueue(message + written, size - written);
+            wakeWriter.notify_one();
+        }
+        return true;
+    }
+
+    size_t getPendingBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+    void setScreenSize(uint16_t width, uint16_t height) {
+        screenSize = static_cast<uint32_t>(width) << 16 | height;
+    }
+
+    void getScreenSize(uint16_t& width, uint16_t& height) const {
+        const uint32_t size = screenSize;
+        width = static_cast<uint16_t>(size >> 16);
+        height = static_cast<uint16_t>(size);
+    }
+
+    uint32_t getCapabilities() const {
+        return capabilities;
+    }
+
+private:
+    // Never blocks; returns what the socket took, or -1 after closing a
+    // broken connection
+    ssize_t writeSome(const uint8_t* data, size_t size) {
+        while (true) {
+            const ssize_t n = ::send(sockfd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n >= 0) {
+                return n;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            utils::Logger::getInstance().error("Control channel send failed: ", std::strerror(errno));
+            closeLocked();
+            return -1;
+        }
+    }
+
+    void enqueue(const uint8_t* data, size_t size) {
+        size_t tail = (head + pending) % ring.size();
+        while (size > 0) {
+            const size_t chunk = std::min(size, ring.size() - tail);
+            std::memcpy(&ring[tail], data, chunk);
+            data += chunk;
+            size -= chunk;
+            pending += chunk;
+            tail = (tail + chunk) % ring.size();
+        }
+    }
+
+    // Drains the ring whenever the socket could not take a message whole
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (sockfd < 0 || pending == 0) {
+                wakeWriter.wait(lock);
+                continue;
+            }
+
+            const int fd = sockfd;
+            lock.unlock();
+            struct pollfd pollFd{fd, POLLOUT, 0};
+            poll(&pollFd, 1, kWriterPollMs);
+            lock.lock();
+
+            // The socket may have been closed or replaced while polling
+            while (sockfd == fd && pending > 0) {
+                const size_t chunk = std::min(pending, ring.size() - head);
+                const ssize_t n = writeSome(&ring[head], chunk);
+                if (n <= 0) {
+                    break;
+                }
+                head = (head + static_cast<size_t>(n)) % ring.size();
+                pending -= static_cast<size_t>(n);
+            }
+        }
+    }
+
+    // Follows what the server sends back. Only the capabilities are kept;
+    // a stock server sends clipboard messages at most.
+    void readerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (sockfd < 0) {
+                wakeReader.wait(lock);
+                continue;
+            }
+
+            const int fd = sockfd;
+            lock.unlock();
+            struct pollfd pollFd{fd, POLLIN, 0};
+            const int ready = poll(&pollFd, 1, kWriterPollMs);
+            lock.lock();
+
+            // Reading under the lock, so close() cannot hand the fd number
+            // to another socket in between
+            if (ready <= 0 || sockfd != fd) {
+                continue;
+            }
+            uint8_t buffer[4096];
+            const ssize_t n = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0) {
+                receive(buffer, static_cast<size_t>(n));
+            } else if (n == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                utils::Logger::getInstance().warn("Control channel closed by the server");
+                closeLocked();
+            }
+        }
+    }
+
+    void receive(const uint8_t* data, size_t size) {
+        if (inboxLost) {
+            return;
+        }
+        inbox.insert(inbox.end(), data, data + size);
+
+        size_t offset = 0;
+        while (offset < inbox.size()) {
+            const ptrdiff_t length = deviceMessageLength(&inbox[offset], inbox.size() - offset);
+            if (length == 0) {
+                break;
+            }
+            if (length < 0) {
+                // Nothing after this can be framed; capabilities come first,
+                // so they are not lost
+                utils::Logger::getInstance().warn("Unknown message on the control channel, ignoring the rest");
+                inboxLost = true;
+                inbox.clear();
+                return;
+            }
+            if (static_cast<DeviceMessageType>(inbox[offset]) == DeviceMessageType::Capabilities) {
+                capabilities = readBigEndian32(&inbox[offset + 1]);
+                utils::Logger::getInstance().info("Server supports control extensions 0x", std::hex,
+                    capabilities.load(), std::dec);
+            }
+            offset += static_cast<size_t>(length);
+        }
+        inbox.erase(inbox.begin(), inbox.begin() + static_cast<ptrdiff_t>(offset));
+    }
+
+    void closeLocked() {
+        if (sockfd >= 0) {
+            ::close(sockfd);
+            sockfd = -1;
+        }
+        head = 0;
+        pending = 0;
+        capabilities = 0;
+        inbox.clear();
+        inboxLost = false;
+    }
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable wakeReader;
+    std::thread writer;
+    std::thread reader;
+    bool stopping = false;
+    std::atomic<int> sockfd{-1};
+    std::atomic<uint32_t> screenSize{0};
+    std::atomic<uint32_t> capabilities{0};
+
+    // Device messages received but not complete yet
+    std::vector<uint8_t> inbox;
+    bool inboxLost = false;
+
+    // Bytes the socket has not taken yet, oldest at head
+    std::vector<uint8_t> ring;
+    size_t head = 0;
+    size_t pending = 0;
+};
+
+ControlChannel::ControlChannel() : pimpl(std::make_unique<Impl>()) {}
+
+ControlChannel::~ControlChannel() = default;
+
+void ControlChannel::attach(int sockfd) {
+    pimpl->attach(sockfd);
+}
+
+void ControlChannel::close() {
+    pimpl->close();
+}
+
+bool ControlChannel::isConnected() const {
+    return pimpl->isConnected();
+}
+
+bool ControlChannel::send(const uint8_t* message, size_t size) {
+    return pimpl->send(message, size);
+}
+
+bool ControlChannel::send(const std::vector<uint8_t>& message) {
+    return pimpl->send(message.data(), message.size());
+}
+
+size_t ControlChannel::getPendingBytes() const {
+    return pimpl->getPendingBytes();
+}
+
+void ControlChannel::setScreenSize(uint16_t width, uint16_t height) {
+    pimpl->setScreenSize(width, height);
+}
+
+void ControlChannel::getScreenSize(uint16_t& width, uint16_t& height) const {
+    pimpl->getScreenSize(width, height);
+}
+
+uint32_t ControlChannel::getCapabilities() const {
+    return pimpl->getCapabilities();
+}
+
+bool ControlChannel::supports(ControlCapability capability) const {
+    return (pimpl->getCapabilities() & static_cast<uint32_t>(capability)) != 0;
+}
+
+bool ControlChannel::sendVideoSettings(const VideoSettings& settings) {
+    if (!supports(ControlCapability::VideoSettings)) {
+        return false;
+    }
+    return send(encodeVideoSettings(settings));
+}
+
+bool ControlChannel::requestKeyframe() {
+    if (!supports(ControlCapability::RequestKeyframe)) {
+        return false;
+    }
+    const uint8_t message = static_cast<uint8_t>(ControlMessageType::RequestKeyframe);
+    return pimpl->send(&message, 1);
+}
+
+bool ControlChannel::injectKeycode(const KeycodeMessage& message) {
+    uint8_t buffer[kKeycodeMessageSize];
+    return pimpl->send(buffer, encodeKeycode(message, buffer));
+}
+
+bool ControlChannel::injectTouch(const TouchMessage& message) {
+    uint8_t buffer[kTouchMessageSize];
+    return pimpl->send(buffer, encodeTouch(message, buffer));
+}
+
+bool ControlChannel::injectTouches(const TouchMessage* messages, size_t count) {
+    if (count > kMaxTouchBatch) {
+        return false;
+    }
+    uint8_t buffer[kMaxTouchBatch * kTouchMessageSize];
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size += encodeTouch(messages[i], buffer + size);
+    }
+    return pimpl->send(buffer, size);
+}
+
+bool ControlChannel::injectScroll(const ScrollMessage& message) {
+    uint8_t buffer[kScrollMessageSize];
+    return pimpl->send(buffer, encodeScroll(message, buffer));
+}
+
+bool ControlChannel::injectText(const char* text, size_t size) {
+    if (size > kMaxTextLength) {
+        return false;
+    }
+    uint8_t buffer[5 + kMaxTextLength];
+    buffer[0] = static_cast<uint8_t>(ControlMessageType::InjectText);
+    writeBigEndian(buffer + 1, size, 4);
+    std::memcpy(buffer + 5, text, size);
+    return pimpl->send(buffer, 5 + size);
+}
+
+std::vector<uint8_t> ControlChannel::encodeVideoSettings(const VideoSettings& settings) {
+    std::vector<uint8_t> message;
+    message.reserve(9);
+    message.push_back(static_cast<uint8_t>(ControlMessageType::SetVideoSettings));
+    appendBigEndian(message, settings.bitrate, 4);
+    appendBigEndian(message, settings.maxFps, 2);
+    appendBigEndian(message, settings.maxSize, 2);
+    return message;
+}
+
+size_t ControlChannel::encodeKeycode(const KeycodeMessage& message, uint8_t* out) {
+    uint8_t* p = out;
+    *p++ = static_cast<uint8_t>(ControlMessageType::InjectKeycode);
+    *p++ = static_cast<uint8_t>(message.action);
+    p = writeBigEndian(p, message.keycode, 4);
+    p = writeBigEndian(p, message.repeat, 4);
+    p = writeBigEndian(p, message.metaState, 4);
+    return static_cast<size_t>(p - out);
+}
+
+size_t ControlChannel::encodeTouch(const TouchMessage& message, uint8_t* out) {
+    uint8_t* p = out;
+    *p++ = static_cast<uint8_t>(ControlMessageType::InjectTouchEvent);
+    *p++ = static_cast<uint8_t>(message.action);
+    p = writeBigEndian(p, message.pointerId, 8);
+    p = writePosition(p, message.position);
+    p = writeBigEndian(p, toUnsignedFixed(message.pressure), 2);
+    p = writeBigEndian(p, message.actionButton, 4);
+    p = writeBigEndian(p, message.buttons, 4);
+    return static_cast<size_t>(p - out);
+}
+
+size_t ControlChannel::encodeScroll(const ScrollMessage& message, uint8_t* out) {
+    uint8_t* p = out;
+    *p++ = static_cast<uint8_t>(ControlMessageType::InjectScrollEvent);
+    p = writePosition(p, message.position);
+    p = writeBigEndian(p, static_cast<uint16_t>(toSignedFixed(message.hscroll)), 2);
+    p = writeBigEndian(p, static_cast<uint16_t>(toSignedFixed(message.vscroll)), 2);
+    p = writeBigEndian(p, message.buttons, 4);
+    return static_cast<size_t>(p - out);
+}
+
+} // namespace mirrolink
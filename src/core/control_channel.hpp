@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mirrolink {
+
+// Message types understood by the server on the control socket. Values
+// below 0x80 are scrcpy's own. From 0x80 up are MirroLink extensions that
+// no upstream scrcpy server implements: a stock server rejects them and
+// may drop the connection, so they are only sent once the server has
+// announced them (see ControlCapability).
+enum class ControlMessageType : uint8_t {
+    InjectKeycode = 0,
+    InjectText = 1,
+    InjectTouchEvent = 2,
+    InjectScrollEvent = 3,
+    SetVideoSettings = 0x80,  // Extension
+    RequestKeyframe = 0x81    // Extension; no payload, the encoder emits an IDR frame next
+};
+
+// Messages the server sends back on the control socket. scrcpy's own are
+// only parsed to keep the stream framed.
+enum class DeviceMessageType : uint8_t {
+    Clipboard = 0,      // u32 length, then UTF-8 text
+    AckClipboard = 1,   // u64 sequence
+    UhidOutput = 2,     // u16 id, u16 length, then data
+    Capabilities = 0x80 // Extension: u32 ControlCapability bits
+};
+
+// Extensions a MirroLink-patched server announces with a Capabilities
+// message as soon as it accepts the control socket. A stock server never
+// sends one, so everything that depends on them has a fallback.
+enum class ControlCapability : uint32_t {
+    VideoSettings = 1u << 0,
+    RequestKeyframe = 1u << 1
+};
+
+// Android KeyEvent.ACTION_* and MotionEvent.ACTION_* values
+enum class KeyAction : uint8_t {
+    Down = 0,
+    Up = 1
+};
+
+enum class TouchAction : uint8_t {
+    Down = 0,
+    Up = 1,
+    Move = 2
+};
+
+// Encoder settings the server can change without restarting the stream
+struct VideoSettings {
+    uint32_t bitrate = 0;   // Bits per second
+    uint16_t maxFps = 0;
+    uint16_t maxSize = 0;   // Longest side of the encoded video in pixels
+};
+
+// Position on the device screen. The server drops events whose screen
+// size is not the size of the video it currently sends.
+struct ControlPosition {
+    int32_t x = 0;
+    int32_t y = 0;
+    uint16_t screenWidth = 0;
+    uint16_t screenHeight = 0;
+};
+
+struct KeycodeMessage {
+    KeyAction action = KeyAction::Down;
+    uint32_t keycode = 0;   // Android KEYCODE_* value
+    uint32_t repeat = 0;
+    uint32_t metaState = 0; // Android META_* flags
+};
+
+struct TouchMessage {
+    TouchAction action = TouchAction::Down;
+    uint64_t pointerId = 0;
+    ControlPosition position;
+    float pressure = 1.0f;  // 0 to 1
+    uint32_t actionButton = 0;
+    uint32_t buttons = 0;
+};
+
+struct ScrollMessage {
+    ControlPosition position;
+    float hscroll = 0.0f;   // -1 to 1, one wheel notch is 1
+    float vscroll = 0.0f;
+    uint32_t buttons = 0;
+};
+
+// Second connection to the scrcpy server, next to the video socket, used
+// to send control messages to the device. Sends never block: whatever the
+// socket does not take right away is kept in a ring buffer and written by
+// a background thread once the socket drains. A second thread reads what
+// the server sends back, to learn which extensions it supports.
+class ControlChannel {
+public:
+    static constexpr size_t kKeycodeMessageSize = 14;
+    static constexpr size_t kTouchMessageSize = 32;
+    static constexpr size_t kScrollMessageSize = 21;
+    static constexpr size_t kMaxTextLength = 300;  // Longest text the server accepts
+    static constexpr size_t kMaxTouchBatch = 10;
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    ControlChannel();
+    ~ControlChannel();
+
+    ControlChannel(const ControlChannel&) = delete;
+    ControlChannel& operator=(const ControlChannel&) = delete;
+
+    // Take over a connected socket; ServerTunnel opens it
+    void attach(int sockfd);
+
+    void close();
+    bool isConnected() const;
+
+    // Queue one complete message; safe to call from any thread. Fails when
+    // disconnected or when the buffer has no room for the whole message.
+    bool send(const uint8_t* message, size_t size);
+    bool send(const std::vector<uint8_t>& message);
+
+    // Bytes queued but not yet taken by the socket
+    size_t getPendingBytes() const;
+
+    // Size of the video the device sends, which touch and scroll positions
+    // are relative to; 0x0 until the stream has started
+    void setScreenSize(uint16_t width, uint16_t height);
+    void getScreenSize(uint16_t& width, uint16_t& height) const;
+
+    // Extensions announced by the server on the current connection; none
+    // until its Capabilities message arrives, and none ever from a stock
+    // scrcpy server
+    uint32_t getCapabilities() const;
+    bool supports(ControlCapability capability) const;
+
+    // Extension messages; fail without sending anything unless the server
+    // announced them
+    bool sendVideoSettings(const VideoSettings& settings);
+    bool requestKeyframe();
+
+    bool injectKeycode(const KeycodeMessage& message);
+    bool injectTouch(const TouchMessage& message);
+    // All pointers of one frame in a single write, so no other message
+    // lands between them; at most kMaxTouchBatch
+    bool injectTouches(const TouchMessage* messages, size_t count);
+    bool injectScroll(const ScrollMessage& message);
+    // Text longer than kMaxTextLength bytes is rejected
+    bool injectText(const char* text, size_t size);
+    bool injectText(const std::string& text) { return injectText(text.data(), text.size()); }
+
+    // Wire format of a SetVideoSettings message: type, then bitrate (u32),
+    // max fps (u16) and max size (u16), all big-endian
+    static std::vector<uint8_t> encodeVideoSettings(const VideoSettings& settings);
+
+    // scrcpy wire formats, written to out without allocating; each returns
+    // the number of bytes written. All integers are big-endian, pressure
+    // is a 16-bit unsigned and scroll amounts 16-bit signed fixed point.
+    static size_t encodeKeycode(const KeycodeMessage& message, uint8_t* out);
+    static size_t encodeTouch(const TouchMessage& message, uint8_t* out);
+    static size_t encodeScroll(const ScrollMessage& message, uint8_t* out);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,244 @@
+#include "damage_tracker.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIRROLINK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mirrolink {
+
+namespace {
+
+constexpr uint32_t kPrime = 0x9E3779B1u;
+
+// Eight 32-bit lanes take consecutive words of the input, so one AVX2
+// register holds the whole state. Rotate and multiply are both bijective,
+// so a change in any single 32-byte block always reaches the hash.
+struct HashState {
+    alignas(32) uint32_t lanes[8] = {
+        0x243F6A88u, 0x85A308D3u, 0x13198A2Eu, 0x03707344u,
+        0xA4093822u, 0x299F31D0u, 0x082EFA98u, 0xEC4E6C89u
+    };
+    uint32_t tail = 0x452821E6u;
+};
+
+inline uint32_t rotl(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// Bytes past the last whole block
+inline void absorbTail(HashState& state, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        state.tail = (state.tail ^ data[i]) * kPrime;
+    }
+}
+
+void scalarAbsorb(HashState& state, const uint8_t* data, size_t length) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        for (int lane = 0; lane < 8; ++lane) {
+            uint32_t word;
+            std::memcpy(&word, data + i + lane * 4, sizeof(word));
+            state.lanes[lane] = rotl(state.lanes[lane] ^ word, 13) * kPrime;
+        }
+    }
+    absorbTail(state, data + i, length - i);
+}
+
+#ifdef MIRROLINK_X86
+
+__attribute__((target("avx2")))
+void avx2Absorb(HashState& state, const uint8_t* data, size_t length) {
+    __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.lanes));
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(kPrime));
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i value = _mm256_xor_si256(lanes,
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        value = _mm256_or_si256(_mm256_slli_epi32(value, 13), _mm256_srli_epi32(value, 19));
+        lanes = _mm256_mullo_epi32(value, prime);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(state.lanes), lanes);
+    absorbTail(state, data + i, length - i);
+}
+
+#endif // MIRROLINK_X86
+
+using AbsorbKernel = void (*)(HashState&, const uint8_t*, size_t);
+
+AbsorbKernel absorbKernel() {
+#ifdef MIRROLINK_X86
+    static const AbsorbKernel kernel = __builtin_cpu_supports("avx2") ? avx2Absorb : scalarAbsorb;
+    return kernel;
+#else
+    return scalarAbsorb;
+#endif
+}
+
+uint64_t finish(const HashState& state) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ state.tail;
+    for (uint32_t lane : state.lanes) {
+        hash = (hash ^ lane) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+void absorbRows(AbsorbKernel absorb, HashState& state, const uint8_t* plane, int stride,
+                int offset, int length, int firstRow, int rows) {
+    const uint8_t* row = plane + static_cast<size_t>(firstRow) * stride + offset;
+    for (int y = 0; y < rows; ++y, row += stride) {
+        absorb(state, row, static_cast<size_t>(length));
+    }
+}
+
+} // namespace
+
+DamageTracker::DamageTracker(int tileSize)
+    : tileSize(std::max(2, tileSize & ~1))
+    , tilesX(0)
+    , tilesY(0)
+    , width(0)
+    , height(0)
+    , format(PixelFormat::RGBA)
+{}
+
+bool DamageTracker::update(const FrameData& frame, std::vector<DamageRect>& rects) {
+    rects.clear();
+    stats.frames++;
+    const uint64_t total = frameBytes(frame.format, frame.width, frame.height);
+
+    const bool first = hashes.empty() || frame.width != width || frame.height != height ||
+                       frame.format != format;
+    if (first) {
+        width = frame.width;
+        height = frame.height;
+        format = frame.format;
+        tilesX = (width + tileSize - 1) / tileSize;
+        tilesY = (height + tileSize - 1) / tileSize;
+        hashes.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+        dirty.assign(hashes.size(), 1);
+    }
+
+    size_t dirtyTiles = 0;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const int y = ty * tileSize;
+        const int h = std::min(tileSize, height - y);
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int x = tx * tileSize;
+            const size_t index = static_cast<size_t>(ty) * tilesX + tx;
+            const uint64_t hash = hashTile(frame, x, y, std::min(tileSize, width - x), h);
+            dirty[index] = first || hash != hashes[index];
+            dirtyTiles += dirty[index];
+            hashes[index] = hash;
+        }
+    }
+
+    if (dirtyTiles == 0) {
+        stats.unchanged++;
+        stats.savedBytes += total;
+        return false;
+    }
+
+    // Past half the tiles, one upload is cheaper than many small ones
+    if (first || dirtyTiles * 2 > hashes.size()) {
+        rects.push_back({0, 0, width, height});
+        stats.full++;
+        stats.uploadBytes += total;
+        return true;
+    }
+
+    // Merge runs of dirty tiles in a row, then runs with the same columns
+    // in consecutive rows
+    std::vector<int> above(static_cast<size_t>(tilesX), -1);
+    std::vector<int> current(static_cast<size_t>(tilesX), -1);
+    for (int ty = 0; ty < tilesY; ++ty) {
+        std::fill(current.begin(), current.end(), -1);
+        const int y = ty * tileSize;
+        const int h = std::min(tileSize, height - y);
+        int tx = 0;
+        while (tx < tilesX) {
+            if (!dirty[static_cast<size_t>(ty) * tilesX + tx]) {
+                tx++;
+                continue;
+            }
+            const int start = tx;
+            while (tx < tilesX && dirty[static_cast<size_t>(ty) * tilesX + tx]) {
+                tx++;
+            }
+            const int x = start * tileSize;
+            const int w = std::min(tx * tileSize, width) - x;
+
+            const int previous = above[static_cast<size_t>(start)];
+            if (previous >= 0 && rects[static_cast<size_t>(previous)].width == w) {
+                rects[static_cast<size_t>(previous)].height += h;
+                current[static_cast<size_t>(start)] = previous;
+            } else {
+                rects.push_back({x, y, w, h});
+                current[static_cast<size_t>(start)] = static_cast<int>(rects.size()) - 1;
+            }
+        }
+        above.swap(current);
+    }
+
+    uint64_t uploaded = 0;
+    for (const DamageRect& rect : rects) {
+        uploaded += frameBytes(format, rect.width, rect.height);
+    }
+    stats.partial++;
+    stats.uploadBytes += uploaded;
+    stats.savedBytes += total > uploaded ? total - uploaded : 0;
+    return true;
+}
+
+void DamageTracker::reset() {
+    hashes.clear();
+    dirty.clear();
+}
+
+bool DamageTracker::hasSimd() {
+#ifdef MIRROLINK_X86
+    return absorbKernel() == avx2Absorb;
+#else
+    return false;
+#endif
+}
+
+uint64_t DamageTracker::hashTile(const FrameData& frame, int x, int y, int w, int h) const {
+    const AbsorbKernel absorb = absorbKernel();
+    HashState state;
+
+    if (frame.format == PixelFormat::RGBA) {
+        absorbRows(absorb, state, frame.planes[0], frame.strides[0], x * 4, w * 4, y, h);
+        return finish(state);
+    }
+
+    absorbRows(absorb, state, frame.planes[0], frame.strides[0], x, w, y, h);
+    // Tiles start on even pixels, so each covers whole chroma samples
+    const int chromaX = x / 2;
+    const int chromaWidth = (x + w + 1) / 2 - chromaX;
+    const int chromaY = y / 2;
+    const int chromaHeight = (y + h + 1) / 2 - chromaY;
+    if (frame.format == PixelFormat::NV12) {
+        absorbRows(absorb, state, frame.planes[1], frame.strides[1],
+                   chromaX * 2, chromaWidth * 2, chromaY, chromaHeight);
+    } else {
+        absorbRows(absorb, state, frame.planes[1], frame.strides[1],
+                   chromaX, chromaWidth, chromaY, chromaHeight);
+        absorbRows(absorb, state, frame.planes[2], frame.strides[2],
+                   chromaX, chromaWidth, chromaY, chromaHeight);
+    }
+    return finish(state);
+}
+
+uint64_t DamageTracker::frameBytes(PixelFormat format, int width, int height) {
+    const uint64_t pixels = static_cast<uint64_t>(width) * height;
+    if (format == PixelFormat::RGBA) {
+        return pixels * 4;
+    }
+    return pixels + 2 * static_cast<uint64_t>((width + 1) / 2) * ((height + 1) / 2);
+}
+
+} // namespace mirrolink
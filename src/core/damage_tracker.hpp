@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "frame_pool.hpp"
+
+namespace mirrolink {
+
+// Region of a frame in pixels (luma pixels for YUV frames)
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct DamageStats {
+    uint64_t frames = 0;         // Frames compared
+    uint64_t unchanged = 0;      // Identical to the previous frame, nothing to upload
+    uint64_t partial = 0;        // Only some regions changed
+    uint64_t full = 0;           // Uploaded whole
+    uint64_t uploadBytes = 0;    // Pixel bytes in the regions handed out for upload
+    uint64_t savedBytes = 0;     // Pixel bytes that did not need uploading
+};
+
+// Finds the parts of a frame that changed since the previous one by hashing
+// fixed-size tiles (all planes of a tile feed one hash) and comparing with
+// the hashes from the last frame. Changed tiles are merged into as few
+// rectangles as row runs allow. The hash uses AVX2 where the CPU has it; the
+// scalar path computes the same values.
+class DamageTracker {
+public:
+    // Tiles are tileSize x tileSize luma pixels; must be even
+    explicit DamageTracker(int tileSize = 64);
+
+    // Compare a frame with the previous one. Returns false if nothing
+    // changed; otherwise rects holds the regions to upload, which is the
+    // whole frame after a reset, a size or format change, or when most
+    // tiles changed anyway.
+    bool update(const FrameData& frame, std::vector<DamageRect>& rects);
+
+    // Forget the previous frame, e.g. after the texture was recreated
+    void reset();
+
+    const DamageStats& getStats() const { return stats; }
+
+    static bool hasSimd();
+
+private:
+    uint64_t hashTile(const FrameData& frame, int x, int y, int width, int height) const;
+    static uint64_t frameBytes(PixelFormat format, int width, int height);
+
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    int width;
+    int height;
+    PixelFormat format;
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> dirty;
+    DamageStats stats;
+};
+
+} // namespace mirrolink
@@ -1,4 +1,5 @@
 #include "device_manager.hpp"
+#include "adb_client.hpp"
 #include "../utils/logger.hpp"
 #include "../utils/error.hpp"
 #include <libusb-1.0/libusb.h>
@@ -0,0 +1,139 @@
+#include "frame_pool.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace mirrolink {
+namespace detail {
+
+struct FramePoolCore {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<FrameSlot>> slots;
+    std::vector<FrameSlot*> freeSlots;
+    FramePoolStats stats;
+
+    void release(FrameSlot* slot) {
+        // Hold the owner reference until the slot is back on the free list;
+        // if this was the last one the core is destroyed on scope exit.
+        std::shared_ptr<FramePoolCore> self = std::move(slot->owner);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        freeSlots.push_back(slot);
+        stats.outstanding--;
+    }
+};
+
+} // namespace detail
+
+// FrameRef
+
+FrameRef::FrameRef(const FrameRef& other) noexcept : slot(other.slot) {
+    if (slot) {
+        slot->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+FrameRef::FrameRef(FrameRef&& other) noexcept : slot(other.slot) {
+    other.slot = nullptr;
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other) noexcept {
+    if (this != &other) {
+        FrameRef copy(other);
+        std::swap(slot, copy.slot);
+    }
+    return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept {
+    if (this != &other) {
+        reset();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+FrameRef::~FrameRef() {
+    reset();
+}
+
+void FrameRef::reset() noexcept {
+    if (!slot) {
+        return;
+    }
+
+    detail::FrameSlot* released = slot;
+    slot = nullptr;
+    if (released->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        released->owner->release(released);
+    }
+}
+
+uint32_t FrameRef::useCount() const {
+    return slot ? slot->refs.load(std::memory_order_relaxed) : 0;
+}
+
+// FramePool
+
+FramePool::FramePool() : core(std::make_shared<detail::FramePoolCore>()) {}
+
+FramePool::~FramePool() = default;
+
+FrameRef FramePool::acquire(size_t bytes) {
+    detail::FrameSlot* slot = nullptr;
+    bool allocated = false;
+
+    {
+        std::lock_guard<std::mutex> lock(core->mutex);
+
+        if (!core->freeSlots.empty()) {
+            slot = core->freeSlots.back();
+            core->freeSlots.pop_back();
+        } else {
+            core->slots.push_back(std::make_unique<detail::FrameSlot>());
+            slot = core->slots.back().get();
+            // Keep the free list large enough to take every slot back
+            // without reallocating on the release path
+            core->freeSlots.reserve(core->slots.size());
+            allocated = true;
+        }
+
+        allocated = allocated || slot->frame.data.capacity() < bytes;
+        if (allocated) {
+            core->stats.misses++;
+        } else {
+            core->stats.hits++;
+        }
+
+        core->stats.outstanding++;
+        core->stats.highWaterMark = std::max(core->stats.highWaterMark, core->stats.outstanding);
+    }
+
+    // Shrinking keeps the capacity, so only a larger frame reallocates
+    slot->frame.data.resize(bytes);
+    slot->owner = core;
+    slot->refs.store(1, std::memory_order_relaxed);
+    return FrameRef(slot);
+}
+
+FramePoolStats FramePool::getStats() const {
+    std::lock_guard<std::mutex> lock(core->mutex);
+    FramePoolStats stats = core->stats;
+    stats.capacity = core->slots.size();
+    return stats;
+}
+
+void FramePool::trim() {
+    std::lock_guard<std::mutex> lock(core->mutex);
+
+    for (detail::FrameSlot* idle : core->freeSlots) {
+        auto it = std::find_if(core->slots.begin(), core->slots.end(),
+            [idle](const std::unique_ptr<detail::FrameSlot>& slot) { return slot.get() == idle; });
+        if (it != core->slots.end()) {
+            core->slots.erase(it);
+        }
+    }
+    core->freeSlots.clear();
+}
+
+} // namespace mirrolink
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mirrolink {
+
+enum class PixelFormat {
+    RGBA,     // Packed 8-bit R, G, B, A
+    YUV420P,  // Planar Y, U, V with 2x2 subsampled chroma
+    NV12      // Planar Y with interleaved UV at 2x2 subsampling
+};
+
+// Monotonic times at which a frame left each pipeline stage. Stages that
+// were not measured keep a default (epoch) time point.
+struct FrameTimestamps {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point received;   // Last packet read from the socket
+    Clock::time_point decoded;    // Decoder output
+    Clock::time_point converted;  // Copied or converted into the pooled frame
+    Clock::time_point uploaded;   // Texture updated (set by the renderer)
+    Clock::time_point presented;  // SDL_RenderPresent returned (set by the renderer)
+};
+
+struct FrameData {
+    std::vector<uint8_t> data;  // Backing storage for the planes
+    uint8_t* planes[3]{};       // Plane pointers into data (unused planes are null)
+    int strides[3]{};           // Bytes per row of each plane
+    int width;
+    int height;
+    int64_t timestamp;
+    PixelFormat format;
+    // Colour description of YUV frames, from the decoder
+    bool bt709 = false;
+    bool fullRange = false;
+    FrameTimestamps timestamps;
+};
+
+struct FramePoolStats {
+    uint64_t hits = 0;         // Acquisitions served by a recycled buffer
+    uint64_t misses = 0;       // Acquisitions that had to allocate
+    size_t capacity = 0;       // Buffers owned by the pool
+    size_t outstanding = 0;    // Buffers currently held by consumers
+    size_t highWaterMark = 0;  // Peak number of buffers held at once
+};
+
+namespace detail {
+
+struct FramePoolCore;
+
+struct FrameSlot {
+    FrameData frame;
+    std::atomic<uint32_t> refs{0};
+    // Keeps the pool alive while the slot is checked out, so handles may
+    // outlive the FramePool that produced them
+    std::shared_ptr<FramePoolCore> owner;
+};
+
+} // namespace detail
+
+// Reference-counted handle to a pooled frame. Copies share the same buffer,
+// which goes back to its pool when the last handle is dropped.
+class FrameRef {
+public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other) noexcept;
+    FrameRef(FrameRef&& other) noexcept;
+    FrameRef& operator=(const FrameRef& other) noexcept;
+    FrameRef& operator=(FrameRef&& other) noexcept;
+    ~FrameRef();
+
+    FrameData& operator*() const { return slot->frame; }
+    FrameData* operator->() const { return &slot->frame; }
+    FrameData* get() const { return slot ? &slot->frame : nullptr; }
+    explicit operator bool() const { return slot != nullptr; }
+
+    // Drop this reference early
+    void reset() noexcept;
+
+    // Number of handles sharing the frame (0 for an empty handle)
+    uint32_t useCount() const;
+
+private:
+    friend class FramePool;
+    explicit FrameRef(detail::FrameSlot* slot) noexcept : slot(slot) {}
+
+    detail::FrameSlot* slot = nullptr;
+};
+
+// Recycles frame buffers between the capture thread and frame consumers.
+// Once the pool has grown to cover the frames in flight, acquiring a frame of
+// an already-seen size does not touch the heap.
+class FramePool {
+public:
+    FramePool();
+    ~FramePool();
+
+    // Get a frame whose data holds at least the given number of bytes. The
+    // contents are left over from the previous user and must be overwritten.
+    FrameRef acquire(size_t bytes);
+
+    // Snapshot of hit/miss counters and buffer usage
+    FramePoolStats getStats() const;
+
+    // Release idle buffers, e.g. after a resolution change
+    void trim();
+
+private:
+    std::shared_ptr<detail::FramePoolCore> core;
+};
+
+} // namespace mirrolink
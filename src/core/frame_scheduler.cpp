@@ -0,0 +1,130 @@
+#include "frame_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace mirrolink {
+
+namespace {
+
+// FrameData::timestamp of frames the decoder gave no pts (AV_NOPTS_VALUE)
+constexpr int64_t kNoPts = std::numeric_limits<int64_t>::min();
+
+// A pts step larger than this, or backwards, is a new stream, not jitter
+constexpr int64_t kDiscontinuityUs = 1000000;
+
+int64_t toMicros(FrameScheduler::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+FrameScheduler::FrameScheduler(const FrameSchedulerConfig& config) {
+    setConfig(config);
+}
+
+void FrameScheduler::setConfig(const FrameSchedulerConfig& newConfig) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+    config.capacity = std::max<size_t>(config.capacity, 1);
+    config.offsetWindow = std::max<size_t>(config.offsetWindow, 1);
+}
+
+void FrameScheduler::push(const FrameRef& frame, Clock::time_point arrival) {
+    if (!frame) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t arrivalUs = toMicros(arrival);
+
+    int64_t dueUs = arrivalUs;
+    if (frame->timestamp != kNoPts) {
+        updateClock(frame->timestamp, arrivalUs);
+        dueUs = frame->timestamp + offsets.front().second + stats.delayUs;
+    }
+
+    if (queue.size() >= config.capacity) {
+        queue.pop_front();
+        stats.overflows++;
+    }
+    queue.push_back({frame, dueUs});
+}
+
+bool FrameScheduler::next(Clock::time_point displayTime, Clock::duration tolerance, FrameRef& frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t limitUs = toMicros(displayTime) +
+        std::chrono::duration_cast<std::chrono::microseconds>(tolerance).count() / 2;
+
+    // Frames may come due out of order when the clock mapping moved; the
+    // newest due one wins either way
+    size_t chosen = queue.size();
+    for (size_t i = 0; i < queue.size(); ++i) {
+        if (queue[i].dueUs <= limitUs) {
+            chosen = i;
+        }
+    }
+    if (chosen == queue.size()) {
+        return false;
+    }
+
+    frame = std::move(queue[chosen].frame);
+    queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(chosen) + 1);
+    stats.late += chosen;
+    stats.presented++;
+    return true;
+}
+
+void FrameScheduler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.clear();
+    resetClock();
+    jitterUs = 0.0;
+    frameIntervalUs = 0.0;
+    stats.delayUs = 0;
+}
+
+FrameSchedulerStats FrameScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FrameSchedulerStats snapshot = stats;
+    snapshot.buffered = queue.size();
+    snapshot.jitterUs = static_cast<int64_t>(jitterUs);
+    snapshot.frameIntervalUs = static_cast<int64_t>(frameIntervalUs);
+    return snapshot;
+}
+
+void FrameScheduler::updateClock(int64_t pts, int64_t arrivalUs) {
+    if (hasPts && (pts < lastPts || pts - lastPts > kDiscontinuityUs)) {
+        resetClock();
+    }
+    if (hasPts && pts > lastPts) {
+        const double interval = static_cast<double>(pts - lastPts);
+        frameIntervalUs = frameIntervalUs > 0.0 ? frameIntervalUs + (interval - frameIntervalUs) / 16.0 : interval;
+    }
+    lastPts = pts;
+    hasPts = true;
+
+    // Sliding-window minimum: the least delayed frame sets the mapping
+    const int64_t offset = arrivalUs - pts;
+    const uint64_t current = sequence++;
+    while (!offsets.empty() && offsets.back().second >= offset) {
+        offsets.pop_back();
+    }
+    offsets.emplace_back(current, offset);
+    while (offsets.front().first + config.offsetWindow <= current) {
+        offsets.pop_front();
+    }
+
+    // Rise quickly with a burst, relax slowly once arrivals are even again
+    const double sample = static_cast<double>(offset - offsets.front().second);
+    jitterUs += (sample - jitterUs) / (sample > jitterUs ? 4.0 : 64.0);
+
+    const double ceiling = config.maxDelayFrames * frameIntervalUs;
+    stats.delayUs = static_cast<int64_t>(std::min(jitterUs, ceiling));
+}
+
+void FrameScheduler::resetClock() {
+    offsets.clear();
+    hasPts = false;
+}
+
+} // namespace mirrolink
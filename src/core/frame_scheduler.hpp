@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "frame_pool.hpp"
+
+namespace mirrolink {
+
+struct FrameSchedulerConfig {
+    // Most the jitter buffer may delay frames, in frame intervals. 0 shows
+    // every frame as soon as it arrives.
+    int maxDelayFrames = 1;
+    size_t capacity = 8;       // Frames held before the oldest is dropped
+    size_t offsetWindow = 120; // Frames over which the clock offset is tracked
+};
+
+struct FrameSchedulerStats {
+    uint64_t presented = 0;     // Frames handed to the renderer
+    uint64_t late = 0;          // Skipped because a newer frame was already due
+    uint64_t overflows = 0;     // Dropped because the buffer was full
+    size_t buffered = 0;        // Frames waiting for their presentation time
+    int64_t jitterUs = 0;       // Arrival jitter estimate
+    int64_t delayUs = 0;        // Delay the buffer currently adds
+    int64_t frameIntervalUs = 0;
+};
+
+// Paces presentation by stream time instead of arrival time. Device pts
+// are mapped to the host clock through the smallest arrival offset seen
+// recently, i.e. the least delayed frame; every frame is then shown at
+// its pts on that clock plus a delay that covers the observed jitter, up
+// to maxDelayFrames. Bursty arrivals come out evenly spaced again.
+// push() and next() may be called from different threads.
+class FrameScheduler {
+public:
+    using Clock = FrameTimestamps::Clock;
+
+    explicit FrameScheduler(const FrameSchedulerConfig& config = FrameSchedulerConfig());
+
+    void setConfig(const FrameSchedulerConfig& config);
+
+    // A frame arrived; frames without pts are shown as soon as possible
+    void push(const FrameRef& frame, Clock::time_point arrival = Clock::now());
+
+    // Pick the frame to show at displayTime: the newest one due by then,
+    // give or take half of tolerance (normally the refresh interval).
+    // Older due frames are skipped. Returns false to keep the current one.
+    bool next(Clock::time_point displayTime, Clock::duration tolerance, FrameRef& frame);
+
+    // Forget the clock mapping and all buffered frames
+    void reset();
+
+    FrameSchedulerStats getStats() const;
+
+private:
+    struct Entry {
+        FrameRef frame;
+        int64_t dueUs;
+    };
+
+    void updateClock(int64_t pts, int64_t arrivalUs);
+    void resetClock();
+
+    FrameSchedulerConfig config;
+    mutable std::mutex mutex;
+    std::deque<Entry> queue;
+
+    // Monotonic minimum of (arrival - pts) over the last offsetWindow frames
+    std::deque<std::pair<uint64_t, int64_t>> offsets;
+    uint64_t sequence = 0;
+    int64_t lastPts = 0;
+    bool hasPts = false;
+    double jitterUs = 0.0;
+    double frameIntervalUs = 0.0;
+
+    FrameSchedulerStats stats;
+};
+
+} // namespace mirrolink
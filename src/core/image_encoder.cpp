@@ -0,0 +1,231 @@
+#include "image_encoder.hpp"
+#include "color_convert.hpp"
+#include "../utils/logger.hpp"
+#include <cstring>
+#include <fstream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace mirrolink {
+
+namespace {
+
+struct QoiPixel {
+    uint8_t r, g, b, a;
+
+    bool operator==(const QoiPixel& other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+constexpr uint8_t kQoiOpIndex = 0x00;
+constexpr uint8_t kQoiOpDiff = 0x40;
+constexpr uint8_t kQoiOpLuma = 0x80;
+constexpr uint8_t kQoiOpRun = 0xc0;
+constexpr uint8_t kQoiOpRgb = 0xfe;
+constexpr uint8_t kQoiOpRgba = 0xff;
+
+void appendBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// One converter per encoding thread; single band, since the pool already
+// runs one encode per core
+ColorConverter& threadConverter() {
+    thread_local ColorConverter converter(1);
+    return converter;
+}
+
+} // namespace
+
+bool ImageEncoder::encode(const FrameData& frame, ImageFormat format, Screenshot& out) {
+    std::vector<uint8_t> rgba;
+    if (!toRgba(frame, rgba)) {
+        return false;
+    }
+
+    out.format = format;
+    out.width = frame.width;
+    out.height = frame.height;
+    out.timestamp = frame.timestamp;
+    out.data.clear();
+    if (format == ImageFormat::QOI) {
+        encodeQoi(rgba.data(), frame.width, frame.height, frame.width * 4, out.data);
+        return true;
+    }
+    return encodePng(rgba.data(), frame.width, frame.height, frame.width * 4, out.data);
+}
+
+bool ImageEncoder::toRgba(const FrameData& frame, std::vector<uint8_t>& rgba) {
+    if (frame.width <= 0 || frame.height <= 0 || !frame.planes[0]) {
+        return false;
+    }
+    const int rowBytes = frame.width * 4;
+    rgba.resize(static_cast<size_t>(rowBytes) * frame.height);
+
+    if (frame.format == PixelFormat::RGBA) {
+        for (int y = 0; y < frame.height; ++y) {
+            std::memcpy(rgba.data() + static_cast<size_t>(y) * rowBytes,
+                        frame.planes[0] + static_cast<size_t>(y) * frame.strides[0], rowBytes);
+        }
+        return true;
+    }
+
+    ColorConversion conversion;
+    conversion.matrix = frame.bt709 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+    conversion.range = frame.fullRange ? ColorRange::Full : ColorRange::Limited;
+
+    if (frame.format == PixelFormat::YUV420P) {
+        const uint8_t* const planes[3] = {frame.planes[0], frame.planes[1], frame.planes[2]};
+        threadConverter().convert(planes, frame.strides, frame.width, frame.height,
+                                  rgba.data(), rowBytes, conversion);
+        return true;
+    }
+
+    // NV12: split the interleaved chroma so the planar converter can use it
+    const int chromaWidth = (frame.width + 1) / 2;
+    const int chromaHeight = (frame.height + 1) / 2;
+    std::vector<uint8_t> chroma(static_cast<size_t>(chromaWidth) * chromaHeight * 2);
+    uint8_t* u = chroma.data();
+    uint8_t* v = u + static_cast<size_t>(chromaWidth) * chromaHeight;
+    for (int y = 0; y < chromaHeight; ++y) {
+        const uint8_t* src = frame.planes[1] + static_cast<size_t>(y) * frame.strides[1];
+        for (int x = 0; x < chromaWidth; ++x) {
+            u[y * chromaWidth + x] = src[2 * x];
+            v[y * chromaWidth + x] = src[2 * x + 1];
+        }
+    }
+    const uint8_t* const planes[3] = {frame.planes[0], u, v};
+    const int strides[3] = {frame.strides[0], chromaWidth, chromaWidth};
+    threadConverter().convert(planes, strides, frame.width, frame.height, rgba.data(), rowBytes, conversion);
+    return true;
+}
+
+bool ImageEncoder::encodePng(const uint8_t* rgba, int width, int height, int stride, std::vector<uint8_t>& out) {
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec) {
+        utils::Logger::getInstance().error("PNG encoder not available");
+        return false;
+    }
+
+    AVCodecContext* context = avcodec_alloc_context3(codec);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* packet = av_packet_alloc();
+    bool ok = false;
+    if (context && frame && packet) {
+        context->width = width;
+        context->height = height;
+        context->pix_fmt = AV_PIX_FMT_RGBA;
+        context->time_base = AVRational{1, 1};
+
+        // The encoder copies non-refcounted input, so the pixels can be
+        // borrowed
+        frame->data[0] = const_cast<uint8_t*>(rgba);
+        frame->linesize[0] = stride;
+        frame->width = width;
+        frame->height = height;
+        frame->format = AV_PIX_FMT_RGBA;
+
+        if (avcodec_open2(context, codec, nullptr) >= 0 &&
+            avcodec_send_frame(context, frame) >= 0 &&
+            avcodec_receive_packet(context, packet) >= 0) {
+            out.assign(packet->data, packet->data + packet->size);
+            ok = true;
+        }
+    }
+    if (!ok) {
+        utils::Logger::getInstance().error("PNG encoding failed");
+    }
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&context);
+    return ok;
+}
+
+void ImageEncoder::encodeQoi(const uint8_t* rgba, int width, int height, int stride, std::vector<uint8_t>& out) {
+    // Worst case is five bytes per pixel; typical screen content is far
+    // smaller, so reserve for the common case
+    out.clear();
+    out.reserve(14 + static_cast<size_t>(width) * height + 8);
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    appendBigEndian32(out, static_cast<uint32_t>(width));
+    appendBigEndian32(out, static_cast<uint32_t>(height));
+    out.push_back(4);  // RGBA
+    out.push_back(0);  // sRGB with linear alpha
+
+    QoiPixel seen[64]{};
+    QoiPixel previous{0, 0, 0, 255};
+    int run = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgba + static_cast<size_t>(y) * stride;
+        for (int x = 0; x < width; ++x) {
+            const QoiPixel pixel{row[4 * x], row[4 * x + 1], row[4 * x + 2], row[4 * x + 3]};
+            const bool last = y == height - 1 && x == width - 1;
+
+            if (pixel == previous) {
+                run++;
+                if (run == 62 || last) {
+                    out.push_back(static_cast<uint8_t>(kQoiOpRun | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                out.push_back(static_cast<uint8_t>(kQoiOpRun | (run - 1)));
+                run = 0;
+            }
+
+            const int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+            if (seen[hash] == pixel) {
+                out.push_back(static_cast<uint8_t>(kQoiOpIndex | hash));
+            } else {
+                seen[hash] = pixel;
+                if (pixel.a == previous.a) {
+                    const int dr = static_cast<int8_t>(pixel.r - previous.r);
+                    const int dg = static_cast<int8_t>(pixel.g - previous.g);
+                    const int db = static_cast<int8_t>(pixel.b - previous.b);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                        out.push_back(static_cast<uint8_t>(kQoiOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    } else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7) {
+                        out.push_back(static_cast<uint8_t>(kQoiOpLuma | (dg + 32)));
+                        out.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+                    } else {
+                        out.insert(out.end(), {kQoiOpRgb, pixel.r, pixel.g, pixel.b});
+                    }
+                } else {
+                    out.insert(out.end(), {kQoiOpRgba, pixel.r, pixel.g, pixel.b, pixel.a});
+                }
+            }
+            previous = pixel;
+        }
+    }
+
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+bool ImageEncoder::save(const Screenshot& screenshot, const std::string& path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        utils::Logger::getInstance().error("Could not write screenshot to ", path);
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(screenshot.data.data()),
+               static_cast<std::streamsize>(screenshot.data.size()));
+    return static_cast<bool>(file);
+}
+
+const char* ImageEncoder::extension(ImageFormat format) {
+    return format == ImageFormat::QOI ? ".qoi" : ".png";
+}
+
+} // namespace mirrolink
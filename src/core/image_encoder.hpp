@@ -0,0 +1,40 @@
+#pragma once
+
+#include "frame_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mirrolink {
+
+enum class ImageFormat {
+    PNG,  // Small files, slow to write
+    QOI   // Lossless like PNG, several times faster to encode
+};
+
+// An encoded still image
+struct Screenshot {
+    std::vector<uint8_t> data;
+    ImageFormat format = ImageFormat::PNG;
+    int width = 0;
+    int height = 0;
+    int64_t timestamp = 0;  // Stream pts of the captured frame
+};
+
+// Turns pipeline frames into image files. Everything here is stateless and
+// safe to call from several threads at once.
+class ImageEncoder {
+public:
+    static bool encode(const FrameData& frame, ImageFormat format, Screenshot& out);
+
+    // Packed RGBA copy of a frame in any PixelFormat
+    static bool toRgba(const FrameData& frame, std::vector<uint8_t>& rgba);
+
+    static bool encodePng(const uint8_t* rgba, int width, int height, int stride, std::vector<uint8_t>& out);
+    static void encodeQoi(const uint8_t* rgba, int width, int height, int stride, std::vector<uint8_t>& out);
+
+    static bool save(const Screenshot& screenshot, const std::string& path);
+    static const char* extension(ImageFormat format);
+};
+
+} // namespace mirrolink
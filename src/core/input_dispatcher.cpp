@@ -0,0 +1,231 @@
+#include "input_dispatcher.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace mirrolink {
+
+InputDispatcher::InputDispatcher(InputHandler& handler, size_t capacity)
+    : handler(handler)
+    , queue(capacity)
+{
+    batch.reserve(queue.capacity());
+    superseded.reserve(queue.capacity());
+    thread = std::thread(&InputDispatcher::dispatchLoop, this);
+}
+
+InputDispatcher::~InputDispatcher() {
+    running.store(false, std::memory_order_release);
+    pushed.notify();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void InputDispatcher::pushTouch(const TouchEvent& event) {
+    Event queued;
+    queued.type = EventType::Touch;
+    queued.touch = event;
+    push(queued);
+}
+
+void InputDispatcher::pushTouchMove(const TouchEvent& event) {
+    Event queued;
+    queued.type = EventType::TouchMove;
+    queued.touch = event;
+    push(queued);
+}
+
+void InputDispatcher::pushMultiTouch(const TouchEvent* events, size_t count) {
+    Event queued;
+    queued.type = EventType::MultiTouch;
+    queued.touchCount = std::min(count, queued.touches.size());
+    std::copy(events, events + queued.touchCount, queued.touches.begin());
+    push(queued);
+}
+
+void InputDispatcher::pushMultiTouchMove(const TouchEvent* events, size_t count) {
+    Event queued;
+    queued.type = EventType::MultiTouchMove;
+    queued.touchCount = std::min(count, queued.touches.size());
+    std::copy(events, events + queued.touchCount, queued.touches.begin());
+    push(queued);
+}
+
+void InputDispatcher::pushKey(const KeyboardEvent& event) {
+    Event queued;
+    queued.type = EventType::Key;
+    queued.key = event;
+    push(queued);
+}
+
+void InputDispatcher::pushScroll(const ScrollEvent& event) {
+    Event queued;
+    queued.type = EventType::Scroll;
+    queued.scroll = event;
+    push(queued);
+}
+
+InputDispatcherStats InputDispatcher::getStats() const {
+    InputDispatcherStats stats;
+    stats.received = received.load(std::memory_order_relaxed);
+    stats.dispatched = dispatched.load(std::memory_order_relaxed);
+    stats.moves = moves.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.lost = lost.load(std::memory_order_relaxed);
+    stats.queueDepth = queue.size();
+    if (stats.moves > 0) {
+        stats.coalescingRatio = static_cast<double>(stats.coalesced) / static_cast<double>(stats.moves);
+    }
+    return stats;
+}
+
+void InputDispatcher::push(const Event& event) {
+    received.fetch_add(1, std::memory_order_relaxed);
+    const bool move = event.type == EventType::TouchMove || event.type == EventType::MultiTouchMove;
+    if (move) {
+        moves.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (queue.tryPush(event)) {
+        pushed.notify();
+        return;
+    }
+
+    // A full queue means the device is far behind. A newer move will
+    // follow, but anything else should get through; the caller is the
+    // event loop, though, so it only waits so long for room.
+    if (move) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kFullQueueTimeoutMs);
+    while (!queue.tryPush(event)) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            lost.fetch_add(1, std::memory_order_relaxed);
+            utils::Logger::getInstance().error("Input queue full for ", kFullQueueTimeoutMs,
+                " ms, event lost");
+            return;
+        }
+        drained.wait([this]() { return queue.size() < queue.capacity(); },
+            std::chrono::ceil<std::chrono::milliseconds>(deadline - now));
+    }
+    pushed.notify();
+}
+
+void InputDispatcher::dispatchLoop() {
+    Event event;
+    while (true) {
+        // Checked before draining, so everything pushed before shutdown
+        // still goes out
+        const bool stopping = !running.load(std::memory_order_acquire);
+
+        while (batch.size() < queue.capacity() && queue.tryPop(event)) {
+            batch.push_back(event);
+        }
+        if (batch.empty()) {
+            if (stopping) {
+                return;
+            }
+            // Input arrives at human rates, so block rather than spin
+            pushed.wait([this]() {
+                return !queue.empty() || !running.load(std::memory_order_acquire);
+            }, std::chrono::milliseconds(100));
+            continue;
+        }
+        drained.notify();
+
+        // Everything that queued up while the last batch went out is
+        // delivered together, minus the moves that are already stale
+        coalesce();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!superseded[i]) {
+                dispatch(batch[i]);
+            }
+        }
+        batch.clear();
+    }
+}
+
+void InputDispatcher::coalesce() {
+    superseded.assign(batch.size(), false);
+    movingPointers.clear();
+
+    // Walking backwards, movingPointers holds the pointers with a later
+    // move and no press or release in between
+    for (size_t i = batch.size(); i-- > 0;) {
+        const Event& event = batch[i];
+        switch (event.type) {
+            case EventType::Touch:
+                forgetMoving(event.touch.id);
+                break;
+            case EventType::MultiTouch:
+                for (size_t t = 0; t < event.touchCount; ++t) {
+                    forgetMoving(event.touches[t].id);
+                }
+                break;
+            case EventType::TouchMove:
+                if (isMoving(event.touch.id)) {
+                    superseded[i] = true;
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    movingPointers.push_back(event.touch.id);
+                }
+                break;
+            case EventType::MultiTouchMove: {
+                bool stale = event.touchCount > 0;
+                for (size_t t = 0; t < event.touchCount; ++t) {
+                    stale = stale && isMoving(event.touches[t].id);
+                }
+                if (stale) {
+                    superseded[i] = true;
+                    coalesced.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                for (size_t t = 0; t < event.touchCount; ++t) {
+                    if (!isMoving(event.touches[t].id)) {
+                        movingPointers.push_back(event.touches[t].id);
+                    }
+                }
+                break;
+            }
+            case EventType::Key:
+            case EventType::Scroll:
+                break;
+        }
+    }
+}
+
+bool InputDispatcher::isMoving(uint32_t pointer) const {
+    return std::find(movingPointers.begin(), movingPointers.end(), pointer) != movingPointers.end();
+}
+
+void InputDispatcher::forgetMoving(uint32_t pointer) {
+    auto moving = std::find(movingPointers.begin(), movingPointers.end(), pointer);
+    if (moving != movingPointers.end()) {
+        movingPointers.erase(moving);
+    }
+}
+
+void InputDispatcher::dispatch(const Event& event) {
+    switch (event.type) {
+        case EventType::Touch:
+        case EventType::TouchMove:
+            handler.sendTouchEvent(event.touch);
+            break;
+        case EventType::MultiTouch:
+        case EventType::MultiTouchMove:
+            handler.sendMultiTouchEvents(event.touches.data(), event.touchCount);
+            break;
+        case EventType::Key:
+            handler.sendKeyEvent(event.key);
+            break;
+        case EventType::Scroll:
+            handler.sendScrollEvent(event.scroll);
+            break;
+    }
+    dispatched.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace mirrolink
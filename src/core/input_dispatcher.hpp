@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "input_handler.hpp"
+#include "../utils/mpsc_queue.hpp"
+#include "../utils/spsc_queue.hpp"
+
+namespace mirrolink {
+
+struct InputDispatcherStats {
+    uint64_t received = 0;    // Events pushed
+    uint64_t dispatched = 0;  // Events handed to the input handler
+    uint64_t moves = 0;       // Touch moves, single or multi, among the received events
+    uint64_t coalesced = 0;   // Moves replaced by a newer position of the same pointer
+    uint64_t dropped = 0;     // Moves lost to a full queue
+    uint64_t lost = 0;        // Other events given up on after the queue stayed full
+    size_t queueDepth = 0;    // Events waiting right now
+    double coalescingRatio = 0.0;  // coalesced / moves
+};
+
+// Sends input to the device from its own thread, so the thread handling
+// window events never waits on the device. Any thread may push. When the
+// device falls behind, queued moves of a pointer collapse into its latest
+// position; presses, releases, keys and scrolls are delivered in the order
+// they were pushed. A multi-touch move is only dropped once every one of
+// its pointers has moved again.
+class InputDispatcher {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+    // How long a press, release, key or scroll waits for room in a full
+    // queue before it is counted as lost
+    static constexpr int kFullQueueTimeoutMs = 100;
+
+    explicit InputDispatcher(InputHandler& handler, size_t capacity = kDefaultCapacity);
+    // Delivers what is still queued before returning
+    ~InputDispatcher();
+
+    InputDispatcher(const InputDispatcher&) = delete;
+    InputDispatcher& operator=(const InputDispatcher&) = delete;
+
+    // Touch down or up
+    void pushTouch(const TouchEvent& event);
+    // New position of a pointer that is down
+    void pushTouchMove(const TouchEvent& event);
+    // One frame of a multi-pointer gesture, delivered as one batch; at
+    // most InputHandler::kMaxPointers events
+    void pushMultiTouch(const TouchEvent* events, size_t count);
+    // New positions of pointers that are all down
+    void pushMultiTouchMove(const TouchEvent* events, size_t count);
+    void pushKey(const KeyboardEvent& event);
+    void pushScroll(const ScrollEvent& event);
+
+    InputDispatcherStats getStats() const;
+
+private:
+    enum class EventType : uint8_t {
+        Touch,
+        TouchMove,
+        MultiTouch,
+        MultiTouchMove,
+        Key,
+        Scroll
+    };
+
+    struct Event {
+        EventType type = EventType::Touch;
+        TouchEvent touch{};
+        std::array<TouchEvent, InputHandler::kMaxPointers> touches{};
+        size_t touchCount = 0;
+        KeyboardEvent key{};
+        ScrollEvent scroll{};
+    };
+
+    void push(const Event& event);
+    void dispatchLoop();
+    // Mark the moves in batch that later moves of the same pointers supersede
+    void coalesce();
+    bool isMoving(uint32_t pointer) const;
+    void forgetMoving(uint32_t pointer);
+    void dispatch(const Event& event);
+
+    InputHandler& handler;
+    utils::MpscQueue<Event> queue;
+    std::thread thread;
+    std::atomic<bool> running{true};
+    utils::WakeSignal pushed;  // Wakes the dispatcher thread
+    utils::WakeSignal drained; // Wakes pushers waiting for room
+
+    // Dispatcher thread only
+    std::vector<Event> batch;
+    std::vector<bool> superseded;
+    std::vector<uint32_t> movingPointers;
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> dispatched{0};
+    std::atomic<uint64_t> moves{0};
+    std::atomic<uint64_t> coalesced{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> lost{0};
+};
+
+} // namespace mirrolink
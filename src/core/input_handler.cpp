@@ -1,48 +1,70 @@
 #include "input_handler.hpp"
+#include "adb_client.hpp"
+#include "control_channel.hpp"
 #include "../utils/logger.hpp"
 #include "../utils/error.hpp"
 #include <json/json.h>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <map>
 #include <thread>
 #include <array>
 #include <sstream>
 #include <memory>
+#include <mutex>
 #include <cstdio>
 
 namespace mirrolink {
 
-class AdbCommand {
-public:
-    static std::string execute(const std::string& command, bool checkResult = true) {
-        std::array<char, 128> buffer;
-        std::string result;
-        
-        std::string fullCommand = "adb " + command;
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(
-            popen(fullCommand.c_str(), "r"), pclose);
-            
-        if (!pipe) {
-            throw utils::Error("Failed to execute ADB command: " + command);
-        }
-        
-        while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-            result += buffer.data();
-        }
-        
-        if (checkResult && result.find("error") != std::string::npos) {
-            throw utils::Error("ADB command failed: " + result);
+namespace {
+
+struct NamedKeycode {
+    const char* name;
+    uint32_t keycode;
+};
+
+// Android KEYCODE_* values for the names used in key mappings
+constexpr NamedKeycode kKeycodes[] = {
+    {"KEYCODE_HOME", 3}, {"KEYCODE_BACK", 4},
+    {"KEYCODE_DPAD_UP", 19}, {"KEYCODE_DPAD_DOWN", 20},
+    {"KEYCODE_DPAD_LEFT", 21}, {"KEYCODE_DPAD_RIGHT", 22},
+    {"KEYCODE_VOLUME_UP", 24}, {"KEYCODE_VOLUME_DOWN", 25}, {"KEYCODE_POWER", 26},
+    {"KEYCODE_TAB", 61}, {"KEYCODE_SPACE", 62}, {"KEYCODE_ENTER", 66}, {"KEYCODE_DEL", 67},
+    {"KEYCODE_BUTTON_A", 96}, {"KEYCODE_BUTTON_B", 97}, {"KEYCODE_BUTTON_X", 99},
+    {"KEYCODE_BUTTON_Y", 100}, {"KEYCODE_BUTTON_L1", 102}, {"KEYCODE_BUTTON_R1", 103},
+    {"KEYCODE_BUTTON_THUMBL", 106}, {"KEYCODE_BUTTON_THUMBR", 107},
+    {"KEYCODE_BUTTON_START", 108}, {"KEYCODE_BUTTON_SELECT", 109},
+    {"KEYCODE_ESCAPE", 111}, {"KEYCODE_VOLUME_MUTE", 164},
+    {"KEYCODE_APP_SWITCH", 187}, {"KEYCODE_WAKEUP", 224},
+};
+
+// Android KeyEvent.META_* flags
+constexpr uint32_t kMetaShiftOn = 0x1;
+constexpr uint32_t kMetaAltOn = 0x2;
+constexpr uint32_t kMetaCtrlOn = 0x1000;
+
+static_assert(InputHandler::kMaxPointers <= ControlChannel::kMaxTouchBatch,
+              "a full gesture must fit into one batch");
+
+bool findKeycode(const std::string& name, uint32_t& keycode) {
+    for (const auto& entry : kKeycodes) {
+        if (name == entry.name) {
+            keycode = entry.keycode;
+            return true;
         }
-        
-        return result;
     }
-};
+    return false;
+}
+
+} // namespace
 
 class InputHandler::Impl {
 public:
     Impl() {
         // Initialize default key mappings
         initializeDefaultMappings();
+        pointersDown.reserve(InputHandler::kMaxPointers);
         
         // Verify ADB is available
         try {
@@ -52,7 +74,16 @@ public:
         }
     }
     
+    void setControlChannel(ControlChannel* channel) {
+        controlChannel = channel;
+    }
+    
     void sendTouchEvent(const TouchEvent& event) {
+        if (ControlChannel* control = connectedChannel()) {
+            injectTouch(*control, event);
+            return;
+        }
+        
         try {
             // Convert screen coordinates to Android coordinates
             int x = static_cast<int>(event.x * screenWidth);
@@ -69,27 +100,112 @@ public:
         }
     }
     
-    void sendKeyEvent(const KeyboardEvent& event) {
+    void sendMultiTouchEvents(const TouchEvent* events, size_t count) {
+        ControlChannel* control = connectedChannel();
+        if (!control) {
+            for (size_t i = 0; i < count; ++i) {
+                sendTouchEvent(events[i]);
+            }
+            return;
+        }
+        
+        TouchMessage messages[InputHandler::kMaxPointers];
+        size_t batched = 0;
+        for (size_t i = 0; i < count && batched < InputHandler::kMaxPointers; ++i) {
+            if (toTouchMessage(*control, events[i], messages[batched])) {
+                batched++;
+            }
+        }
+        if (batched > 0 && !control->injectTouches(messages, batched)) {
+            utils::Logger::getInstance().warn("Failed to inject multi-touch event");
+        }
+    }
+    
+    void sendScrollEvent(const ScrollEvent& event) {
+        if (ControlChannel* control = connectedChannel()) {
+            ScrollMessage message;
+            message.position = toPosition(*control, event.x, event.y);
+            message.hscroll = event.hscroll;
+            message.vscroll = event.vscroll;
+            if (!control->injectScroll(message)) {
+                utils::Logger::getInstance().warn("Failed to inject scroll event");
+            }
+            return;
+        }
+        
         try {
-            auto it = keyMap.find(event.keycode);
-            if (it != keyMap.end()) {
-                std::stringstream ss;
-                ss << "shell input keyevent ";
-                
-                if (event.ctrl) ss << "CTRL ";
-                if (event.alt) ss << "ALT ";
-                if (event.shift) ss << "SHIFT ";
-                
-                ss << it->second;
-                
-                AdbCommand::execute(ss.str());
+            AdbCommand::execute("shell input roll " + std::to_string(static_cast<int>(event.hscroll)) + " " +
+                std::to_string(static_cast<int>(-event.vscroll)));
+        } catch (const utils::Error& e) {
+            utils::Logger::getInstance().error("Failed to send scroll event: ", e.what());
+        }
+    }
+    
+    void sendKeyEvent(const KeyboardEvent& event) {
+        auto mapping = keyMap.find(event.keycode);
+        if (mapping == keyMap.end()) {
+            return;
+        }
+        
+        uint32_t keycode = 0;
+        ControlChannel* control = connectedChannel();
+        if (control && findKeycode(mapping->second, keycode)) {
+            KeycodeMessage message;
+            message.action = event.pressed ? KeyAction::Down : KeyAction::Up;
+            message.keycode = keycode;
+            message.metaState = (event.shift ? kMetaShiftOn : 0) | (event.alt ? kMetaAltOn : 0) |
+                                (event.ctrl ? kMetaCtrlOn : 0);
+            if (!control->injectKeycode(message)) {
+                utils::Logger::getInstance().warn("Failed to inject key event");
             }
+            return;
+        }
+        
+        // `input keyevent` presses and releases in one go
+        if (!event.pressed) {
+            return;
+        }
+        
+        try {
+            std::stringstream ss;
+            ss << "shell input keyevent ";
+            
+            if (event.ctrl) ss << "CTRL ";
+            if (event.alt) ss << "ALT ";
+            if (event.shift) ss << "SHIFT ";
+            
+            ss << mapping->second;
+            
+            AdbCommand::execute(ss.str());
         } catch (const utils::Error& e) {
             utils::Logger::getInstance().error("Failed to send key event: ", e.what());
         }
     }
     
     void sendText(const std::string& text) {
+        if (ControlChannel* control = connectedChannel()) {
+            // The server takes a limited length per message; split between
+            // UTF-8 sequences
+            size_t offset = 0;
+            while (offset < text.size()) {
+                size_t length = std::min(text.size() - offset, ControlChannel::kMaxTextLength);
+                size_t boundary = length;
+                while (offset + boundary < text.size() && boundary > 0 &&
+                       (static_cast<uint8_t>(text[offset + boundary]) & 0xC0) == 0x80) {
+                    boundary--;
+                }
+                if (boundary > 0) {
+                    length = boundary;
+                }
+                if (!control->injectText(text.data() + offset, length)) {
+                    utils::Logger::getInstance().warn("Failed to inject text");
+                    return;
+                }
+                offset += length;
+            }
+            return;
+        }
+        
         try {
             std::string escapedText = escapeString(text);
             AdbCommand::execute("shell input text '" + escapedText + "'");
@@ -99,67 +215,35 @@ public:
     }
     
     void sendHome() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_HOME");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send HOME: ", e.what());
-        }
+        sendKey("KEYCODE_HOME");
     }
     
     void sendBack() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_BACK");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send BACK: ", e.what());
-        }
+        sendKey("KEYCODE_BACK");
     }
     
     void sendAppSwitch() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_APP_SWITCH");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send APP_SWITCH: ", e.what());
-        }
+        sendKey("KEYCODE_APP_SWITCH");
     }
     
     void sendVolumeUp() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_VOLUME_UP");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send VOLUME_UP: ", e.what());
-        }
+        sendKey("KEYCODE_VOLUME_UP");
     }
     
     void sendVolumeDown() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_VOLUME_DOWN");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send VOLUME_DOWN: ", e.what());
-        }
+        sendKey("KEYCODE_VOLUME_DOWN");
     }
     
     void sendVolumeMute() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_VOLUME_MUTE");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send VOLUME_MUTE: ", e.what());
-        }
+        sendKey("KEYCODE_VOLUME_MUTE");
     }
     
     void sendPower() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_POWER");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send POWER: ", e.what());
-        }
+        sendKey("KEYCODE_POWER");
     }
     
     void sendWake() {
-        try {
-            AdbCommand::execute("shell input keyevent KEYCODE_WAKEUP");
-        } catch (const utils::Error& e) {
-            utils::Logger::getInstance().error("Failed to send WAKEUP: ", e.what());
-        }
+        sendKey("KEYCODE_WAKEUP");
     }
     
     bool sendClipboardText(const std::string& text) {
@@ -287,7 +371,14 @@ public:
             }
 
             // Send digital button events
-            if (event.pressed) {
+            uint32_t androidKeycode = 0;
+            ControlChannel* control = connectedChannel();
+            if (control && findKeycode(keycode, androidKeycode)) {
+                KeycodeMessage message;
+                message.action = event.pressed ? KeyAction::Down : KeyAction::Up;
+                message.keycode = androidKeycode;
+                control->injectKeycode(message);
+            } else if (event.pressed) {
                 AdbCommand::execute("shell input keyevent " + keycode);
             }
         } catch (const utils::Error& e) {
@@ -296,6 +387,85 @@ public:
     }
 
 private:
+    // The control socket, while the mirroring session has it open
+    ControlChannel* connectedChannel() const {
+        ControlChannel* control = controlChannel;
+        return control && control->isConnected() ? control : nullptr;
+    }
+    
+    // Normalized coordinates to a position in the video the device sends
+    ControlPosition toPosition(const ControlChannel& control, float x, float y) const {
+        ControlPosition position;
+        control.getScreenSize(position.screenWidth, position.screenHeight);
+        const float clampedX = std::min(std::max(x, 0.0f), 1.0f);
+        const float clampedY = std::min(std::max(y, 0.0f), 1.0f);
+        position.x = std::min(static_cast<int32_t>(clampedX * position.screenWidth),
+                              std::max<int32_t>(position.screenWidth - 1, 0));
+        position.y = std::min(static_cast<int32_t>(clampedY * position.screenHeight),
+                              std::max<int32_t>(position.screenHeight - 1, 0));
+        return position;
+    }
+    
+    // Fill in message for event; false if the event has no effect, e.g.
+    // the release of a pointer that never went down
+    bool toTouchMessage(const ControlChannel& control, const TouchEvent& event, TouchMessage& message) {
+        // The dispatcher and the latency probe inject from their own threads
+        std::lock_guard<std::mutex> lock(pointerMutex);
+        // Another press on a pointer that is already down continues its drag
+        auto down = std::find(pointersDown.begin(), pointersDown.end(), event.id);
+        if (event.pressed) {
+            if (down == pointersDown.end()) {
+                if (pointersDown.size() >= InputHandler::kMaxPointers) {
+                    return false;
+                }
+                pointersDown.push_back(event.id);
+                message.action = TouchAction::Down;
+            } else {
+                message.action = TouchAction::Move;
+            }
+            message.pressure = 1.0f;
+        } else {
+            if (down == pointersDown.end()) {
+                return false;
+            }
+            pointersDown.erase(down);
+            message.action = TouchAction::Up;
+            message.pressure = 0.0f;
+        }
+        message.pointerId = event.id;
+        message.position = toPosition(control, event.x, event.y);
+        return true;
+    }
+    
+    void injectTouch(ControlChannel& control, const TouchEvent& event) {
+        TouchMessage message;
+        if (toTouchMessage(control, event, message) && !control.injectTouch(message)) {
+            utils::Logger::getInstance().warn("Failed to inject touch event");
+        }
+    }
+    
+    // Press and release a key by its KEYCODE_* name
+    void sendKey(const std::string& name) {
+        uint32_t keycode = 0;
+        ControlChannel* control = connectedChannel();
+        if (control && findKeycode(name, keycode)) {
+            KeycodeMessage message;
+            message.keycode = keycode;
+            message.action = KeyAction::Down;
+            const bool pressed = control->injectKeycode(message);
+            message.action = KeyAction::Up;
+            if (pressed && control->injectKeycode(message)) {
+                return;
+            }
+        }
+        
+        try {
+            AdbCommand::execute("shell input keyevent " + name);
+        } catch (const utils::Error& e) {
+            utils::Logger::getInstance().error("Failed to send ", name, ": ", e.what());
+        }
+    }
+    
     void initializeDefaultMappings() {
         // Mac keyboard to Android key mappings
         keyMap = {
@@ -324,6 +494,9 @@ private:
     }
     
     std::map<uint32_t, std::string> keyMap;
+    std::atomic<ControlChannel*> controlChannel{nullptr};
+    std::mutex pointerMutex;
+    std::vector<uint32_t> pointersDown;  // Touches sent down and not yet up
     float currentX = 0;
     float currentY = 0;
     int screenWidth = 1920;  // Default, should be updated with actual screen size
@@ -334,14 +507,24 @@ private:
 InputHandler::InputHandler() : pimpl(std::make_unique<Impl>()) {}
 InputHandler::~InputHandler() = default;
 
+void InputHandler::setControlChannel(ControlChannel* channel) {
+    pimpl->setControlChannel(channel);
+}
+
 void InputHandler::sendTouchEvent(const TouchEvent& event) {
     pimpl->sendTouchEvent(event);
 }
 
 void InputHandler::sendMultiTouchEvents(const std::vector<TouchEvent>& events) {
-    for (const auto& event : events) {
-        sendTouchEvent(event);
-    }
+    pimpl->sendMultiTouchEvents(events.data(), events.size());
+}
+
+void InputHandler::sendMultiTouchEvents(const TouchEvent* events, size_t count) {
+    pimpl->sendMultiTouchEvents(events, count);
+}
+
+void InputHandler::sendScrollEvent(const ScrollEvent& event) {
+    pimpl->sendScrollEvent(event);
 }
 
 void InputHandler::sendKeyEvent(const KeyboardEvent& event) {
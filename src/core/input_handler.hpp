@@ -1,11 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace mirrolink {
 
+class ControlChannel;
+
 struct TouchEvent {
     uint32_t id;
     float x;
@@ -13,6 +17,14 @@ struct TouchEvent {
     bool pressed;
 };
 
+// Wheel movement at a normalized position, in notches
+struct ScrollEvent {
+    float x;
+    float y;
+    float hscroll;
+    float vscroll;
+};
+
 struct KeyboardEvent {
     uint32_t keycode;
     bool pressed;
@@ -29,12 +41,24 @@ struct GamepadEvent {
 
 class InputHandler {
 public:
+    // Pointers Android tracks in one gesture
+    static constexpr size_t kMaxPointers = 10;
+
     InputHandler();
     ~InputHandler();
 
+    // Inject events as scrcpy control messages while the channel is
+    // connected, instead of running `adb shell input` for each one.
+    // A pressed touch on a pointer that is already down moves it.
+    void setControlChannel(ControlChannel* channel);
+
     // Touch input handling
     void sendTouchEvent(const TouchEvent& event);
+    // One frame of a multi-pointer gesture, injected as a single batch so
+    // the pointers move together; ids must stay the same across frames
     void sendMultiTouchEvents(const std::vector<TouchEvent>& events);
+    void sendMultiTouchEvents(const TouchEvent* events, size_t count);
+    void sendScrollEvent(const ScrollEvent& event);
     
     // Keyboard input
     void sendKeyEvent(const KeyboardEvent& event);
@@ -69,4 +93,6 @@ public:
 private:
     class Impl;
     std::unique_ptr<Impl> pimpl;
-};
\ No newline at end of file
+};
+
+} // namespace mirrolink
@@ -0,0 +1,115 @@
+#include "keyframe_index.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace mirrolink {
+
+namespace {
+
+constexpr char kMagic[4] = {'M', 'L', 'K', 'I'};
+
+void putLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getLittleEndian(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+} // namespace
+
+KeyframeIndexWriter::~KeyframeIndexWriter() {
+    close();
+}
+
+bool KeyframeIndexWriter::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        utils::Logger::getInstance().warn("Could not create keyframe index ", path);
+        return false;
+    }
+
+    uint8_t header[KeyframeIndex::kHeaderSize]{};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    putLittleEndian(header + 4, KeyframeIndex::kVersion, 4);
+    putLittleEndian(header + 8, KeyframeIndex::kRecordSize, 4);
+    if (std::fwrite(header, sizeof(header), 1, file) != 1) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool KeyframeIndexWriter::append(const KeyframeEntry& entry) {
+    if (!file) {
+        return false;
+    }
+
+    uint8_t record[KeyframeIndex::kRecordSize];
+    putLittleEndian(record, static_cast<uint64_t>(entry.ptsUs), 8);
+    putLittleEndian(record + 8, entry.byteOffset, 8);
+    putLittleEndian(record + 16, entry.frameNumber, 8);
+    // One small write per keyframe, about once a second
+    return std::fwrite(record, sizeof(record), 1, file) == 1 && std::fflush(file) == 0;
+}
+
+void KeyframeIndexWriter::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool KeyframeIndex::load(const std::string& path) {
+    entries.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.size() < kHeaderSize || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+        utils::Logger::getInstance().warn("Not a keyframe index: ", path);
+        return false;
+    }
+    const uint32_t version = static_cast<uint32_t>(getLittleEndian(bytes.data() + 4, 4));
+    const size_t recordSize = static_cast<size_t>(getLittleEndian(bytes.data() + 8, 4));
+    if (version != kVersion || recordSize < kRecordSize) {
+        utils::Logger::getInstance().warn("Unsupported keyframe index version ", version, ": ", path);
+        return false;
+    }
+
+    const size_t count = (bytes.size() - kHeaderSize) / recordSize;
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* record = bytes.data() + kHeaderSize + i * recordSize;
+        KeyframeEntry entry;
+        entry.ptsUs = static_cast<int64_t>(getLittleEndian(record, 8));
+        entry.byteOffset = getLittleEndian(record + 8, 8);
+        entry.frameNumber = getLittleEndian(record + 16, 8);
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+const KeyframeEntry* KeyframeIndex::find(int64_t timeUs) const {
+    if (entries.empty()) {
+        return nullptr;
+    }
+    auto it = std::upper_bound(entries.begin(), entries.end(), timeUs,
+        [](int64_t time, const KeyframeEntry& entry) { return time < entry.ptsUs; });
+    return it == entries.begin() ? &entries.front() : &*std::prev(it);
+}
+
+} // namespace mirrolink
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace mirrolink {
+
+// One keyframe of a recording
+struct KeyframeEntry {
+    int64_t ptsUs = 0;        // Microseconds from the start of the file
+    uint64_t byteOffset = 0;  // Start of the cluster or fragment holding the keyframe
+    uint64_t frameNumber = 0; // Packets written before it
+};
+
+// Sidecar index written next to a recording (<video>.idx). The file is a
+// 16-byte header ("MLKI", version, record size, reserved; little-endian
+// uint32s) followed by one fixed-size record per keyframe, so a partial
+// last record after a crash is simply ignored.
+class KeyframeIndexWriter {
+public:
+    KeyframeIndexWriter() = default;
+    ~KeyframeIndexWriter();
+
+    KeyframeIndexWriter(const KeyframeIndexWriter&) = delete;
+    KeyframeIndexWriter& operator=(const KeyframeIndexWriter&) = delete;
+
+    bool open(const std::string& path);
+    // Written through to the file, so the index is usable while the
+    // recording is still going
+    bool append(const KeyframeEntry& entry);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+private:
+    std::FILE* file = nullptr;
+};
+
+class KeyframeIndex {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kHeaderSize = 16;
+    static constexpr size_t kRecordSize = 24;
+
+    static std::string pathFor(const std::string& videoPath) { return videoPath + ".idx"; }
+
+    bool load(const std::string& path);
+
+    // Last keyframe at or before timeUs (the first one if timeUs is
+    // earlier than every keyframe); null if the index is empty
+    const KeyframeEntry* find(int64_t timeUs) const;
+
+    const std::vector<KeyframeEntry>& getEntries() const { return entries; }
+    bool empty() const { return entries.empty(); }
+
+private:
+    std::vector<KeyframeEntry> entries;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,232 @@
+#include "latency_probe.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace mirrolink {
+
+namespace {
+
+// Upper bound on pixels sampled per frame, so a large region stays cheap
+constexpr int64_t kMaxSamples = 16384;
+
+int64_t elapsedMicros(LatencyProbe::Clock::time_point from, LatencyProbe::Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+bool differs(const LatencyProbe::Signature& a, const LatencyProbe::Signature& b, int threshold) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])) >= threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+LatencyProbe::~LatencyProbe() {
+    stop();
+}
+
+bool LatencyProbe::start(const LatencyProbeConfig& newConfig, Stimulus newStimulus, Finished newFinished) {
+    const bool validRegion = newConfig.regionX >= 0.0f && newConfig.regionY >= 0.0f &&
+        newConfig.regionWidth > 0.0f && newConfig.regionHeight > 0.0f &&
+        newConfig.regionX + newConfig.regionWidth <= 1.0f && newConfig.regionY + newConfig.regionHeight <= 1.0f;
+    // Keycode 0 is no key at all; the probe would only ever miss
+    const bool validKey = newConfig.stimulus != ProbeStimulus::Key || newConfig.keycode != 0;
+    if (!validRegion || !validKey || newConfig.threshold <= 0 || newConfig.intervalMs < 0 ||
+        newConfig.timeoutMs <= 0 || !newStimulus) {
+        utils::Logger::getInstance().error("Invalid latency probe configuration");
+        return false;
+    }
+
+    if (running) {
+        utils::Logger::getInstance().warn("Latency probe already running");
+        return false;
+    }
+    // A run that ended by itself still has its thread to collect
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        config = newConfig;
+        stimulus = std::move(newStimulus);
+        finished = std::move(newFinished);
+        hasSignature = false;
+        pending = false;
+        awaitingPresent = false;
+        probes = 0;
+        detected = 0;
+        missed = 0;
+        frameLatency.reset();
+        photonLatency.reset();
+        running = true;
+    }
+    thread = std::thread(&LatencyProbe::probeLoop, this);
+    return true;
+}
+
+void LatencyProbe::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool LatencyProbe::isRunning() const {
+    return running;
+}
+
+void LatencyProbe::onFrame(const FrameData& frame) {
+    if (!running) {
+        return;
+    }
+
+    LatencyProbeConfig region;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        region = config;
+    }
+    Signature signature;
+    computeSignature(frame, region, signature);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    current = signature;
+    hasSignature = true;
+
+    // Frames converted before the input went out cannot answer it
+    if (!pending || frame.timestamps.converted < injectedAt) {
+        return;
+    }
+    if (!differs(signature, baseline, config.threshold)) {
+        return;
+    }
+
+    pending = false;
+    detected++;
+    const Clock::time_point converted = frame.timestamps.converted;
+    frameLatency.record(elapsedMicros(injectedAt, converted));
+    awaitingPresent = true;
+    answerConverted = converted;
+    answerInjectedAt = injectedAt;
+    wake.notify_all();
+}
+
+void LatencyProbe::onPresented(const FrameTimestamps& timestamps) {
+    if (!running) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    // The answering frame itself may be skipped by the renderer; a newer
+    // one shows the change just as well
+    if (awaitingPresent && timestamps.converted >= answerConverted) {
+        photonLatency.record(elapsedMicros(answerInjectedAt, timestamps.presented));
+        awaitingPresent = false;
+    }
+}
+
+LatencyProbeStats LatencyProbe::getStats() const {
+    LatencyProbeStats stats;
+    stats.running = running;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.probes = probes;
+        stats.detected = detected;
+        stats.missed = missed;
+    }
+    stats.inputToFrame = frameLatency.summary();
+    stats.inputToPhoton = photonLatency.summary();
+    return stats;
+}
+
+void LatencyProbe::computeSignature(const FrameData& frame, const LatencyProbeConfig& config, Signature& signature) {
+    signature.fill(0);
+    const int x0 = std::clamp(static_cast<int>(config.regionX * frame.width), 0, frame.width);
+    const int y0 = std::clamp(static_cast<int>(config.regionY * frame.height), 0, frame.height);
+    const int x1 = std::clamp(static_cast<int>((config.regionX + config.regionWidth) * frame.width), x0, frame.width);
+    const int y1 = std::clamp(static_cast<int>((config.regionY + config.regionHeight) * frame.height), y0, frame.height);
+    if (x1 - x0 < kGrid || y1 - y0 < kGrid || !frame.planes[0]) {
+        return;
+    }
+
+    const int64_t area = static_cast<int64_t>(x1 - x0) * (y1 - y0);
+    const int step = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(area) / kMaxSamples)));
+    const bool rgba = frame.format == PixelFormat::RGBA;
+
+    for (int cellY = 0; cellY < kGrid; ++cellY) {
+        const int top = y0 + (y1 - y0) * cellY / kGrid;
+        const int bottom = y0 + (y1 - y0) * (cellY + 1) / kGrid;
+        for (int cellX = 0; cellX < kGrid; ++cellX) {
+            const int left = x0 + (x1 - x0) * cellX / kGrid;
+            const int right = x0 + (x1 - x0) * (cellX + 1) / kGrid;
+
+            uint32_t sum = 0;
+            uint32_t count = 0;
+            for (int y = top; y < bottom; y += step) {
+                const uint8_t* row = frame.planes[0] + static_cast<ptrdiff_t>(y) * frame.strides[0];
+                for (int x = left; x < right; x += step) {
+                    if (rgba) {
+                        const uint8_t* pixel = row + x * 4;
+                        sum += (77u * pixel[0] + 150u * pixel[1] + 29u * pixel[2]) >> 8;
+                    } else {
+                        // YUV formats: the first plane is luma
+                        sum += row[x];
+                    }
+                    count++;
+                }
+            }
+            signature[cellY * kGrid + cellX] = static_cast<uint8_t>(count > 0 ? sum / count : 0);
+        }
+    }
+}
+
+void LatencyProbe::probeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running && (config.samples <= 0 || probes < static_cast<uint64_t>(config.samples))) {
+        // Let the screen settle from the previous input
+        if (wake.wait_for(lock, std::chrono::milliseconds(config.intervalMs), [this]() { return !running; })) {
+            break;
+        }
+        if (!hasSignature) {
+            continue;
+        }
+
+        baseline = current;
+        pending = true;
+        probes++;
+        injectedAt = Clock::now();
+        lock.unlock();
+        stimulus();
+        lock.lock();
+
+        const bool answered = wake.wait_for(lock, std::chrono::milliseconds(config.timeoutMs),
+            [this]() { return !pending || !running; });
+        if (!answered || pending) {
+            // Cut short by stop() is not a miss
+            if (running) {
+                missed++;
+            } else {
+                probes--;
+            }
+            pending = false;
+        }
+    }
+    running = false;
+    const Finished done = std::move(finished);
+    finished = nullptr;
+    lock.unlock();
+    if (done) {
+        done();
+    }
+}
+
+} // namespace mirrolink
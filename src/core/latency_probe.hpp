@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "frame_pool.hpp"
+#include "../utils/latency_histogram.hpp"
+
+namespace mirrolink {
+
+enum class ProbeStimulus {
+    Tap,  // Touch down and up at the center of the region
+    Key   // Press and release of LatencyProbeConfig::keycode
+};
+
+struct LatencyProbeConfig {
+    // Part of the screen that answers the input, normalized to the frame.
+    // With taps, Android's "show taps" dot under the finger is enough.
+    float regionX = 0.4f;
+    float regionY = 0.4f;
+    float regionWidth = 0.2f;
+    float regionHeight = 0.2f;
+    ProbeStimulus stimulus = ProbeStimulus::Tap;
+    uint32_t keycode = 0;   // KeyboardEvent keycode; required for ProbeStimulus::Key
+    int threshold = 24;     // Change in mean luma of any region cell that counts as the answer
+    int intervalMs = 1000;  // Pause between probes so the screen settles
+    int timeoutMs = 2000;   // Probes not answered by then count as missed
+    int samples = 0;        // Probes to run; 0 runs until stop()
+};
+
+struct LatencyProbeStats {
+    bool running = false;
+    uint64_t probes = 0;    // Inputs injected
+    uint64_t detected = 0;  // Answered by a change in the region
+    uint64_t missed = 0;    // No change before the timeout
+    utils::LatencySummary inputToFrame;   // Injection -> first changed frame converted
+    utils::LatencySummary inputToPhoton;  // Injection -> that frame presented
+};
+
+// Measures what users feel: the time from an input to its effect on
+// screen. The probe injects a synthetic input from its own thread through
+// the stimulus callback, then watches the region of every decoded frame
+// for the first one that differs from the frame shown when the input went
+// out. That frame's presentation, reported by the renderer, closes the
+// input-to-photon measurement.
+class LatencyProbe {
+public:
+    using Clock = FrameTimestamps::Clock;
+    using Stimulus = std::function<void()>;
+    using Finished = std::function<void()>;
+
+    // Mean luma of each cell of a kGrid x kGrid split of the region
+    static constexpr int kGrid = 8;
+    using Signature = std::array<uint8_t, kGrid * kGrid>;
+
+    LatencyProbe() = default;
+    ~LatencyProbe();
+
+    LatencyProbe(const LatencyProbe&) = delete;
+    LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+    // Start probing; fails on an invalid config or while already running.
+    // Results of earlier runs are cleared. finished runs on the probe
+    // thread when the run ends, by itself or through stop().
+    bool start(const LatencyProbeConfig& config, Stimulus stimulus, Finished finished = nullptr);
+    void stop();
+    bool isRunning() const;
+
+    // Every converted frame, from the capture thread
+    void onFrame(const FrameData& frame);
+
+    // A frame reached the screen, from the render thread
+    void onPresented(const FrameTimestamps& timestamps);
+
+    LatencyProbeStats getStats() const;
+
+    const utils::LatencyHistogram& getFrameLatency() const { return frameLatency; }
+    const utils::LatencyHistogram& getPhotonLatency() const { return photonLatency; }
+
+    static void computeSignature(const FrameData& frame, const LatencyProbeConfig& config, Signature& signature);
+
+private:
+    void probeLoop();
+
+    LatencyProbeConfig config;
+    Stimulus stimulus;
+    Finished finished;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    Signature current{};
+    Signature baseline{};
+    bool hasSignature = false;
+    bool pending = false;            // Input sent, no answer yet
+    Clock::time_point injectedAt;
+    bool awaitingPresent = false;    // Answer found, waiting for it on screen
+    Clock::time_point answerConverted;
+    Clock::time_point answerInjectedAt;
+    uint64_t probes = 0;
+    uint64_t detected = 0;
+    uint64_t missed = 0;
+
+    utils::LatencyHistogram frameLatency;
+    utils::LatencyHistogram photonLatency;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,46 @@
+#include "load_shedder.hpp"
+
+namespace mirrolink {
+
+SkipLevel LoadShedder::update(int64_t lagMs) {
+    // Dropping to the next keyframe ends only when it arrives
+    if (level == SkipLevel::UntilKeyframe) {
+        return level;
+    }
+
+    if (config.skipToKeyframe && lagMs >= config.keyframeLagMs) {
+        level = SkipLevel::UntilKeyframe;
+        keyframeEpisodes++;
+        calmPackets = 0;
+        return level;
+    }
+
+    if (level == SkipLevel::None) {
+        if (lagMs >= config.nonReferenceLagMs) {
+            level = SkipLevel::NonReference;
+            nonReferenceEpisodes++;
+            calmPackets = 0;
+        }
+        return level;
+    }
+
+    if (lagMs < config.recoverLagMs) {
+        if (++calmPackets >= config.recoverPackets) {
+            level = SkipLevel::None;
+            calmPackets = 0;
+        }
+    } else {
+        calmPackets = 0;
+    }
+    return level;
+}
+
+void LoadShedder::keyframeReached() {
+    if (level == SkipLevel::UntilKeyframe) {
+        // Keep skipping non-reference frames until the lag has settled
+        level = SkipLevel::NonReference;
+        calmPackets = 0;
+    }
+}
+
+} // namespace mirrolink
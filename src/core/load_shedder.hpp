@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace mirrolink {
+
+// How much of the stream the decoder throws away
+enum class SkipLevel {
+    None,           // Decode everything
+    NonReference,   // Skip frames no other frame depends on (skip_frame = AVDISCARD_NONREF)
+    UntilKeyframe   // Drop every packet up to the next keyframe
+};
+
+struct LoadShedderConfig {
+    int64_t nonReferenceLagMs = 100;  // Start skipping non-reference frames
+    int64_t keyframeLagMs = 500;      // Give up on the backlog and wait for a keyframe
+    int64_t recoverLagMs = 30;        // Decode everything again once below this...
+    int recoverPackets = 30;          // ...for this many packets in a row
+    // Only drop to a keyframe that was asked for. The encoder's own
+    // keyframe interval can be seconds, so without a way to request one
+    // shedding stops at NonReference.
+    bool skipToKeyframe = true;
+};
+
+// Decides when the decoder should shed load, from how far behind live the
+// packet being decoded is. Levels go up as soon as the lag crosses a
+// threshold but only come down after a run of packets well under it, so
+// a pipeline hovering at the limit does not flap between levels.
+class LoadShedder {
+public:
+    explicit LoadShedder(const LoadShedderConfig& config = LoadShedderConfig()) : config(config) {}
+
+    // Feed the lag of the next packet; returns the level to decode it at
+    SkipLevel update(int64_t lagMs);
+
+    // The decoder reached a keyframe while dropping packets
+    void keyframeReached();
+
+    // Whether keyframes can be requested right now; see skipToKeyframe
+    void setSkipToKeyframe(bool enabled) { config.skipToKeyframe = enabled; }
+
+    SkipLevel getLevel() const { return level; }
+    uint64_t getNonReferenceEpisodes() const { return nonReferenceEpisodes; }
+    uint64_t getKeyframeEpisodes() const { return keyframeEpisodes; }
+
+private:
+    LoadShedderConfig config;
+    SkipLevel level = SkipLevel::None;
+    int calmPackets = 0;
+    uint64_t nonReferenceEpisodes = 0;
+    uint64_t keyframeEpisodes = 0;
+};
+
+} // namespace mirrolink
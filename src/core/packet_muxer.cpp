@@ -0,0 +1,345 @@
+#include "packet_muxer.hpp"
+#include "keyframe_index.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
+#include <libavformat/avformat.h>
+}
+
+namespace mirrolink {
+
+namespace {
+
+// scrcpy timestamps are in microseconds
+constexpr AVRational kPacketTimeBase = {1, 1000000};
+
+std::string errorString(int error) {
+    char buffer[128];
+    av_strerror(error, buffer, sizeof(buffer));
+    return buffer;
+}
+
+// The write callback's buffer became const in libavformat 61
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+using WriteBuffer = const uint8_t*;
+#else
+using WriteBuffer = uint8_t*;
+#endif
+
+int writeToFile(void* opaque, WriteBuffer buffer, int size) {
+    const int fd = *static_cast<int*>(opaque);
+    int written = 0;
+    while (written < size) {
+        const ssize_t n = ::write(fd, buffer + written, static_cast<size_t>(size - written));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return AVERROR(errno);
+        }
+        written += static_cast<int>(n);
+    }
+    return size;
+}
+
+int64_t seekInFile(void* opaque, int64_t offset, int whence) {
+    const int fd = *static_cast<int*>(opaque);
+    if (whence == AVSEEK_SIZE) {
+        struct stat info;
+        return fstat(fd, &info) == 0 ? static_cast<int64_t>(info.st_size) : AVERROR(errno);
+    }
+    const off_t position = lseek(fd, static_cast<off_t>(offset), whence & ~AVSEEK_FORCE);
+    return position < 0 ? AVERROR(errno) : static_cast<int64_t>(position);
+}
+
+bool isMovFamily(const AVOutputFormat* format) {
+    const std::string name = format->name ? format->name : "";
+    return name.find("mp4") != std::string::npos || name.find("mov") != std::string::npos;
+}
+
+} // namespace
+
+class PacketMuxer::Impl {
+public:
+    ~Impl() {
+        close();
+    }
+
+    bool open(const std::string& newPath, const MuxerStreamInfo& info, const MuxerOptions& options) {
+        close();
+        path = newPath;
+        failed = false;
+        firstPts = AV_NOPTS_VALUE;
+        lastDts = AV_NOPTS_VALUE;
+        bytesWritten = 0;
+        packetsWritten = 0;
+
+        int ret = avformat_alloc_output_context2(&formatContext, nullptr, nullptr, path.c_str());
+        if (ret < 0 || !formatContext) {
+            utils::Logger::getInstance().error("Could not create output context for ", path, ": ", errorString(ret));
+            return false;
+        }
+
+        stream = avformat_new_stream(formatContext, nullptr);
+        if (!stream) {
+            utils::Logger::getInstance().error("Could not create video stream");
+            discard();
+            return false;
+        }
+
+        AVCodecParameters* params = stream->codecpar;
+        params->codec_type = AVMEDIA_TYPE_VIDEO;
+        params->codec_id = static_cast<AVCodecID>(info.codecId);
+        params->width = info.width;
+        params->height = info.height;
+        if (!info.extradata.empty()) {
+            params->extradata = static_cast<uint8_t*>(
+                av_mallocz(info.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+            if (!params->extradata) {
+                discard();
+                return false;
+            }
+            std::memcpy(params->extradata, info.extradata.data(), info.extradata.size());
+            params->extradata_size = static_cast<int>(info.extradata.size());
+        }
+        // A hint only; the muxer picks the final time base in write_header
+        stream->time_base = kPacketTimeBase;
+
+        if (!(formatContext->oformat->flags & AVFMT_NOFILE)) {
+            if (!openOutput(options.ioBufferSize)) {
+                discard();
+                return false;
+            }
+        }
+
+        AVDictionary* formatOptions = nullptr;
+        if (options.fragmented && isMovFamily(formatContext->oformat)) {
+            av_dict_set(&formatOptions, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+        }
+        ret = avformat_write_header(formatContext, &formatOptions);
+        av_dict_free(&formatOptions);
+        if (ret < 0) {
+            utils::Logger::getInstance().error("Could not write header to ", path, ": ", errorString(ret));
+            discard();
+            return false;
+        }
+
+        if (!options.indexPath.empty()) {
+            index.open(options.indexPath);
+        }
+        return true;
+    }
+
+    bool write(AVPacket* packet) {
+        if (!formatContext || packet->pts == AV_NOPTS_VALUE) {
+            av_packet_unref(packet);
+            return false;
+        }
+
+        if (firstPts == AV_NOPTS_VALUE) {
+            firstPts = packet->pts;
+        }
+        packet->pts -= firstPts;
+        packet->dts = packet->pts;
+        packet->stream_index = stream->index;
+        packet->pos = -1;
+        packet->duration = 0;
+        av_packet_rescale_ts(packet, kPacketTimeBase, stream->time_base);
+
+        // Containers need strictly increasing dts; the stream has no
+        // B-frames, so pts follows dts
+        if (lastDts != AV_NOPTS_VALUE && packet->dts <= lastDts) {
+            packet->dts = lastDts + 1;
+        }
+        if (packet->pts < packet->dts) {
+            packet->pts = packet->dts;
+        }
+        lastDts = packet->dts;
+
+        if ((packet->flags & AV_PKT_FLAG_KEY) && index.isOpen()) {
+            // Matroska holds a cluster and fragmented MP4 a fragment until the
+            // next one starts, so the position only means something once the
+            // previous GOP is out. Flushing makes the keyframe open a new
+            // cluster or fragment right here; with a single stream nothing is
+            // held back for interleaving.
+            if (packetsWritten > 0 && (formatContext->oformat->flags & AVFMT_ALLOW_FLUSH)) {
+                av_write_frame(formatContext, nullptr);
+            }
+            // The index is read while recording, so it must not point past
+            // what has reached the file
+            avio_flush(formatContext->pb);
+            KeyframeEntry entry;
+            entry.ptsUs = av_rescale_q(packet->pts, stream->time_base, kPacketTimeBase);
+            entry.byteOffset = static_cast<uint64_t>(std::max<int64_t>(avio_tell(formatContext->pb), 0));
+            entry.frameNumber = packetsWritten;
+            index.append(entry);
+        }
+
+        const int size = packet->size;
+        const int ret = av_interleaved_write_frame(formatContext, packet);
+        av_packet_unref(packet);
+        if (ret < 0) {
+            if (!failed) {
+                utils::Logger::getInstance().error("Failed to write packet to ", path, ": ", errorString(ret));
+            }
+            failed = true;
+            return false;
+        }
+
+        bytesWritten += static_cast<uint64_t>(size);
+        packetsWritten++;
+        return true;
+    }
+
+    bool close() {
+        if (!formatContext) {
+            return !failed;
+        }
+
+        const int ret = av_write_trailer(formatContext);
+        if (ret < 0) {
+            utils::Logger::getInstance().error("Failed to write trailer to ", path, ": ", errorString(ret));
+            failed = true;
+        }
+        discard();
+        return !failed;
+    }
+
+    // Free the context without writing a trailer
+    void discard() {
+        if (formatContext) {
+            if (customIo) {
+                // Ours, not FFmpeg's; the buffer may have been reallocated
+                formatContext->pb = nullptr;
+                av_freep(&customIo->buffer);
+                avio_context_free(&customIo);
+            } else if (formatContext->pb && !(formatContext->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&formatContext->pb);
+            }
+            avformat_free_context(formatContext);
+            formatContext = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        index.close();
+        stream = nullptr;
+    }
+
+    bool openOutput(size_t bufferSize) {
+        if (bufferSize == 0) {
+            const int ret = avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE);
+            if (ret < 0) {
+                utils::Logger::getInstance().error("Could not open output file ", path, ": ", errorString(ret));
+                return false;
+            }
+            return true;
+        }
+
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            utils::Logger::getInstance().error("Could not open output file ", path, ": ", std::strerror(errno));
+            return false;
+        }
+        auto* buffer = static_cast<unsigned char*>(av_malloc(bufferSize));
+        if (!buffer) {
+            return false;
+        }
+        customIo = avio_alloc_context(buffer, static_cast<int>(bufferSize), 1, &fd,
+                                      nullptr, &writeToFile, &seekInFile);
+        if (!customIo) {
+            av_free(buffer);
+            return false;
+        }
+        formatContext->pb = customIo;
+        formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+        return true;
+    }
+
+    std::string path;
+    AVFormatContext* formatContext = nullptr;
+    AVStream* stream = nullptr;
+    AVIOContext* customIo = nullptr;
+    int fd = -1;
+    KeyframeIndexWriter index;
+    int64_t firstPts = AV_NOPTS_VALUE;
+    int64_t lastDts = AV_NOPTS_VALUE;
+    uint64_t bytesWritten = 0;
+    uint64_t packetsWritten = 0;
+    bool failed = false;
+};
+
+PacketMuxer::PacketMuxer() : pimpl(std::make_unique<Impl>()) {}
+
+PacketMuxer::~PacketMuxer() = default;
+
+bool PacketMuxer::open(const std::string& path, const MuxerStreamInfo& info, const MuxerOptions& options) {
+    return pimpl->open(path, info, options);
+}
+
+bool PacketMuxer::write(AVPacket* packet) {
+    return pimpl->write(packet);
+}
+
+bool PacketMuxer::close() {
+    return pimpl->close();
+}
+
+bool PacketMuxer::isOpen() const {
+    return pimpl->formatContext != nullptr;
+}
+
+const std::string& PacketMuxer::getPath() const {
+    return pimpl->path;
+}
+
+uint64_t PacketMuxer::getBytesWritten() const {
+    return pimpl->bytesWritten;
+}
+
+uint64_t PacketMuxer::getPacketsWritten() const {
+    return pimpl->packetsWritten;
+}
+
+bool PacketMuxer::extractExtradata(int codecId, const AVPacket* keyframe, std::vector<uint8_t>& extradata) {
+    const AVBitStreamFilter* filter = av_bsf_get_by_name("extract_extradata");
+    if (!filter) {
+        utils::Logger::getInstance().warn("extract_extradata bitstream filter not available");
+        return false;
+    }
+
+    AVBSFContext* bsf = nullptr;
+    if (av_bsf_alloc(filter, &bsf) < 0) {
+        return false;
+    }
+    bsf->par_in->codec_id = static_cast<AVCodecID>(codecId);
+    bsf->par_in->codec_type = AVMEDIA_TYPE_VIDEO;
+
+    bool found = false;
+    AVPacket* packet = av_packet_clone(keyframe);
+    if (packet && av_bsf_init(bsf) >= 0 &&
+        av_bsf_send_packet(bsf, packet) >= 0 &&
+        av_bsf_receive_packet(bsf, packet) >= 0) {
+        size_t size = 0;
+        const uint8_t* data = av_packet_get_side_data(packet, AV_PKT_DATA_NEW_EXTRADATA, &size);
+        if (data && size > 0) {
+            extradata.assign(data, data + size);
+            found = true;
+        }
+    }
+
+    av_packet_free(&packet);
+    av_bsf_free(&bsf);
+    return found;
+}
+
+} // namespace mirrolink
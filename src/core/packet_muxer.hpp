@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AVPacket;
+
+namespace mirrolink {
+
+// What the muxer needs to know about the encoded video stream
+struct MuxerStreamInfo {
+    int codecId = 0;                 // AVCodecID of the packets
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> extradata;  // SPS/PPS (or VPS/SPS/PPS), Annex B or avcC/hvcC
+};
+
+struct MuxerOptions {
+    // Write MP4/MOV as self-contained fragments, one per keyframe, so the
+    // file stays playable up to the last fragment if the trailer is never
+    // written
+    bool fragmented = false;
+    // Size of the output buffer; 0 uses FFmpeg's default. Large buffers
+    // turn the muxer's many small writes into a few big ones.
+    size_t ioBufferSize = 0;
+    // Write a KeyframeIndex sidecar to this path; empty for none
+    std::string indexPath;
+};
+
+// Writes already-encoded video packets into a container file without
+// re-encoding. Packet timestamps are scrcpy microseconds; they are rebased
+// so the file starts at zero and rescaled to the stream time base.
+class PacketMuxer {
+public:
+    PacketMuxer();
+    ~PacketMuxer();
+
+    PacketMuxer(const PacketMuxer&) = delete;
+    PacketMuxer& operator=(const PacketMuxer&) = delete;
+
+    // Create the file and write its header. The container is picked from
+    // the file extension.
+    bool open(const std::string& path, const MuxerStreamInfo& info,
+              const MuxerOptions& options = MuxerOptions());
+
+    // Write one packet. The packet's reference is consumed and it is left
+    // blank. The first packet written should be a keyframe.
+    bool write(AVPacket* packet);
+
+    // Write the trailer and close the file; returns false if anything
+    // failed since open()
+    bool close();
+
+    bool isOpen() const;
+    const std::string& getPath() const;
+    uint64_t getBytesWritten() const;
+    uint64_t getPacketsWritten() const;
+
+    // Pull codec extradata out of an in-band keyframe with the
+    // extract_extradata bitstream filter
+    static bool extractExtradata(int codecId, const AVPacket* keyframe, std::vector<uint8_t>& extradata);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,279 @@
+#include "packet_reader.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+}
+
+namespace mirrolink {
+
+namespace {
+
+// Anything larger is a corrupt header, not a video packet
+constexpr uint32_t kMaxPacketSize = 64 << 20;
+
+// scrcpy flags in the top bits of the pts field
+constexpr uint64_t kConfigFlag = 1ULL << 63;
+constexpr uint64_t kKeyFrameFlag = 1ULL << 62;
+constexpr uint64_t kPtsMask = kKeyFrameFlag - 1;
+
+void setOption(int sockfd, int level, int option, int value, const char* name) {
+    if (setsockopt(sockfd, level, option, &value, sizeof(value)) < 0) {
+        utils::Logger::getInstance().warn("Failed to set ", name, ": ", std::strerror(errno));
+    }
+}
+
+uint32_t readBigEndian32(const uint8_t* bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+uint64_t readBigEndian64(const uint8_t* bytes) {
+    return (static_cast<uint64_t>(readBigEndian32(bytes)) << 32) | readBigEndian32(bytes + 4);
+}
+
+} // namespace
+
+class PacketReader::Impl {
+public:
+    Impl(int sockfd, const PacketReaderConfig& config)
+        : sockfd(sockfd)
+        , ring(std::max(config.bufferSize, kHeaderSize * 2)) {}
+
+    ~Impl() {
+        av_buffer_pool_uninit(&payloadPool);
+    }
+
+    bool readPacket(AVPacket* packet) {
+        while (buffered() < kHeaderSize) {
+            if (!fillRing()) {
+                return false;
+            }
+        }
+
+        const uint8_t* header = ring.data() + readPos;
+        const uint64_t ptsAndFlags = readBigEndian64(header);
+        const uint32_t size = readBigEndian32(header + 8);
+        readPos += kHeaderSize;
+
+        if (size > kMaxPacketSize) {
+            // Framing is lost; nothing after this point can be trusted
+            utils::Logger::getInstance().error("Invalid video packet size: ", size);
+            closed = true;
+            return false;
+        }
+
+        AVBufferRef* payload = acquirePayload(size);
+        if (!payload) {
+            // The payload is still on the socket, so framing is lost too
+            utils::Logger::getInstance().error("Could not allocate video packet of ", size, " bytes");
+            closed = true;
+            return false;
+        }
+
+        // Take whatever is already buffered, then read the rest straight
+        // into the payload, letting the same call refill the ring
+        size_t filled = std::min<size_t>(size, buffered());
+        std::memcpy(payload->data, ring.data() + readPos, filled);
+        readPos += filled;
+
+        while (filled < size) {
+            if (!readIntoPayload(payload->data, filled, size)) {
+                av_buffer_unref(&payload);
+                return false;
+            }
+        }
+        std::memset(payload->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+        av_packet_unref(packet);
+        packet->buf = payload;
+        packet->data = payload->data;
+        packet->size = static_cast<int>(size);
+        packet->pts = (ptsAndFlags & kConfigFlag) ? AV_NOPTS_VALUE
+                                                  : static_cast<int64_t>(ptsAndFlags & kPtsMask);
+        packet->dts = packet->pts;
+        if (ptsAndFlags & kKeyFrameFlag) {
+            packet->flags |= AV_PKT_FLAG_KEY;
+        }
+
+        packets++;
+        bytes += kHeaderSize + size;
+        bufferedBytes = buffered();
+        return true;
+    }
+
+    PacketReaderStats getStats() const {
+        PacketReaderStats stats;
+        stats.packets = packets.load();
+        stats.bytes = bytes.load();
+        stats.reads = reads.load();
+        stats.poolResizes = poolResizes.load();
+        stats.buffered = bufferedBytes.load();
+        return stats;
+    }
+
+    size_t getBacklog() const {
+        int pending = 0;
+        if (ioctl(sockfd, FIONREAD, &pending) < 0) {
+            pending = 0;
+        }
+        return bufferedBytes.load() + static_cast<size_t>(pending);
+    }
+
+    std::atomic<bool> closed{false};
+
+private:
+    size_t buffered() const {
+        return writePos - readPos;
+    }
+
+    // Move the unread bytes to the front so the whole tail is free
+    void compactRing() {
+        const size_t pending = buffered();
+        if (readPos > 0 && pending > 0) {
+            std::memmove(ring.data(), ring.data() + readPos, pending);
+        }
+        readPos = 0;
+        writePos = pending;
+    }
+
+    bool fillRing() {
+        if (ring.size() - writePos < kHeaderSize) {
+            compactRing();
+        }
+
+        ssize_t n;
+        do {
+            n = recv(sockfd, ring.data() + writePos, ring.size() - writePos, 0);
+        } while (n < 0 && errno == EINTR);
+
+        if (!handleRead(n)) {
+            return false;
+        }
+        writePos += static_cast<size_t>(n);
+        bufferedBytes = buffered();
+        return true;
+    }
+
+    // One readv fills the rest of the payload and as much of the ring as
+    // the socket has ready
+    bool readIntoPayload(uint8_t* payload, size_t& filled, size_t size) {
+        compactRing();
+
+        struct iovec parts[2];
+        parts[0].iov_base = payload + filled;
+        parts[0].iov_len = size - filled;
+        parts[1].iov_base = ring.data() + writePos;
+        parts[1].iov_len = ring.size() - writePos;
+
+        ssize_t n;
+        do {
+            n = readv(sockfd, parts, 2);
+        } while (n < 0 && errno == EINTR);
+
+        if (!handleRead(n)) {
+            return false;
+        }
+
+        const size_t received = static_cast<size_t>(n);
+        const size_t toPayload = std::min(received, size - filled);
+        filled += toPayload;
+        writePos += received - toPayload;
+        bufferedBytes = buffered();
+        return true;
+    }
+
+    bool handleRead(ssize_t n) {
+        if (n > 0) {
+            reads++;
+            return true;
+        }
+        if (n == 0) {
+            closed = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            utils::Logger::getInstance().warn("Video socket read failed: ", std::strerror(errno));
+            closed = true;
+        }
+        return false;
+    }
+
+    AVBufferRef* acquirePayload(uint32_t size) {
+        const size_t needed = static_cast<size_t>(size) + AV_INPUT_BUFFER_PADDING_SIZE;
+        if (!payloadPool || needed > poolBufferSize) {
+            // Grow geometrically so a slowly rising bitrate does not rebuild
+            // the pool on every keyframe. Buffers still held by the decoder
+            // keep the old pool alive until they are released.
+            size_t newSize = std::max<size_t>(poolBufferSize, 64 * 1024);
+            while (newSize < needed) {
+                newSize *= 2;
+            }
+            av_buffer_pool_uninit(&payloadPool);
+            payloadPool = av_buffer_pool_init(newSize, nullptr);
+            poolBufferSize = newSize;
+            poolResizes++;
+            if (!payloadPool) {
+                poolBufferSize = 0;
+                return nullptr;
+            }
+        }
+        return av_buffer_pool_get(payloadPool);
+    }
+
+    const int sockfd;
+
+    std::vector<uint8_t> ring;
+    size_t readPos = 0;
+    size_t writePos = 0;
+
+    AVBufferPool* payloadPool = nullptr;
+    size_t poolBufferSize = 0;
+
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> poolResizes{0};
+    std::atomic<size_t> bufferedBytes{0};
+};
+
+PacketReader::PacketReader(int sockfd, const PacketReaderConfig& config)
+    : pimpl(std::make_unique<Impl>(sockfd, config)) {}
+
+PacketReader::~PacketReader() = default;
+
+void PacketReader::configureSocket(int sockfd, const PacketReaderConfig& config) {
+    if (config.socketReceiveBuffer > 0) {
+        setOption(sockfd, SOL_SOCKET, SO_RCVBUF, config.socketReceiveBuffer, "SO_RCVBUF");
+    }
+    if (config.noDelay) {
+        setOption(sockfd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    }
+}
+
+bool PacketReader::readPacket(AVPacket* packet) {
+    return pimpl->readPacket(packet);
+}
+
+bool PacketReader::isClosed() const {
+    return pimpl->closed;
+}
+
+PacketReaderStats PacketReader::getStats() const {
+    return pimpl->getStats();
+}
+
+size_t PacketReader::getBacklog() const {
+    return pimpl->getBacklog();
+}
+
+} // namespace mirrolink
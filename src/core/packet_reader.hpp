@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct AVPacket;
+
+namespace mirrolink {
+
+struct PacketReaderConfig {
+    size_t bufferSize = 1 << 20;          // Receive ring in bytes
+    int socketReceiveBuffer = 4 << 20;    // SO_RCVBUF; 0 keeps the system default
+    bool noDelay = true;                  // TCP_NODELAY
+};
+
+struct PacketReaderStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t reads = 0;         // recv/readv calls that returned data
+    uint64_t poolResizes = 0;   // Payload pool rebuilt for a larger packet
+    size_t buffered = 0;        // Bytes received but not yet handed out
+};
+
+// Reads scrcpy video packets (12-byte header: 64-bit pts and flags, then
+// 32-bit size, both big-endian) from a connected socket. Headers are parsed out
+// of a receive ring, and payloads are read straight into AVBufferPool
+// buffers together with the bytes that follow them, so a typical packet
+// costs one syscall and no allocation.
+class PacketReader {
+public:
+    static constexpr size_t kHeaderSize = 12;
+
+    explicit PacketReader(int sockfd, const PacketReaderConfig& config = PacketReaderConfig());
+    ~PacketReader();
+
+    PacketReader(const PacketReader&) = delete;
+    PacketReader& operator=(const PacketReader&) = delete;
+
+    // Apply the socket options from config. Call before connect() so the
+    // larger receive buffer is reflected in the TCP window; failures are
+    // logged and otherwise ignored.
+    static void configureSocket(int sockfd, const PacketReaderConfig& config);
+
+    // Replace the contents of packet with the next packet from the stream.
+    // Returns false on error or end of stream; isClosed() tells them apart.
+    bool readPacket(AVPacket* packet);
+
+    // The peer closed the connection or the stream can no longer be framed
+    bool isClosed() const;
+
+    PacketReaderStats getStats() const;
+
+    // Bytes that have arrived but not been returned by readPacket yet,
+    // in the kernel socket buffer or here. Costs one ioctl.
+    size_t getBacklog() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
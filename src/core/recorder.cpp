@@ -0,0 +1,351 @@
+#include "recorder.hpp"
+#include "keyframe_index.hpp"
+#include "../utils/logger.hpp"
+#include "../utils/spsc_queue.hpp"
+#include "../utils/thread_pool.hpp"
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace mirrolink {
+
+namespace fs = std::filesystem;
+
+class Recorder::Impl {
+public:
+    explicit Impl(size_t queueDepth)
+        : depth(queueDepth > 0 ? queueDepth : 1) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    bool start(const std::string& path, const MuxerStreamInfo& info, const RecordingOptions& newOptions) {
+        std::lock_guard<std::mutex> lock(producerMutex);
+        if (accepting) {
+            return false;
+        }
+
+        queue = std::make_unique<utils::SpscQueue<AVPacket*>>(depth);
+        freePackets = std::make_unique<utils::SpscQueue<AVPacket*>>(depth);
+        for (size_t i = 0; i < depth; ++i) {
+            AVPacket* packet = av_packet_alloc();
+            if (!packet) {
+                releasePackets();
+                return false;
+            }
+            freePackets->tryPush(packet);
+        }
+
+        outputPath = path;
+        streamInfo = info;
+        options = newOptions;
+        outputFailed = false;
+        segmentIndex = 0;
+        segmentStartPts = 0;
+        finishedSegments.clear();
+        finishedBytes = 0;
+        written = 0;
+        dropped = 0;
+        needKeyframe = false;
+        skipped = 0;
+        writeErrors = 0;
+        bytes = 0;
+        segments = 0;
+        deletedSegments = 0;
+
+        stopping = false;
+        accepting = true;
+        writerThread = std::thread(&Impl::writerLoop, this);
+        utils::Logger::getInstance().info("Recording to ", path);
+        return true;
+    }
+
+    void stop() {
+        {
+            // After this no push() can touch the queues
+            std::lock_guard<std::mutex> lock(producerMutex);
+            if (!accepting) {
+                return;
+            }
+            accepting = false;
+        }
+
+        stopping = true;
+        writerWake.notify();
+        if (writerThread.joinable()) {
+            writerThread.join();
+        }
+        releasePackets();
+
+        utils::Logger::getInstance().info("Recording finished: ", written.load(), " packets, ",
+            bytes.load(), " bytes, ", dropped.load(), " dropped");
+    }
+
+    bool push(const AVPacket* packet) {
+        std::lock_guard<std::mutex> lock(producerMutex);
+        if (!accepting) {
+            return false;
+        }
+
+        // After a loss, the packets up to the next keyframe reference a
+        // frame the file does not have and would corrupt playback
+        const bool keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+        const bool config = packet->pts == AV_NOPTS_VALUE;
+        if (needKeyframe && !keyframe && !config) {
+            dropped++;
+            return false;
+        }
+
+        AVPacket* copy = nullptr;
+        if (!freePackets->tryPop(copy)) {
+            dropped++;
+            needKeyframe = true;
+            return false;
+        }
+
+        // Shares the payload buffer; nothing is copied
+        if (av_packet_ref(copy, packet) < 0) {
+            // Only the writer may return packets to the free list
+            av_packet_free(&copy);
+            dropped++;
+            needKeyframe = true;
+            return false;
+        }
+        queue->tryPush(copy);
+        writerWake.notify();
+        if (keyframe) {
+            needKeyframe = false;
+        }
+        return true;
+    }
+
+    RecorderStats getStats() const {
+        RecorderStats stats;
+        stats.written = written.load();
+        stats.dropped = dropped.load();
+        stats.skipped = skipped.load();
+        stats.writeErrors = writeErrors.load();
+        stats.bytes = bytes.load();
+        stats.segments = segments.load();
+        stats.deletedSegments = deletedSegments.load();
+        stats.queueDepth = depth;
+        std::lock_guard<std::mutex> lock(producerMutex);
+        if (queue) {
+            stats.queued = queue->size();
+        }
+        return stats;
+    }
+
+    std::atomic<bool> accepting{false};
+
+private:
+    void writerLoop() {
+        PacketMuxer muxer;
+        utils::Backoff backoff(writerWake);
+
+        while (true) {
+            AVPacket* packet = nullptr;
+            if (!queue->tryPop(packet)) {
+                // Everything pushed before stop() has been written
+                if (stopping) {
+                    break;
+                }
+                backoff.wait([this]() { return !queue->empty() || stopping; });
+                continue;
+            }
+            backoff.reset();
+
+            writePacket(muxer, packet);
+            av_packet_unref(packet);
+            freePackets->tryPush(packet);
+        }
+
+        if (muxer.isOpen()) {
+            finishSegment(muxer);
+        }
+    }
+
+    void writePacket(PacketMuxer& muxer, AVPacket* packet) {
+        // Config packets carry the parameter sets and have no timestamp
+        if (packet->pts == AV_NOPTS_VALUE) {
+            if (!muxer.isOpen()) {
+                streamInfo.extradata.assign(packet->data, packet->data + packet->size);
+            } else {
+                utils::Logger::getInstance().warn("Stream parameters changed during recording");
+            }
+            return;
+        }
+
+        if (outputFailed) {
+            skipped++;
+            return;
+        }
+
+        const bool keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+        if (muxer.isOpen() && keyframe && options.segmentSeconds > 0 &&
+            packet->pts - segmentStartPts >= static_cast<int64_t>(options.segmentSeconds) * 1000000) {
+            finishSegment(muxer);
+        }
+
+        if (!muxer.isOpen()) {
+            // Nothing before the first keyframe can be decoded
+            if (!keyframe) {
+                skipped++;
+                return;
+            }
+            if (streamInfo.extradata.empty() &&
+                !PacketMuxer::extractExtradata(streamInfo.codecId, packet, streamInfo.extradata)) {
+                utils::Logger::getInstance().warn("No codec extradata found for the recording");
+            }
+            const std::string path = options.segmentSeconds > 0 ?
+                segmentPath(outputPath, segmentIndex) : outputPath;
+            MuxerOptions muxerOptions;
+            muxerOptions.fragmented = options.fragmented;
+            muxerOptions.ioBufferSize = options.ioBufferSize;
+            if (options.writeIndex) {
+                muxerOptions.indexPath = KeyframeIndex::pathFor(path);
+            }
+            if (!muxer.open(path, streamInfo, muxerOptions)) {
+                outputFailed = true;
+                writeErrors++;
+                skipped++;
+                return;
+            }
+            segmentIndex++;
+            segmentStartPts = packet->pts;
+            segments++;
+        }
+
+        const int size = packet->size;
+        if (muxer.write(packet)) {
+            written++;
+            bytes += static_cast<uint64_t>(size);
+        } else {
+            writeErrors++;
+        }
+    }
+
+    void finishSegment(PacketMuxer& muxer) {
+        const std::string path = muxer.getPath();
+        if (!muxer.close()) {
+            writeErrors++;
+        }
+
+        std::error_code error;
+        const uintmax_t size = fs::file_size(path, error);
+        finishedSegments.push_back({path, error ? 0 : static_cast<uint64_t>(size)});
+        finishedBytes += finishedSegments.back().size;
+
+        if (options.maxTotalBytes == 0) {
+            return;
+        }
+        // The newest segment is always kept, even on its own over budget
+        std::vector<std::string> expired;
+        while (finishedBytes > options.maxTotalBytes && finishedSegments.size() > 1) {
+            finishedBytes -= finishedSegments.front().size;
+            expired.push_back(finishedSegments.front().path);
+            finishedSegments.pop_front();
+        }
+        if (expired.empty()) {
+            return;
+        }
+
+        // Unlinking large files can take a while; keep it off the write path
+        deletedSegments += expired.size();
+        janitor.submit([expired = std::move(expired)]() {
+            for (const auto& path : expired) {
+                std::error_code error;
+                if (!fs::remove(path, error) && error) {
+                    utils::Logger::getInstance().warn("Could not delete old segment ", path, ": ", error.message());
+                }
+                fs::remove(KeyframeIndex::pathFor(path), error);
+            }
+        });
+    }
+
+    void releasePackets() {
+        AVPacket* packet = nullptr;
+        for (auto* list : {queue.get(), freePackets.get()}) {
+            while (list && list->tryPop(packet)) {
+                av_packet_free(&packet);
+            }
+        }
+        queue.reset();
+        freePackets.reset();
+    }
+
+    const size_t depth;
+    mutable std::mutex producerMutex;
+    std::unique_ptr<utils::SpscQueue<AVPacket*>> queue;
+    std::unique_ptr<utils::SpscQueue<AVPacket*>> freePackets;
+    bool needKeyframe = false;  // A packet was lost; guarded by producerMutex
+    std::thread writerThread;
+    std::atomic<bool> stopping{false};
+    utils::WakeSignal writerWake;  // Notified by push() and stop()
+
+    // Owned by the writer thread while recording
+    std::string outputPath;
+    MuxerStreamInfo streamInfo;
+    RecordingOptions options;
+    bool outputFailed = false;
+    uint64_t segmentIndex = 0;
+    int64_t segmentStartPts = 0;
+
+    struct Segment {
+        std::string path;
+        uint64_t size;
+    };
+    std::deque<Segment> finishedSegments;
+    uint64_t finishedBytes = 0;
+    utils::ThreadPool janitor{1};
+
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> writeErrors{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> segments{0};
+    std::atomic<uint64_t> deletedSegments{0};
+};
+
+Recorder::Recorder(size_t queueDepth) : pimpl(std::make_unique<Impl>(queueDepth)) {}
+
+Recorder::~Recorder() = default;
+
+bool Recorder::start(const std::string& path, const MuxerStreamInfo& stream, const RecordingOptions& options) {
+    return pimpl->start(path, stream, options);
+}
+
+std::string Recorder::segmentPath(const std::string& path, uint64_t index) {
+    const fs::path base(path);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%05llu", static_cast<unsigned long long>(index));
+    fs::path segment = base.parent_path() / (base.stem().string() + suffix + base.extension().string());
+    return segment.string();
+}
+
+void Recorder::stop() {
+    pimpl->stop();
+}
+
+bool Recorder::isRecording() const {
+    return pimpl->accepting;
+}
+
+bool Recorder::push(const AVPacket* packet) {
+    return pimpl->push(packet);
+}
+
+RecorderStats Recorder::getStats() const {
+    return pimpl->getStats();
+}
+
+} // namespace mirrolink
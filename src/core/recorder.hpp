@@ -0,0 +1,75 @@
+#pragma once
+
+#include "packet_muxer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AVPacket;
+
+namespace mirrolink {
+
+struct RecordingOptions {
+    // Start a new file at the first keyframe after this many seconds; 0
+    // writes a single file. Segments are named <stem>_00000<ext>.
+    int segmentSeconds = 0;
+    // Delete the oldest finished segments once they add up to more than
+    // this; 0 keeps everything
+    uint64_t maxTotalBytes = 0;
+    // Fragmented MP4/MOV, playable after a crash
+    bool fragmented = true;
+    size_t ioBufferSize = 4 * 1024 * 1024;
+    // Write a keyframe index (<file>.idx) next to each file for seeking
+    bool writeIndex = true;
+};
+
+struct RecorderStats {
+    uint64_t written = 0;       // Packets in the file
+    uint64_t dropped = 0;       // Packets lost because the writer fell behind, and those
+                                // up to the next keyframe that depended on them
+    uint64_t skipped = 0;       // Packets before the first keyframe
+    uint64_t writeErrors = 0;
+    uint64_t bytes = 0;
+    uint64_t segments = 0;        // Files started
+    uint64_t deletedSegments = 0; // Files removed by the retention policy
+    size_t queued = 0;          // Packets waiting for the writer
+    size_t queueDepth = 0;
+};
+
+// Remuxes the incoming encoded stream to a file on its own thread. The
+// capture side only takes a reference to each packet and hands it over a
+// bounded queue, so a slow disk costs dropped packets, never a stall.
+class Recorder {
+public:
+    explicit Recorder(size_t queueDepth = 512);
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Start writing to path. The stream's extradata may be empty, in which
+    // case it is extracted from the first keyframe.
+    bool start(const std::string& path, const MuxerStreamInfo& stream,
+               const RecordingOptions& options = RecordingOptions());
+
+    // File name of segment `index` of a recording to path
+    static std::string segmentPath(const std::string& path, uint64_t index);
+
+    // Flush everything queued, finish the file and join the writer
+    void stop();
+
+    bool isRecording() const;
+
+    // Queue a reference to the packet for writing. Never blocks; returns
+    // false if the packet was dropped. Call from one thread only.
+    bool push(const AVPacket* packet);
+
+    RecorderStats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,290 @@
+#include "recording_extractor.hpp"
+#include "packet_muxer.hpp"
+#include "../utils/logger.hpp"
+#include <climits>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace mirrolink {
+
+namespace {
+
+constexpr AVRational kMicroseconds = {1, 1000000};
+
+} // namespace
+
+class RecordingExtractor::Impl {
+public:
+    ~Impl() {
+        close();
+    }
+
+    bool open(const std::string& videoPath) {
+        close();
+
+        if (avformat_open_input(&formatContext, videoPath.c_str(), nullptr, nullptr) < 0) {
+            utils::Logger::getInstance().error("Could not open recording ", videoPath);
+            return false;
+        }
+        if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+            utils::Logger::getInstance().error("Could not read stream info from ", videoPath);
+            close();
+            return false;
+        }
+        streamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (streamIndex < 0) {
+            utils::Logger::getInstance().error("No video stream in ", videoPath);
+            close();
+            return false;
+        }
+        stream = formatContext->streams[streamIndex];
+
+        packet = av_packet_alloc();
+        if (!packet) {
+            close();
+            return false;
+        }
+
+        if (!index.load(KeyframeIndex::pathFor(videoPath))) {
+            utils::Logger::getInstance().warn("No keyframe index for ", videoPath,
+                ", seeking with the container index");
+        }
+        return true;
+    }
+
+    void close() {
+        if (codecContext) {
+            avcodec_free_context(&codecContext);
+        }
+        if (packet) {
+            av_packet_free(&packet);
+        }
+        if (formatContext) {
+            avformat_close_input(&formatContext);
+        }
+        stream = nullptr;
+        streamIndex = -1;
+        index = KeyframeIndex();
+    }
+
+    bool extractFrame(int64_t timeUs, AVFrame* frame) {
+        if (!formatContext || !openDecoder()) {
+            return false;
+        }
+
+        int64_t keyTs = 0;
+        if (!seekToKeyframe(timeUs, keyTs)) {
+            return false;
+        }
+        avcodec_flush_buffers(codecContext);
+
+        const int64_t targetTs = av_rescale_q(timeUs, kMicroseconds, stream->time_base);
+        AVFrame* decoded = av_frame_alloc();
+        if (!decoded) {
+            return false;
+        }
+
+        // Keep the last frame at or before the target; the first frame
+        // after it ends the search
+        bool found = false;
+        bool done = false;
+        auto drain = [&]() {
+            while (!done && avcodec_receive_frame(codecContext, decoded) >= 0) {
+                if (found && decoded->best_effort_timestamp > targetTs) {
+                    done = true;
+                } else {
+                    av_frame_unref(frame);
+                    av_frame_move_ref(frame, decoded);
+                    found = true;
+                }
+                av_frame_unref(decoded);
+            }
+        };
+
+        bool started = false;
+        while (!done && nextPacket(keyTs, started)) {
+            const int ret = avcodec_send_packet(codecContext, packet);
+            av_packet_unref(packet);
+            if (ret < 0 && ret != AVERROR(EAGAIN)) {
+                break;
+            }
+            drain();
+        }
+        if (!done) {
+            avcodec_send_packet(codecContext, nullptr);
+            drain();
+        }
+
+        av_frame_free(&decoded);
+        if (!found) {
+            utils::Logger::getInstance().warn("No frame decoded at ", timeUs, " us");
+        }
+        return found;
+    }
+
+    bool extractClip(int64_t startUs, int64_t endUs, const std::string& outputPath) {
+        if (!formatContext || endUs < startUs) {
+            return false;
+        }
+
+        int64_t keyTs = 0;
+        if (!seekToKeyframe(startUs, keyTs)) {
+            return false;
+        }
+
+        MuxerStreamInfo info;
+        info.codecId = stream->codecpar->codec_id;
+        info.width = stream->codecpar->width;
+        info.height = stream->codecpar->height;
+        if (stream->codecpar->extradata_size > 0) {
+            info.extradata.assign(stream->codecpar->extradata,
+                                  stream->codecpar->extradata + stream->codecpar->extradata_size);
+        }
+
+        const int64_t endTs = av_rescale_q(endUs, kMicroseconds, stream->time_base);
+        PacketMuxer muxer;
+        bool ok = true;
+        bool started = false;
+        while (nextPacket(keyTs, started)) {
+            if (packet->pts > endTs) {
+                av_packet_unref(packet);
+                break;
+            }
+            if (!muxer.isOpen() && !muxer.open(outputPath, info)) {
+                av_packet_unref(packet);
+                ok = false;
+                break;
+            }
+            // The muxer takes scrcpy-style microsecond timestamps
+            packet->pts = av_rescale_q(packet->pts, stream->time_base, kMicroseconds);
+            if (!muxer.write(packet)) {
+                ok = false;
+                break;
+            }
+        }
+
+        if (!muxer.isOpen()) {
+            utils::Logger::getInstance().warn("No packets in the requested clip range");
+            return false;
+        }
+        return muxer.close() && ok;
+    }
+
+    const KeyframeIndex& getIndex() const {
+        return index;
+    }
+
+    AVFormatContext* formatContext = nullptr;
+    KeyframeIndex index;
+
+private:
+    bool openDecoder() {
+        if (codecContext) {
+            return true;
+        }
+        const AVCodec* decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!decoder) {
+            utils::Logger::getInstance().error("No decoder for the recording's codec");
+            return false;
+        }
+        codecContext = avcodec_alloc_context3(decoder);
+        if (!codecContext ||
+            avcodec_parameters_to_context(codecContext, stream->codecpar) < 0 ||
+            avcodec_open2(codecContext, decoder, nullptr) < 0) {
+            utils::Logger::getInstance().error("Could not open decoder for the recording");
+            avcodec_free_context(&codecContext);
+            return false;
+        }
+        return true;
+    }
+
+    // Position the demuxer at or before the keyframe covering timeUs.
+    // keyTs is set to that keyframe's pts in the stream time base, or to
+    // INT64_MIN if it is not known without an index.
+    bool seekToKeyframe(int64_t timeUs, int64_t& keyTs) {
+        const KeyframeEntry* entry = index.find(timeUs);
+        const int64_t seekUs = entry ? entry->ptsUs : timeUs;
+        const int64_t seekTs = av_rescale_q(seekUs, kMicroseconds, stream->time_base);
+        keyTs = entry ? seekTs : INT64_MIN;
+
+        // Matroska resyncs on the cluster the index points at. MP4 and MOV
+        // cannot seek by byte, so they seek to the keyframe's exact pts
+        // from the index instead.
+        if (entry && !(formatContext->iformat->flags & AVFMT_NO_BYTE_SEEK) &&
+            av_seek_frame(formatContext, -1, static_cast<int64_t>(entry->byteOffset), AVSEEK_FLAG_BYTE) >= 0) {
+            return true;
+        }
+        if (avformat_seek_file(formatContext, streamIndex, INT64_MIN, seekTs, seekTs, 0) >= 0) {
+            return true;
+        }
+        // A fragmented MP4 cut short has no fragment index past what the
+        // demuxer has parsed; read forward from the start to the keyframe
+        if (entry && av_seek_frame(formatContext, streamIndex, 0, AVSEEK_FLAG_BACKWARD) >= 0) {
+            return true;
+        }
+        utils::Logger::getInstance().error("Could not seek to ", timeUs, " us");
+        return false;
+    }
+
+    // Next packet of the video stream, skipping anything before the
+    // keyframe the seek was aimed at
+    bool nextPacket(int64_t keyTs, bool& started) {
+        while (av_read_frame(formatContext, packet) >= 0) {
+            if (packet->stream_index != streamIndex) {
+                av_packet_unref(packet);
+                continue;
+            }
+            if (!started) {
+                if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->pts == AV_NOPTS_VALUE || packet->pts < keyTs) {
+                    av_packet_unref(packet);
+                    continue;
+                }
+                started = true;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    int streamIndex = -1;
+    AVStream* stream = nullptr;
+    AVCodecContext* codecContext = nullptr;
+    AVPacket* packet = nullptr;
+};
+
+RecordingExtractor::RecordingExtractor() : pimpl(std::make_unique<Impl>()) {}
+
+RecordingExtractor::~RecordingExtractor() = default;
+
+bool RecordingExtractor::open(const std::string& videoPath) {
+    return pimpl->open(videoPath);
+}
+
+void RecordingExtractor::close() {
+    pimpl->close();
+}
+
+bool RecordingExtractor::isOpen() const {
+    return pimpl->formatContext != nullptr;
+}
+
+bool RecordingExtractor::hasIndex() const {
+    return !pimpl->index.empty();
+}
+
+const KeyframeIndex& RecordingExtractor::getIndex() const {
+    return pimpl->getIndex();
+}
+
+bool RecordingExtractor::extractFrame(int64_t timeUs, AVFrame* frame) {
+    return pimpl->extractFrame(timeUs, frame);
+}
+
+bool RecordingExtractor::extractClip(int64_t startUs, int64_t endUs, const std::string& outputPath) {
+    return pimpl->extractClip(startUs, endUs, outputPath);
+}
+
+} // namespace mirrolink
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "keyframe_index.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AVFrame;
+
+namespace mirrolink {
+
+// Pulls single frames and short clips out of a recording. The keyframe
+// index written by the Recorder says which keyframe to start from and
+// where it is, so a lookup costs one seek and at most one GOP of decoding
+// no matter how long the recording is. Matroska seeks straight to the
+// keyframe's cluster; MP4 seeks to the keyframe's pts. Recordings without
+// an index fall back to the container's own seeking.
+class RecordingExtractor {
+public:
+    RecordingExtractor();
+    ~RecordingExtractor();
+
+    RecordingExtractor(const RecordingExtractor&) = delete;
+    RecordingExtractor& operator=(const RecordingExtractor&) = delete;
+
+    // Open a recording and its <path>.idx sidecar, if there is one
+    bool open(const std::string& videoPath);
+    void close();
+    bool isOpen() const;
+    bool hasIndex() const;
+    const KeyframeIndex& getIndex() const;
+
+    // Decode the frame on screen at timeUs (microseconds from the start of
+    // the file) into frame, in the decoder's pixel format
+    bool extractFrame(int64_t timeUs, AVFrame* frame);
+
+    // Remux [startUs, endUs] into a new file without re-encoding. The clip
+    // starts at the keyframe at or before startUs.
+    bool extractClip(int64_t startUs, int64_t endUs, const std::string& outputPath);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -0,0 +1,342 @@
+#include "replay_buffer.hpp"
+#include "../utils/logger.hpp"
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace mirrolink {
+
+namespace {
+
+// Most the snapshot copies per hold of the lock
+constexpr size_t kSnapshotChunkBytes = 1024 * 1024;
+
+// Fresh starts when eviction overtakes a snapshot
+constexpr int kSnapshotAttempts = 3;
+
+} // namespace
+
+class ReplayBuffer::Impl {
+public:
+    void configure(const ReplayBufferConfig& newConfig) {
+        std::lock_guard<std::mutex> lock(mutex);
+        resetLocked();
+        config = newConfig;
+        arena.reset();
+        capacity = 0;
+        if (config.capacityBytes > 0 && config.seconds > 0) {
+            // Allocated once; pages are only touched as the ring fills
+            arena.reset(new uint8_t[config.capacityBytes]);
+            capacity = config.capacityBytes;
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        resetLocked();
+    }
+
+    bool isEnabled() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity > 0;
+    }
+
+    void push(const AVPacket* packet) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (capacity == 0) {
+            return;
+        }
+
+        if (packet->pts == AV_NOPTS_VALUE) {
+            extradata.assign(packet->data, packet->data + packet->size);
+            return;
+        }
+
+        const size_t size = static_cast<size_t>(packet->size);
+        const bool keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+        if (size == 0) {
+            return;
+        }
+        if (size > capacity) {
+            // The packets after this one reference it; start over at the
+            // next keyframe
+            rejected++;
+            evicted += entries.size();
+            resetEntries();
+            return;
+        }
+        if (entries.empty() && !keyframe) {
+            // The ring always starts with a keyframe
+            return;
+        }
+
+        size_t pos = tail;
+        if (pos + size > capacity) {
+            // No room before the end of the arena; skip the gap and wrap.
+            // Entries at or past the tail are the oldest ones.
+            while (!entries.empty() && entries.front().offset >= tail) {
+                popFront();
+            }
+            pos = 0;
+        }
+        while (!entries.empty() && overlaps(entries.front(), pos, size)) {
+            popFront();
+        }
+        // A GOP without its keyframe is useless
+        while (!entries.empty() && !entries.front().keyframe) {
+            popFront();
+        }
+        if (entries.empty()) {
+            if (!keyframe) {
+                evicted++;
+                return;
+            }
+            pos = 0;
+        }
+
+        std::memcpy(arena.get() + pos, packet->data, size);
+        if (keyframe) {
+            keyframes.push_back(frontSeq + entries.size());
+        }
+        entries.push_back({pos, size, packet->pts, keyframe});
+        tail = pos + size;
+        bytesUsed += size;
+
+        // Drop whole GOPs while the next one still covers the window
+        const int64_t windowStart = packet->pts - static_cast<int64_t>(config.seconds) * 1000000;
+        while (keyframes.size() >= 2 && entryAt(keyframes[1]).pts <= windowStart) {
+            const uint64_t next = keyframes[1];
+            while (frontSeq < next) {
+                popFront();
+            }
+        }
+    }
+
+    // The copy can run to the whole arena, so it goes in chunks and the
+    // reader's push() only ever waits for one of them
+    bool snapshot(int seconds, ReplayClip& clip) const {
+        for (int attempt = 0; attempt < kSnapshotAttempts; ++attempt) {
+            uint64_t next = 0;
+            uint64_t end = 0;
+            size_t total = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                clip.extradata = extradata;
+                if (keyframes.empty()) {
+                    clip.data.clear();
+                    clip.packets.clear();
+                    return false;
+                }
+
+                // The latest keyframe that still gives the requested length,
+                // or the oldest one if the ring is shorter than that
+                const int64_t target = entries.back().pts - static_cast<int64_t>(seconds) * 1000000;
+                next = keyframes.front();
+                for (auto it = keyframes.rbegin(); it != keyframes.rend(); ++it) {
+                    if (entryAt(*it).pts <= target) {
+                        next = *it;
+                        break;
+                    }
+                }
+                // Packets pushed from here on are not part of the clip
+                end = frontSeq + entries.size();
+                for (uint64_t seq = next; seq < end; ++seq) {
+                    total += entryAt(seq).size;
+                }
+            }
+
+            clip.data.clear();
+            clip.packets.clear();
+            clip.data.reserve(total);
+            clip.packets.reserve(static_cast<size_t>(end - next));
+            if (copyRange(next, end, clip)) {
+                return true;
+            }
+        }
+        // Only if the ring wrapped over the clip while it was being copied
+        utils::Logger::getInstance().warn("Replay buffer overwritten during snapshot");
+        clip.data.clear();
+        clip.packets.clear();
+        return false;
+    }
+
+    ReplayBufferStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        ReplayBufferStats stats;
+        stats.packets = entries.size();
+        stats.keyframes = keyframes.size();
+        stats.bytesUsed = bytesUsed;
+        stats.capacityBytes = capacity;
+        if (!entries.empty()) {
+            stats.durationUs = entries.back().pts - entries.front().pts;
+        }
+        stats.evicted = evicted;
+        stats.rejected = rejected;
+        return stats;
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+        int64_t pts;
+        bool keyframe;
+    };
+
+    // Append entries [next, end) to the clip, a chunk per lock. An entry
+    // still in the ring has its bytes intact, since push() evicts before
+    // it overwrites; false if eviction overtook the copy.
+    bool copyRange(uint64_t next, uint64_t end, ReplayClip& clip) const {
+        while (next < end) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next < frontSeq) {
+                return false;
+            }
+            size_t copied = 0;
+            while (next < end && copied < kSnapshotChunkBytes) {
+                const Entry& entry = entryAt(next);
+                const uint8_t* source = arena.get() + entry.offset;
+                clip.packets.push_back({clip.data.size(), static_cast<int>(entry.size), entry.pts, entry.keyframe});
+                clip.data.insert(clip.data.end(), source, source + entry.size);
+                copied += entry.size;
+                next++;
+            }
+        }
+        return true;
+    }
+
+    static bool overlaps(const Entry& entry, size_t pos, size_t size) {
+        return entry.offset < pos + size && entry.offset + entry.size > pos;
+    }
+
+    const Entry& entryAt(uint64_t seq) const {
+        return entries[static_cast<size_t>(seq - frontSeq)];
+    }
+
+    void popFront() {
+        if (!keyframes.empty() && keyframes.front() == frontSeq) {
+            keyframes.pop_front();
+        }
+        bytesUsed -= entries.front().size;
+        entries.pop_front();
+        frontSeq++;
+        evicted++;
+    }
+
+    void resetEntries() {
+        frontSeq += entries.size();
+        entries.clear();
+        keyframes.clear();
+        tail = 0;
+        bytesUsed = 0;
+    }
+
+    void resetLocked() {
+        resetEntries();
+        extradata.clear();
+        evicted = 0;
+        rejected = 0;
+    }
+
+    mutable std::mutex mutex;
+    ReplayBufferConfig config;
+    std::unique_ptr<uint8_t[]> arena;
+    size_t capacity = 0;
+    size_t tail = 0;         // Where the next packet goes
+    size_t bytesUsed = 0;
+
+    std::deque<Entry> entries;
+    std::deque<uint64_t> keyframes;  // Sequence numbers of keyframe entries
+    uint64_t frontSeq = 0;           // Sequence number of entries.front()
+    std::vector<uint8_t> extradata;
+
+    uint64_t evicted = 0;
+    uint64_t rejected = 0;
+};
+
+ReplayBuffer::ReplayBuffer() : pimpl(std::make_unique<Impl>()) {}
+
+ReplayBuffer::~ReplayBuffer() = default;
+
+void ReplayBuffer::configure(const ReplayBufferConfig& config) {
+    pimpl->configure(config);
+}
+
+void ReplayBuffer::clear() {
+    pimpl->clear();
+}
+
+bool ReplayBuffer::isEnabled() const {
+    return pimpl->isEnabled();
+}
+
+void ReplayBuffer::push(const AVPacket* packet) {
+    pimpl->push(packet);
+}
+
+bool ReplayBuffer::snapshot(int seconds, ReplayClip& clip) const {
+    return pimpl->snapshot(seconds, clip);
+}
+
+bool ReplayBuffer::save(const std::string& path, int seconds, const MuxerStreamInfo& info) const {
+    // Copy out first, then mux without the lock so capture is never held
+    // up by the disk
+    ReplayClip clip;
+    if (!pimpl->snapshot(seconds, clip)) {
+        utils::Logger::getInstance().warn("Replay buffer holds no keyframe yet");
+        return false;
+    }
+
+    MuxerStreamInfo stream = info;
+    if (stream.extradata.empty()) {
+        stream.extradata = clip.extradata;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) {
+        return false;
+    }
+
+    PacketMuxer muxer;
+    bool ok = true;
+    for (size_t i = 0; i < clip.packets.size() && ok; ++i) {
+        const ReplayClip::Packet& entry = clip.packets[i];
+        if (av_new_packet(packet, entry.size) < 0) {
+            ok = false;
+            break;
+        }
+        std::memcpy(packet->data, clip.data.data() + entry.offset, entry.size);
+        packet->pts = entry.pts;
+        packet->flags = entry.keyframe ? AV_PKT_FLAG_KEY : 0;
+
+        if (i == 0) {
+            if (stream.extradata.empty()) {
+                PacketMuxer::extractExtradata(stream.codecId, packet, stream.extradata);
+            }
+            if (!muxer.open(path, stream)) {
+                ok = false;
+                break;
+            }
+        }
+        ok = muxer.write(packet);
+    }
+    av_packet_free(&packet);
+
+    if (!muxer.close()) {
+        ok = false;
+    }
+    if (ok) {
+        utils::Logger::getInstance().info("Saved ", clip.durationUs() / 1000, " ms replay to ", path);
+    }
+    return ok;
+}
+
+ReplayBufferStats ReplayBuffer::getStats() const {
+    return pimpl->getStats();
+}
+
+} // namespace mirrolink
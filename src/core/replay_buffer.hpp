@@ -0,0 +1,86 @@
+#pragma once
+
+#include "packet_muxer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AVPacket;
+
+namespace mirrolink {
+
+struct ReplayBufferConfig {
+    size_t capacityBytes = 64 * 1024 * 1024;  // Fixed arena for packet payloads
+    int seconds = 30;                         // History kept, rounded out to a keyframe
+};
+
+struct ReplayBufferStats {
+    size_t packets = 0;
+    size_t keyframes = 0;
+    size_t bytesUsed = 0;       // Payload bytes held
+    size_t capacityBytes = 0;
+    int64_t durationUs = 0;     // Oldest to newest packet
+    uint64_t evicted = 0;       // Packets pushed out by the time or byte limit
+    uint64_t rejected = 0;      // Packets larger than the whole arena
+};
+
+// Packets copied out of the ring, starting at a keyframe
+struct ReplayClip {
+    struct Packet {
+        size_t offset = 0;      // Into data
+        int size = 0;
+        int64_t pts = 0;
+        bool keyframe = false;
+    };
+
+    std::vector<uint8_t> data;
+    std::vector<Packet> packets;
+    std::vector<uint8_t> extradata;  // Latest config packet, if any
+
+    int64_t durationUs() const {
+        return packets.empty() ? 0 : packets.back().pts - packets.front().pts;
+    }
+};
+
+// Keeps the last few seconds of the encoded stream in memory so that they
+// can be written out after the fact. Payloads are copied into one arena
+// allocated up front; the oldest packets are overwritten when it fills, so
+// memory use never grows past the configured budget. Whole GOPs are
+// evicted at a time, which keeps a keyframe at the front of the ring.
+class ReplayBuffer {
+public:
+    ReplayBuffer();
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    // Drop everything and reallocate. A zero capacity or duration disables
+    // the buffer.
+    void configure(const ReplayBufferConfig& config);
+    void clear();
+    bool isEnabled() const;
+
+    // Copy a packet in. Config packets (no pts) replace the stored
+    // extradata; other packets need a pts in microseconds.
+    void push(const AVPacket* packet);
+
+    // Copy out the packets from the last keyframe at or before
+    // `seconds` ago, up to the newest packet. Returns false if the buffer
+    // holds no keyframe yet.
+    bool snapshot(int seconds, ReplayClip& clip) const;
+
+    // Snapshot and remux into a file. Stream info extradata, if empty, is
+    // filled in from the buffered config packet.
+    bool save(const std::string& path, int seconds, const MuxerStreamInfo& info) const;
+
+    ReplayBufferStats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+
+} // namespace mirrolink
@@ -1,27 +1,106 @@
 #include "screen_mirror.hpp"
 #include "../utils/logger.hpp"
 #include "../utils/error.hpp"
+#include "../utils/spsc_queue.hpp"
+#include "../utils/thread_pool.hpp"
+#include "color_convert.hpp"
+#include "adb_client.hpp"
+#include "control_channel.hpp"
+#include "packet_reader.hpp"
+#include "server_tunnel.hpp"
+#include "recorder.hpp"
+#include "replay_buffer.hpp"
+#include "image_encoder.hpp"
+#include "load_shedder.hpp"
+#include "bitrate_controller.hpp"
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
 #include <array>
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <fstream>
 #include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
+#include <poll.h>
 #include <unistd.h>
 
 namespace mirrolink {
 
+namespace {
+
+// Local end of the adb forward to the scrcpy server
+constexpr uint16_t kServerPort = 27183;
+
+// scrcpy release whose server is pushed to the device. The server refuses
+// to start for any other client version, and the options passed to it
+// are those of this release.
+constexpr const char* kServerVersion = "2.4";
+
+// How long to wait for the server's last words after it failed
+constexpr int kServerOutputWaitMs = 500;
+
+// Long side the server scales the device screen to; 0 keeps it native
+int streamMaxSize(const ScreenConfig& config) {
+    return std::max(config.width, config.height);
+}
+
+// Codecs the scrcpy server can encode, by their server option name
+struct VideoCodec {
+    const char* name;
+    AVCodecID id;
+    uint32_t streamId;  // Id in the codec header at the start of the video stream
+};
+
+constexpr VideoCodec kVideoCodecs[] = {
+    {"h264", AV_CODEC_ID_H264, 0x68323634},  // "h264"
+    {"h265", AV_CODEC_ID_HEVC, 0x68323635},  // "h265"
+    {"av1", AV_CODEC_ID_AV1, 0x00617631},    // "\0av1"
+};
+
+const VideoCodec* findVideoCodec(const std::string& name) {
+    const std::string key = name == "hevc" ? "h265" : name;
+    for (const auto& codec : kVideoCodecs) {
+        if (key == codec.name) {
+            return &codec;
+        }
+    }
+    return nullptr;
+}
+
+const VideoCodec* findVideoCodec(uint32_t streamId) {
+    for (const auto& codec : kVideoCodecs) {
+        if (streamId == codec.streamId) {
+            return &codec;
+        }
+    }
+    return nullptr;
+}
+
+// Pointer id of probe taps, clear of mouse ids and the pinch finger
+constexpr uint32_t kProbePointerId = 0xFFFFFF00;
+
+// How long a probe tap stays down, long enough for "show taps" to draw it
+constexpr auto kProbeTapHold = std::chrono::milliseconds(50);
+
+} // namespace
+
 class ScreenMirror::Impl {
 public:
-    Impl() : active(false), recording(false) {
-        inputHandler = std::make_unique<InputHandler>();
+    Impl() : active(false) {}
+    
+    ~Impl() {
+        stopRestarts();
+        stop();
     }
     
-    bool start(const ScreenConfig& config) {
+    // resumeAt starts the encoder below the configured bitrate and frame
+    // rate; set when adaptation restarts the session
+    bool start(const ScreenConfig& config, const BitrateDecision* resumeAt = nullptr) {
         PERFORMANCE_SCOPE("ScreenMirror::Start");
 
         if (active) {
@@ -30,17 +109,16 @@ public:
         }
         
         try {
-            currentConfig = config;
-            
-            // Validate configuration
-            if (config.width <= 0 || config.height <= 0) {
-                utils::Logger::getInstance().error("Invalid resolution: ", config.width, "x", config.height);
+            if (!validateConfig(config)) {
                 return false;
             }
-            if (config.maxFps <= 0 || config.maxFps > 120) {
-                utils::Logger::getInstance().error("Invalid FPS setting: ", config.maxFps);
-                return false;
+            setConfig(config);
+            if (resumeAt) {
+                streamBitrate = resumeAt->bitrate;
+                streamFps = resumeAt->maxFps;
             }
+            configureReplay(config);
+            selectVideoCodec();
             
             if (!setupAdbForward()) {
                 utils::Logger::getInstance().error("Failed to set up ADB forwarding");
@@ -58,7 +136,11 @@ public:
             utils::Logger::getInstance().debug("Video encoder initialized successfully");
             
             active = true;
-            captureThread = std::thread(&Impl::captureLoop, this);
+            if (!startPipeline()) {
+                utils::Logger::getInstance().error("Failed to start capture pipeline");
+                stop();
+                return false;
+            }
             utils::Logger::getInstance().info("Screen mirroring started with config: ",
                 config.width, "x", config.height, " @ ", config.maxFps, "fps");
             return true;
@@ -75,93 +157,646 @@ public:
             return;
         }
         
+        stopLatencyProbe();
         active = false;
-        if (captureThread.joinable()) {
-            captureThread.join();
+        stopPipeline();
+        recorder.stop();
+        replayBuffer.configure(ReplayBufferConfig{0, 0});
+        {
+            // A burst cut short delivers the frames captured so far
+            std::lock_guard<std::mutex> lock(captureMutex);
+            latestFrame.reset();
+            if (burst) {
+                burst->state->close();
+                burst.reset();
+            }
         }
-        
         cleanup();
     }
     
+    // Apply a new configuration to a running session. When the server
+    // announced the video settings extension, bitrate, fps and resolution
+    // go to the device over the control channel and the converter and
+    // texture follow the stream's new size, keeping the decoder and
+    // sockets. A stock scrcpy server cannot change them, so the session is
+    // restarted instead, as it is for changes the pipeline cannot absorb.
+    bool updateConfig(const ScreenConfig& config) {
+        if (!isActive()) {
+            return start(config);
+        }
+        if (!validateConfig(config)) {
+            return false;
+        }
+        
+        const ScreenConfig previous = getConfig();
+        if (config.videoCodec != previous.videoCodec ||
+            config.decodeProfile != previous.decodeProfile ||
+            config.decodeThreads != previous.decodeThreads ||
+            config.pipelineDepth != previous.pipelineDepth ||
+            config.recordAudio != previous.recordAudio) {
+            utils::Logger::getInstance().info("Configuration change needs a new session, restarting");
+            stop();
+            return start(config);
+        }
+        
+        // The device keeps its aspect ratio, so only the long side matters
+        const bool resized = streamMaxSize(config) != streamMaxSize(previous);
+        // Turning adaptation off has to bring the encoder back to the
+        // configured values
+        const bool videoChanged = resized ||
+            config.videoBitrate != previous.videoBitrate || config.maxFps != previous.maxFps ||
+            config.adaptiveBitrate != previous.adaptiveBitrate;
+        
+        if (videoChanged) {
+            if (!controlChannel.supports(ControlCapability::VideoSettings)) {
+                utils::Logger::getInstance().info("Server cannot change video settings in place, restarting");
+                stop();
+                return start(config);
+            }
+            VideoSettings settings;
+            settings.bitrate = static_cast<uint32_t>(config.videoBitrate);
+            settings.maxFps = static_cast<uint16_t>(config.maxFps);
+            settings.maxSize = static_cast<uint16_t>(streamMaxSize(config));
+            if (!controlChannel.sendVideoSettings(settings)) {
+                utils::Logger::getInstance().warn("Control channel unavailable, restarting session");
+                stop();
+                return start(config);
+            }
+        }
+        
+        setConfig(config);
+        if (config.replaySeconds != previous.replaySeconds ||
+            config.replayBufferBytes != previous.replayBufferBytes) {
+            // Reallocates the ring; the history so far is lost
+            configureReplay(config);
+        }
+        if (resized) {
+            // Buffers of the old size would otherwise stay in the pool
+            framePool.trim();
+        }
+        
+        utils::Logger::getInstance().info("Screen mirroring reconfigured: ",
+            config.width, "x", config.height, " @ ", config.maxFps, "fps, ",
+            config.videoBitrate, " bps");
+        return true;
+    }
+    
+    ScreenConfig getConfig() const {
+        std::lock_guard<std::mutex> lock(configMutex);
+        return currentConfig;
+    }
+    
+    // A session whose stream failed or ended stays allocated until stop()
+    // but is no longer active
+    bool isActive() const {
+        return active && !streamEnded;
+    }
+    
+    // Input is injected through the same connection as settings changes
+    ControlChannel& getControlChannel() {
+        return controlChannel;
+    }
+    
+    // Held by start(), stop() and updateConfig() from outside and by an
+    // adaptive restart, so they never interleave
+    std::mutex& getSessionMutex() {
+        return sessionMutex;
+    }
+    
     void setFrameCallback(FrameCallback cb) {
         std::lock_guard<std::mutex> lock(callbackMutex);
         frameCallback = cb;
     }
     
-    bool startRecording(const std::string& path) {
-        if (recording || !active) {
+    bool startRecording(const std::string& path, const RecordingOptions& options) {
+        if (recorder.isRecording() || !active) {
             return false;
         }
         
-        if (!initializeRecording(path)) {
+        return recorder.start(path, getStreamInfo(), options);
+    }
+    
+    void stopRecording() {
+        recorder.stop();
+    }
+    
+    RecorderStats getRecorderStats() const {
+        return recorder.getStats();
+    }
+    
+    bool saveReplay(const std::string& path, int seconds) {
+        if (!active || !replayBuffer.isEnabled()) {
+            utils::Logger::getInstance().warn("Replay buffer is not running");
             return false;
         }
+        if (seconds <= 0) {
+            seconds = getConfig().replaySeconds;
+        }
+        return replayBuffer.save(path, seconds, getStreamInfo());
+    }
+    
+    ReplayBufferStats getReplayStats() const {
+        return replayBuffer.getStats();
+    }
+    
+    std::future<Screenshot> captureScreenshot(ImageFormat format) {
+        FrameRef frame;
+        utils::ThreadPool* pool = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(captureMutex);
+            frame = latestFrame;
+            pool = getCapturePool();
+        }
+        if (!frame) {
+            std::promise<Screenshot> failed;
+            failed.set_exception(std::make_exception_ptr(utils::Error("No frame to capture")));
+            return failed.get_future();
+        }
         
-        recording = true;
-        return true;
+        // The frame stays referenced, not copied, until it is encoded
+        return pool->submit([frame, format]() {
+            Screenshot screenshot;
+            if (!ImageEncoder::encode(*frame, format, screenshot)) {
+                throw utils::Error("Screenshot encoding failed");
+            }
+            return screenshot;
+        });
     }
     
-    void stopRecording() {
-        if (!recording) {
-            return;
+    std::future<std::vector<Screenshot>> captureBurst(int count, int fps, ImageFormat format) {
+        auto state = std::make_shared<BurstState>();
+        std::future<std::vector<Screenshot>> result = state->promise.get_future();
+        if (count <= 0 || fps <= 0 || !active) {
+            state->promise.set_exception(std::make_exception_ptr(
+                utils::Error(active ? "Invalid burst parameters" : "Screen mirroring is not active")));
+            return result;
+        }
+        
+        std::lock_guard<std::mutex> lock(captureMutex);
+        if (burst) {
+            state->promise.set_exception(std::make_exception_ptr(utils::Error("A burst is already running")));
+            return result;
+        }
+        getCapturePool();
+        state->shots.resize(static_cast<size_t>(count));
+        
+        burst = std::make_unique<Burst>();
+        burst->state = std::move(state);
+        burst->count = count;
+        burst->format = format;
+        burst->interval = std::chrono::duration_cast<FrameTimestamps::Clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+        burst->nextDue = FrameTimestamps::Clock::now();
+        return result;
+    }
+    
+    FramePoolStats getFramePoolStats() const {
+        return framePool.getStats();
+    }
+    
+    PipelineStats getPipelineStats() const {
+        PipelineStats stats;
+        stats.reader = readerCounters.snapshot<utils::SpscQueue<QueuedPacket>>(nullptr);
+        stats.decoder = decoderCounters.snapshot(packetQueue.get());
+        stats.converter = converterCounters.snapshot(frameQueue.get());
+        
+        stats.decode.frames = decodedFrames.load();
+        stats.decode.lastUs = lastDecodeUs.load();
+        stats.decode.maxUs = maxDecodeUs.load();
+        stats.decode.averageUs = stats.decode.frames
+            ? static_cast<int64_t>(totalDecodeUs.load() / stats.decode.frames) : 0;
+        stats.decode.threads = decodeThreads;
+        stats.decode.codec = videoCodec.load()->name;
+        
+        stats.shedding.nonReferenceEpisodes = nonReferenceEpisodes.load();
+        stats.shedding.keyframeEpisodes = keyframeEpisodes.load();
+        stats.shedding.droppedPackets = droppedPackets.load();
+        stats.shedding.nonReferencePackets = nonReferencePackets.load();
+        stats.shedding.level = sheddingLevel.load();
+        stats.shedding.lagMs = packetLagMs.load();
+        
+        stats.adaptation.enabled = adaptiveBitrate.load();
+        stats.adaptation.inPlace = controlChannel.supports(ControlCapability::VideoSettings);
+        stats.adaptation.bitrate = streamBitrate.load();
+        stats.adaptation.maxFps = streamFps.load();
+        stats.adaptation.receivedBps = receivedBps.load();
+        stats.adaptation.decreases = bitrateDecreases.load();
+        stats.adaptation.increases = bitrateIncreases.load();
+        stats.adaptation.restarts = adaptiveRestarts.load();
+        return stats;
+    }
+    
+    void recordPresentedFrame(const FrameTimestamps& timestamps) {
+        recordLatency(uploadLatency, timestamps.converted, timestamps.uploaded);
+        recordLatency(presentLatency, timestamps.uploaded, timestamps.presented);
+        recordLatency(totalLatency, timestamps.received, timestamps.presented);
+        latencyProbe.onPresented(timestamps);
+    }
+    
+    LatencyStats getLatencyStats() const {
+        LatencyStats stats;
+        stats.decode = decodeLatency.summary();
+        stats.convert = convertLatency.summary();
+        stats.upload = uploadLatency.summary();
+        stats.present = presentLatency.summary();
+        stats.total = totalLatency.summary();
+        return stats;
+    }
+    
+    bool dumpLatencyStats(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            utils::Logger::getInstance().error("Could not open latency dump file: ", path);
+            return false;
+        }
+        
+        const std::pair<const char*, const utils::LatencyHistogram*> stages[] = {
+            {"decode", &decodeLatency},
+            {"convert", &convertLatency},
+            {"upload", &uploadLatency},
+            {"present", &presentLatency},
+            {"total", &totalLatency},
+            {"input_to_frame", &latencyProbe.getFrameLatency()},
+            {"input_to_photon", &latencyProbe.getPhotonLatency()},
+        };
+        
+        for (const auto& [name, histogram] : stages) {
+            const utils::LatencySummary summary = histogram->summary();
+            out << "# " << name << ": count " << summary.count
+                << ", mean " << summary.meanMs << " ms, p50 " << summary.p50Ms
+                << " ms, p99 " << summary.p99Ms << " ms, p99.9 " << summary.p999Ms
+                << " ms, max " << summary.maxMs << " ms\n";
+        }
+        for (const auto& [name, histogram] : stages) {
+            out << "\n# " << name << " distribution: value_ms percentile count\n";
+            histogram->writeDistribution(out);
         }
         
-        recording = false;
-        cleanupRecording();
+        return static_cast<bool>(out);
+    }
+    
+    bool startLatencyProbe(const LatencyProbeConfig& config, InputHandler& input) {
+        if (!active) {
+            utils::Logger::getInstance().error("Latency probe needs a running session");
+            return false;
+        }
+        
+        LatencyProbe::Stimulus stimulus;
+        if (config.stimulus == ProbeStimulus::Tap) {
+            const TouchEvent down{
+                kProbePointerId,
+                config.regionX + config.regionWidth / 2.0f,
+                config.regionY + config.regionHeight / 2.0f,
+                true
+            };
+            stimulus = [&input, down]() {
+                input.sendTouchEvent(down);
+                std::this_thread::sleep_for(kProbeTapHold);
+                TouchEvent up = down;
+                up.pressed = false;
+                input.sendTouchEvent(up);
+            };
+        } else {
+            const KeyboardEvent press{config.keycode, true, false, false, false};
+            stimulus = [&input, press]() {
+                input.sendKeyEvent(press);
+                KeyboardEvent release = press;
+                release.pressed = false;
+                input.sendKeyEvent(release);
+            };
+        }
+        
+        if (config.stimulus == ProbeStimulus::Tap) {
+            showTaps(true);
+        }
+        // A run with a sample count ends by itself, without stopLatencyProbe()
+        if (!latencyProbe.start(config, std::move(stimulus), [this]() { finishLatencyProbe(); })) {
+            showTaps(false);
+            return false;
+        }
+        utils::Logger::getInstance().info("Latency probe started");
+        return true;
+    }
+    
+    void stopLatencyProbe() {
+        // Joins the probe thread, which has restored show taps by then
+        latencyProbe.stop();
+    }
+    
+    LatencyProbeStats getLatencyProbeStats() const {
+        return latencyProbe.getStats();
     }
 
 private:
+    // On the probe thread, once a run is over
+    void finishLatencyProbe() {
+        showTaps(false);
+        
+        const LatencyProbeStats stats = latencyProbe.getStats();
+        utils::Logger::getInstance().info("Latency probe: ", stats.detected, " of ", stats.probes,
+            " inputs answered, input to frame p50 ", stats.inputToFrame.p50Ms,
+            "ms p99 ", stats.inputToFrame.p99Ms, "ms, input to photon p50 ", stats.inputToPhoton.p50Ms,
+            "ms p99 ", stats.inputToPhoton.p99Ms, "ms");
+    }
+    
+    // Turn Android's "show taps" on for the probe, then back to what it was
+    void showTaps(bool enable) {
+        std::lock_guard<std::mutex> lock(showTapsMutex);
+        try {
+            if (enable && !showTapsChanged) {
+                std::string previous = AdbCommand::execute("shell settings get system show_touches", false);
+                previous.erase(previous.find_last_not_of(" \r\n") + 1);
+                showTapsBefore = previous == "1" ? "1" : "0";
+                AdbCommand::execute("shell settings put system show_touches 1", false);
+                showTapsChanged = true;
+            } else if (!enable && showTapsChanged) {
+                AdbCommand::execute("shell settings put system show_touches " + showTapsBefore, false);
+                showTapsChanged = false;
+            }
+        } catch (const utils::Error& e) {
+            utils::Logger::getInstance().warn("Could not change show taps setting: ", e.what());
+        }
+    }
+
+    bool validateConfig(const ScreenConfig& config) const {
+        const bool native = config.width == 0 && config.height == 0;
+        if (!native && (config.width <= 0 || config.height <= 0 || streamMaxSize(config) > 0xFFFF)) {
+            utils::Logger::getInstance().error("Invalid resolution: ", config.width, "x", config.height);
+            return false;
+        }
+        if (config.maxFps <= 0 || config.maxFps > 120) {
+            utils::Logger::getInstance().error("Invalid FPS setting: ", config.maxFps);
+            return false;
+        }
+        if (config.pipelineDepth <= 0) {
+            utils::Logger::getInstance().error("Invalid pipeline depth: ", config.pipelineDepth);
+            return false;
+        }
+        if (config.decodeProfile != "lowlatency" && config.decodeProfile != "throughput") {
+            utils::Logger::getInstance().error("Unknown decode profile: ", config.decodeProfile);
+            return false;
+        }
+        if (!findVideoCodec(config.videoCodec)) {
+            utils::Logger::getInstance().error("Unknown video codec: ", config.videoCodec);
+            return false;
+        }
+        if (config.adaptiveBitrate &&
+            (config.minBitrate <= 0 || config.minBitrate > config.videoBitrate ||
+             config.minFps <= 0 || config.minFps > config.maxFps)) {
+            utils::Logger::getInstance().error("Invalid adaptive bitrate bounds: ",
+                config.minBitrate, "-", config.videoBitrate, " bps, ",
+                config.minFps, "-", config.maxFps, "fps");
+            return false;
+        }
+        if (config.replaySeconds < 0) {
+            utils::Logger::getInstance().error("Invalid replay length: ", config.replaySeconds);
+            return false;
+        }
+        return true;
+    }
+    
+    // Results of one burst, filled in by the encoding threads
+    struct BurstState {
+        std::mutex mutex;
+        std::vector<Screenshot> shots;
+        std::promise<std::vector<Screenshot>> promise;
+        int captured = 0;   // Frames handed to the encoders
+        int pending = 0;    // Of those, still encoding
+        bool closed = false;
+        bool failed = false;
+        
+        void started() {
+            std::lock_guard<std::mutex> lock(mutex);
+            captured++;
+            pending++;
+        }
+        
+        void finished(int slot, bool ok, Screenshot&& screenshot) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                shots[static_cast<size_t>(slot)] = std::move(screenshot);
+            } else {
+                failed = true;
+            }
+            pending--;
+            deliver();
+        }
+        
+        // No more frames will be captured
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            shots.resize(static_cast<size_t>(captured));
+            deliver();
+        }
+        
+        void deliver() {
+            if (!closed || pending > 0) {
+                return;
+            }
+            if (failed) {
+                promise.set_exception(std::make_exception_ptr(utils::Error("Burst encoding failed")));
+            } else {
+                promise.set_value(std::move(shots));
+            }
+            pending = -1;  // Delivered
+        }
+    };
+    
+    struct Burst {
+        std::shared_ptr<BurstState> state;
+        int count = 0;
+        ImageFormat format = ImageFormat::QOI;
+        FrameTimestamps::Clock::duration interval{};
+        FrameTimestamps::Clock::time_point nextDue;
+    };
+    
+    // Encoding runs on half the cores so the decoder and renderer keep theirs
+    utils::ThreadPool* getCapturePool() {
+        if (!capturePool) {
+            capturePool = std::make_unique<utils::ThreadPool>(
+                std::max(1u, std::thread::hardware_concurrency() / 2));
+        }
+        return capturePool.get();
+    }
+    
+    // Called by the converter thread for every frame; only takes references
+    // and queues work, so capturing never holds up the live view
+    void captureFrame(const FrameRef& frameRef) {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        latestFrame = frameRef;
+        
+        if (!burst) {
+            if (trimAfterBurst && capturePool->pending() == 0) {
+                // Buffers held for the burst are not needed any more
+                framePool.trim();
+                trimAfterBurst = false;
+            }
+            return;
+        }
+        
+        const auto now = FrameTimestamps::Clock::now();
+        if (now < burst->nextDue) {
+            return;
+        }
+        burst->nextDue = std::max(burst->nextDue + burst->interval, now);
+        
+        std::shared_ptr<BurstState> state = burst->state;
+        const int slot = state->captured;
+        const ImageFormat format = burst->format;
+        state->started();
+        capturePool->submit([state, slot, frameRef, format]() {
+            Screenshot screenshot;
+            bool ok = false;
+            try {
+                ok = ImageEncoder::encode(*frameRef, format, screenshot);
+            } catch (const std::exception& e) {
+                utils::Logger::getInstance().error("Burst frame encoding failed: ", e.what());
+            }
+            state->finished(slot, ok, std::move(screenshot));
+        });
+        
+        if (slot + 1 == burst->count) {
+            state->close();
+            burst.reset();
+            trimAfterBurst = true;
+        }
+    }
+    
+    void configureReplay(const ScreenConfig& config) {
+        ReplayBufferConfig replay;
+        replay.seconds = config.replaySeconds;
+        replay.capacityBytes = config.replaySeconds > 0 ? config.replayBufferBytes : 0;
+        replayBuffer.configure(replay);
+    }
+    
+    // Packets are remuxed as received, so files get the stream's real size
+    // and parameter sets rather than the requested ones
+    MuxerStreamInfo getStreamInfo() const {
+        MuxerStreamInfo info;
+        info.codecId = codec ? codec->id : AV_CODEC_ID_H264;
+        const ScreenConfig config = getConfig();
+        info.width = decodedWidth > 0 ? decodedWidth.load() : config.width;
+        info.height = decodedHeight > 0 ? decodedHeight.load() : config.height;
+        std::lock_guard<std::mutex> lock(streamConfigMutex);
+        info.extradata = streamConfig;
+        return info;
+    }
+    
+    void setConfig(const ScreenConfig& config) {
+        std::lock_guard<std::mutex> lock(configMutex);
+        currentConfig = config;
+        output.format = config.outputFormat;
+        streamBitrate = config.videoBitrate;
+        streamFps = config.maxFps;
+        loadShedding = config.loadShedding;
+        adaptiveBitrate = config.adaptiveBitrate;
+        // The adaptation thread restarts the controller from the new bounds
+        adaptationReset = true;
+    }
+    
+    // What the converter produces; read once per frame by the converter
+    // thread and changed by updateConfig
+    struct OutputSettings {
+        PixelFormat format = PixelFormat::YUV420P;
+    };
+    
+    OutputSettings getOutputSettings() const {
+        std::lock_guard<std::mutex> lock(configMutex);
+        return output;
+    }
+    
+    // Talks to the adb server directly; no adb process is spawned
     bool setupAdbForward() {
-        // Start scrcpy server on device
-        std::array<char, 128> buffer;
-        std::string result;
+        AdbClient& adb = AdbCommand::client();
         
         // Push scrcpy-server to device
-        std::string cmd = "adb push scrcpy-server /data/local/tmp/";
-        FILE* pipe = popen(cmd.c_str(), "r");
-        if (!pipe) {
-            utils::Logger::getInstance().error("Failed to push scrcpy server");
+        AdbStatus status = adb.push("scrcpy-server", "/data/local/tmp/scrcpy-server");
+        if (!status) {
+            utils::Logger::getInstance().error("Failed to push scrcpy server: ", status.error);
             return false;
         }
-        while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-            result += buffer.data();
-        }
-        pclose(pipe);
         
-        // Start server
-        cmd = "adb shell CLASSPATH=/data/local/tmp/scrcpy-server app_process / com.genymobile.scrcpy.Server " 
-              + std::to_string(currentConfig.width) + " "
-              + std::to_string(currentConfig.maxFps) + " "
-              + std::to_string(currentConfig.videoBitrate);
-              
-        pipe = popen(cmd.c_str(), "r");
-        if (!pipe) {
-            utils::Logger::getInstance().error("Failed to start scrcpy server");
+        // Start server; it runs for as long as its shell stream stays open.
+        // The client version comes first, then key=value options only. With
+        // audio off the server accepts the video socket, sends the dummy
+        // byte on it, then accepts the control socket. Only then does the
+        // video stream start, with a codec header so the decoder can follow
+        // whatever the device actually encodes.
+        std::string cmd = std::string("CLASSPATH=/data/local/tmp/scrcpy-server app_process / com.genymobile.scrcpy.Server ")
+              + kServerVersion
+              + " tunnel_forward=true audio=false control=true"
+              + " video_codec=" + videoCodec.load()->name
+              + " max_size=" + std::to_string(streamMaxSize(currentConfig))
+              + " max_fps=" + std::to_string(streamFps.load())
+              + " video_bit_rate=" + std::to_string(streamBitrate.load())
+              + " send_device_meta=false send_dummy_byte=true send_codec_meta=true";
+        
+        AdbResult<AdbStream> server = adb.openShell(cmd);
+        if (!server) {
+            utils::Logger::getInstance().error("Failed to start scrcpy server: ", server.error);
             return false;
         }
-        pclose(pipe);
+        serverShell = std::move(server.value);
         
         // Forward local port
-        cmd = "adb forward tcp:27183 localabstract:scrcpy";
-        pipe = popen(cmd.c_str(), "r");
-        if (!pipe) {
-            utils::Logger::getInstance().error("Failed to set up port forwarding");
+        status = adb.forward("tcp:" + std::to_string(kServerPort), "localabstract:scrcpy");
+        if (!status) {
+            utils::Logger::getInstance().error("Failed to set up port forwarding: ", status.error);
+            serverShell.close();
             return false;
         }
-        pclose(pipe);
         
         return true;
     }
     
+    // Log what the server printed before it gave up, most often that the
+    // scrcpy-server on the device is another version
+    void reportServerFailure() {
+        const int fd = serverShell.fd();
+        std::string output;
+        char buffer[512];
+        struct pollfd pollFd{fd, POLLIN, 0};
+        while (fd >= 0 && output.size() < 4096 && poll(&pollFd, 1, kServerOutputWaitMs) > 0) {
+            const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                break;
+            }
+            output.append(buffer, static_cast<size_t>(n));
+        }
+        output.erase(output.find_last_not_of(" \r\n") + 1);
+        
+        if (output.find("does not match the client") != std::string::npos) {
+            utils::Logger::getInstance().error("scrcpy-server on the device is not version ",
+                kServerVersion, ": ", output);
+        } else if (!output.empty()) {
+            utils::Logger::getInstance().error("scrcpy server: ", output);
+        }
+    }
+    
     void cleanupAdbForward() {
-        system("adb forward --remove tcp:27183");
+        AdbStatus status = AdbCommand::client().removeForward("tcp:" + std::to_string(kServerPort));
+        if (!status) {
+            utils::Logger::getInstance().debug("Removing port forward: ", status.error);
+        }
+        // Closing the shell stream stops the server
+        serverShell.close();
+    }
+    
+    // Pick the configured codec if FFmpeg can decode it, H.264 otherwise
+    void selectVideoCodec() {
+        const VideoCodec* selected = findVideoCodec(currentConfig.videoCodec);
+        if (!avcodec_find_decoder(selected->id)) {
+            utils::Logger::getInstance().warn("No ", selected->name, " decoder available, falling back to h264");
+            selected = &kVideoCodecs[0];
+        }
+        videoCodec = selected;
     }
     
     bool initializeEncoder() {
-        // Initialize FFmpeg components for H.264 decoding
-        codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+        codec = avcodec_find_decoder(videoCodec.load()->id);
         if (!codec) {
-            utils::Logger::getInstance().error("H.264 codec not found");
+            utils::Logger::getInstance().error(videoCodec.load()->name, " decoder not found");
             return false;
         }
         
@@ -177,6 +812,7 @@ private:
         codecContext->time_base = (AVRational){1, currentConfig.maxFps};
         codecContext->framerate = (AVRational){currentConfig.maxFps, 1};
         codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+        applyDecodeProfile();
         
         if (avcodec_open2(codecContext, codec, nullptr) < 0) {
             utils::Logger::getInstance().error("Could not open codec");
@@ -184,22 +820,77 @@ private:
             return false;
         }
         
-        // Initialize conversion context for YUV to RGB
-        swsContext = sws_getContext(
-            currentConfig.width, currentConfig.height, AV_PIX_FMT_YUV420P,
-            currentConfig.width, currentConfig.height, AV_PIX_FMT_RGBA,
-            SWS_BILINEAR, nullptr, nullptr, nullptr
-        );
+        utils::Logger::getInstance().info("Video codec: ", videoCodec.load()->name, " (", codec->name, ")");
+        // The RGBA conversion context is created lazily in produceFrame,
+        // once the decoded frame size and format are known
+        return true;
+    }
+    
+    // Read the codec header the server sends before the first packet. A
+    // server that could not encode the requested codec reports the one it
+    // fell back to; the decoder is switched before any packet reaches it.
+    bool readCodecHeader(int sockfd) {
+        uint8_t header[12];
+        size_t received = 0;
+        while (received < sizeof(header)) {
+            const ssize_t n = recv(sockfd, header + received, sizeof(header) - received, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                utils::Logger::getInstance().error("Video stream closed before the codec header");
+                return false;
+            }
+            received += static_cast<size_t>(n);
+        }
         
-        if (!swsContext) {
-            utils::Logger::getInstance().error("Could not initialize conversion context");
-            cleanupEncoder();
+        const uint32_t streamId = static_cast<uint32_t>(header[0]) << 24 | static_cast<uint32_t>(header[1]) << 16 |
+                                  static_cast<uint32_t>(header[2]) << 8 | header[3];
+        const VideoCodec* streamCodec = findVideoCodec(streamId);
+        const uint32_t width = static_cast<uint32_t>(header[4]) << 24 | static_cast<uint32_t>(header[5]) << 16 |
+                               static_cast<uint32_t>(header[6]) << 8 | header[7];
+        const uint32_t height = static_cast<uint32_t>(header[8]) << 24 | static_cast<uint32_t>(header[9]) << 16 |
+                                static_cast<uint32_t>(header[10]) << 8 | header[11];
+        controlChannel.setScreenSize(static_cast<uint16_t>(width), static_cast<uint16_t>(height));
+        if (!streamCodec) {
+            utils::Logger::getInstance().error("Unknown codec in video stream: ", streamId);
             return false;
         }
-        
+        if (streamCodec != videoCodec) {
+            utils::Logger::getInstance().warn("Server sends ", streamCodec->name, " instead of ", videoCodec.load()->name);
+            cleanupEncoder();
+            videoCodec = streamCodec;
+            if (!initializeEncoder()) {
+                return false;
+            }
+        }
         return true;
     }
     
+    void applyDecodeProfile() {
+        int threads = currentConfig.decodeThreads;
+        if (threads <= 0) {
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        
+        if (currentConfig.decodeProfile == "throughput") {
+            // Frame threading decodes several frames in parallel at the
+            // cost of threads - 1 frames of output delay
+            codecContext->thread_type = FF_THREAD_FRAME;
+            codecContext->thread_count = threads;
+        } else {
+            // Slice threading splits each frame across cores without holding
+            // frames back; low-delay output skips the reordering buffer
+            codecContext->thread_type = FF_THREAD_SLICE;
+            codecContext->thread_count = threads;
+            codecContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        }
+        
+        decodeThreads = threads;
+        utils::Logger::getInstance().info("Decode profile: ", currentConfig.decodeProfile,
+            " with ", threads, " threads");
+    }
+    
     void cleanupEncoder() {
         if (swsContext) {
             sws_freeContext(swsContext);
@@ -210,204 +901,895 @@ private:
         }
     }
     
-    bool initializeRecording(const std::string& path) {
-        if (recording) {
-            return false;
+    bool startPipeline() {
+        const size_t depth = static_cast<size_t>(currentConfig.pipelineDepth);
+        packetQueue = std::make_unique<utils::SpscQueue<QueuedPacket>>(depth);
+        freePackets = std::make_unique<utils::SpscQueue<AVPacket*>>(depth);
+        frameQueue = std::make_unique<utils::SpscQueue<QueuedFrame>>(depth);
+        freeFrames = std::make_unique<utils::SpscQueue<AVFrame*>>(depth);
+        
+        // Every packet and frame the pipeline will ever use is allocated
+        // here and circulates between a stage queue and its free list
+        for (size_t i = 0; i < depth; ++i) {
+            AVPacket* packet = av_packet_alloc();
+            AVFrame* frame = av_frame_alloc();
+            if (!packet || !frame) {
+                av_packet_free(&packet);
+                av_frame_free(&frame);
+                return false;
+            }
+            freePackets->tryPush(packet);
+            freeFrames->tryPush(frame);
         }
-
-        // Initialize output format context
-        avformat_alloc_output_context2(&formatContext, nullptr, nullptr, path.c_str());
-        if (!formatContext) {
-            utils::Logger::getInstance().error("Could not create output context");
-            return false;
+        
+        readerCounters.reset();
+        decoderCounters.reset();
+        converterCounters.reset();
+        decodedFrames = 0;
+        lastDecodeUs = 0;
+        totalDecodeUs = 0;
+        maxDecodeUs = 0;
+        socketBacklog = 0;
+        droppedPackets = 0;
+        nonReferencePackets = 0;
+        nonReferenceEpisodes = 0;
+        keyframeEpisodes = 0;
+        sheddingLevel = SkipLevel::None;
+        packetLagMs = 0;
+        receivedBps = 0;
+        bitrateDecreases = 0;
+        bitrateIncreases = 0;
+        adaptationReset = true;
+        sessionId++;
+        sessionStartedAt = std::chrono::steady_clock::now();
+        receivedBytes = 0;
+        lastPacketAt = FrameTimestamps::Clock::now();
+        streamEnded = false;
+        for (auto* histogram : {&decodeLatency, &convertLatency, &uploadLatency,
+                                &presentLatency, &totalLatency}) {
+            histogram->reset();
         }
-
-        // Add video stream
-        stream = avformat_new_stream(formatContext, codec);
-        if (!stream) {
-            utils::Logger::getInstance().error("Could not create video stream");
-            cleanupRecording();
-            return false;
+        
+        readerThread = std::thread(&Impl::readerLoop, this);
+        decoderThread = std::thread(&Impl::decoderLoop, this);
+        converterThread = std::thread(&Impl::converterLoop, this);
+        adaptationThread = std::thread(&Impl::adaptationLoop, this);
+        return true;
+    }
+    
+    void stopPipeline() {
+        {
+            // Wake the reader if it is blocked on the socket. The reader
+            // only closes the fd after taking it back under this lock, so
+            // the number cannot have been reused for another socket.
+            std::lock_guard<std::mutex> lock(socketMutex);
+            if (videoSocket >= 0) {
+                shutdown(videoSocket, SHUT_RDWR);
+            }
         }
-
-        // Configure stream
-        stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
-        stream->codecpar->codec_id = AV_CODEC_ID_H264;
-        stream->codecpar->width = currentConfig.width;
-        stream->codecpar->height = currentConfig.height;
-        stream->codecpar->format = AV_PIX_FMT_YUV420P;
-        stream->time_base = (AVRational){1, currentConfig.maxFps};
-
-        // Open output file
-        if (avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
-            utils::Logger::getInstance().error("Could not open output file");
-            cleanupRecording();
-            return false;
+        
+        {
+            // active is already false; taking the lock makes sure the
+            // adaptation thread is waiting before it is woken
+            std::lock_guard<std::mutex> lock(adaptationMutex);
         }
-
-        // Write header
-        if (avformat_write_header(formatContext, nullptr) < 0) {
-            utils::Logger::getInstance().error("Could not write header");
-            cleanupRecording();
-            return false;
+        adaptationWake.notify_all();
+        for (utils::WakeSignal* wake : {&readerWake, &decoderWake, &converterWake}) {
+            wake->notify();
         }
-
-        recordingStartTime = std::chrono::steady_clock::now();
-        return true;
-    }
-
-    void cleanupRecording() {
-        if (formatContext) {
-            if (formatContext->pb) {
-                av_write_trailer(formatContext);
-                avio_closep(&formatContext->pb);
+        
+        for (std::thread* stage : {&readerThread, &decoderThread, &converterThread, &adaptationThread}) {
+            if (stage->joinable()) {
+                stage->join();
             }
-            avformat_free_context(formatContext);
-            formatContext = nullptr;
         }
-        stream = nullptr;
+        controlChannel.close();
+        
+        // All stages have exited, so draining from this thread is safe
+        QueuedPacket queuedPacket;
+        while (packetQueue && packetQueue->tryPop(queuedPacket)) {
+            av_packet_free(&queuedPacket.packet);
+        }
+        AVPacket* packet = nullptr;
+        while (freePackets && freePackets->tryPop(packet)) {
+            av_packet_free(&packet);
+        }
+        QueuedFrame queuedFrame;
+        while (frameQueue && frameQueue->tryPop(queuedFrame)) {
+            av_frame_free(&queuedFrame.frame);
+        }
+        AVFrame* frame = nullptr;
+        while (freeFrames && freeFrames->tryPop(frame)) {
+            av_frame_free(&frame);
+        }
     }
     
-    void captureLoop() {
-        PERFORMANCE_SCOPE("ScreenMirror::CaptureLoop");
+    // Stage 1: socket -> packet queue
+    void readerLoop() {
+        PERFORMANCE_SCOPE("ScreenMirror::ReaderLoop");
         
-        int sockfd = connectToServer();
-        if (sockfd < 0) {
-            utils::Logger::getInstance().error("Failed to connect to scrcpy server");
+        // The server waits for every socket before it streams, so the
+        // control socket is connected before the codec header is read
+        ServerTunnelConfig tunnelConfig;
+        tunnelConfig.port = kServerPort;
+        ServerTunnel tunnel(tunnelConfig);
+        if (!tunnel.open(active)) {
+            if (active) {
+                utils::Logger::getInstance().error("Failed to connect to scrcpy server");
+                reportServerFailure();
+                streamEnded = true;
+            }
             return;
         }
+        const int sockfd = tunnel.takeVideoSocket();
+        {
+            std::lock_guard<std::mutex> lock(socketMutex);
+            if (!active) {
+                // Stopped while connecting; nobody will shut this one down
+                close(sockfd);
+                return;
+            }
+            videoSocket = sockfd;
+        }
+        controlChannel.attach(tunnel.takeControlSocket());
         
         utils::Logger::getInstance().debug("Connected to scrcpy server successfully");
         
-        AVPacket* packet = av_packet_alloc();
-        AVFrame* frame = av_frame_alloc();
+        if (readCodecHeader(sockfd)) {
+            readPackets(sockfd);
+        } else if (active) {
+            utils::Logger::getInstance().error("Video stream did not start");
+            reportServerFailure();
+        }
         
-        // Track frame statistics for performance monitoring
-        int frameCount = 0;
-        auto lastStatsTime = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(socketMutex);
+            videoSocket = -1;
+        }
+        close(sockfd);
+        if (active) {
+            // Nothing more will arrive; the session is over until restarted
+            streamEnded = true;
+        }
+        
+        utils::Logger::getInstance().info("Screen mirroring stopped");
+    }
+    
+    void readPackets(int sockfd) {
+        PacketReader reader(sockfd);
+        utils::Backoff backoff(readerWake);
+        AVPacket* packet = nullptr;
+        bool stalled = false;
+        lastPacketAt = FrameTimestamps::Clock::now();
         
         while (active) {
-            try {
-                // Read video packet from socket
-                if (!readVideoPacket(sockfd, packet)) {
-                    utils::Logger::getInstance().warn("Failed to read video packet, retrying...");
-                    continue;
+            // No free packet means the decoder holds all of them
+            if (!packet && !freePackets->tryPop(packet)) {
+                if (!stalled) {
+                    readerCounters.stalls++;
+                    stalled = true;
                 }
-                
-                // Decode video frame
-                if (avcodec_send_packet(codecContext, packet) < 0) {
-                    utils::Logger::getInstance().warn("Failed to send packet to decoder");
-                    continue;
+                backoff.wait([this]() { return !freePackets->empty() || !active; });
+                continue;
+            }
+            stalled = false;
+            backoff.reset();
+            
+            if (!reader.readPacket(packet)) {
+                if (reader.isClosed()) {
+                    if (active) {
+                        utils::Logger::getInstance().warn("Video stream closed");
+                    }
+                    break;
                 }
-                
-                if (avcodec_receive_frame(codecContext, frame) < 0) {
-                    utils::Logger::getInstance().warn("Failed to receive frame from decoder");
-                    continue;
+                continue;
+            }
+            
+            if (packet->pts == AV_NOPTS_VALUE) {
+                // Parameter sets, needed by recordings started later
+                std::lock_guard<std::mutex> lock(streamConfigMutex);
+                streamConfig.assign(packet->data, packet->data + packet->size);
+            }
+            recorder.push(packet);
+            replayBuffer.push(packet);
+            socketBacklog = reader.getBacklog();
+            receivedBytes += PacketReader::kHeaderSize + static_cast<uint64_t>(packet->size);
+            
+            // Cannot fail: at most pipelineDepth packets are in circulation
+            const FrameTimestamps::Clock::time_point received = FrameTimestamps::Clock::now();
+            lastPacketAt = received;
+            packetQueue->tryPush({packet, received});
+            decoderWake.notify();
+            packet = nullptr;
+            readerCounters.processed++;
+        }
+        
+        av_packet_free(&packet);
+        
+        PacketReaderStats readerStats = reader.getStats();
+        utils::Logger::getInstance().debug("Video reader: ", readerStats.packets, " packets, ",
+            readerStats.bytes, " bytes in ", readerStats.reads, " reads, ",
+            readerStats.poolResizes, " payload pool resizes");
+    }
+    
+    // Stage 2: packet queue -> decoder -> frame queue
+    void decoderLoop() {
+        PERFORMANCE_SCOPE("ScreenMirror::DecoderLoop");
+        
+        utils::Backoff backoff(decoderWake);
+        AVFrame* frame = nullptr;
+        bool idle = false;
+        PtsClock submitTimes;
+        LoadShedder shedder;
+        
+        while (active) {
+            QueuedPacket queued;
+            if (!packetQueue->tryPop(queued)) {
+                if (!idle) {
+                    decoderCounters.idleWaits++;
+                    idle = true;
+                }
+                backoff.wait([this]() { return !packetQueue->empty() || !active; });
+                continue;
+            }
+            idle = false;
+            backoff.reset();
+            
+            AVPacket* packet = queued.packet;
+            if (!shedLoad(shedder, queued)) {
+                av_packet_unref(packet);
+                freePackets->tryPush(packet);
+                readerWake.notify();
+                continue;
+            }
+            
+            submitTimes.mark(packet->pts, queued.received, std::chrono::steady_clock::now());
+            int ret = avcodec_send_packet(codecContext, packet);
+            av_packet_unref(packet);
+            freePackets->tryPush(packet);
+            readerWake.notify();
+            
+            if (ret < 0) {
+                utils::Logger::getInstance().warn("Failed to send packet to decoder");
+                continue;
+            }
+            
+            // Drain every frame this packet completed
+            while (active) {
+                if (!frame && !waitForFree(*freeFrames, frame, decoderCounters, decoderWake)) {
+                    break;
                 }
                 
-                frameCount++;
-                auto now = std::chrono::steady_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - lastStatsTime);
-                
-                // Log performance stats every 5 seconds
-                if (duration.count() >= 5) {
-                    float fps = frameCount / static_cast<float>(duration.count());
-                    utils::Logger::getInstance().debug("Mirroring performance: ", 
-                        fps, " FPS, Frame size: ", frame->width, "x", frame->height);
-                    
-                    frameCount = 0;
-                    lastStatsTime = now;
+                ret = avcodec_receive_frame(codecContext, frame);
+                if (ret < 0) {
+                    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+                        utils::Logger::getInstance().warn("Failed to receive frame from decoder");
+                    }
+                    break;
                 }
                 
-                // Convert YUV to RGBA
-                FrameData frameData;
-                frameData.width = currentConfig.width;
-                frameData.height = currentConfig.height;
-                frameData.format = AV_PIX_FMT_RGBA;
-                frameData.timestamp = frame->pts;
-                frameData.data.resize(currentConfig.width * currentConfig.height * 4);
+                QueuedFrame decoded;
+                decoded.frame = frame;
+                decoded.timestamps.decoded = FrameTimestamps::Clock::now();
                 
-                uint8_t* destSlice[] = { frameData.data.data() };
-                int destStride[] = { currentConfig.width * 4 };
+                std::chrono::steady_clock::time_point submitted;
+                if (submitTimes.take(frame->pts, decoded.timestamps.received, submitted)) {
+                    recordDecodeTime(std::chrono::duration_cast<std::chrono::microseconds>(
+                        decoded.timestamps.decoded - submitted).count());
+                    recordLatency(decodeLatency, decoded.timestamps.received, decoded.timestamps.decoded);
+                }
                 
-                sws_scale(swsContext, frame->data, frame->linesize, 0,
-                         currentConfig.height, destSlice, destStride);
+                frameQueue->tryPush(decoded);
+                converterWake.notify();
+                frame = nullptr;
+                decoderCounters.processed++;
+            }
+        }
+        
+        av_frame_free(&frame);
+    }
+    
+    // Stage 3: frame queue -> conversion -> frame callback
+    void converterLoop() {
+        PERFORMANCE_SCOPE("ScreenMirror::ConverterLoop");
+        
+        utils::Backoff backoff(converterWake);
+        bool idle = false;
+        
+        // Track frame statistics for performance monitoring
+        int frameCount = 0;
+        auto lastStatsTime = std::chrono::steady_clock::now();
+        
+        while (active) {
+            QueuedFrame queued;
+            if (!frameQueue->tryPop(queued)) {
+                if (!idle) {
+                    converterCounters.idleWaits++;
+                    idle = true;
+                }
+                backoff.wait([this]() { return !frameQueue->empty() || !active; });
+                continue;
+            }
+            idle = false;
+            backoff.reset();
+            
+            AVFrame* frame = queued.frame;
+            const int frameWidth = frame->width;
+            const int frameHeight = frame->height;
+            if (frameWidth != decodedWidth || frameHeight != decodedHeight) {
+                // Touch positions must carry the size the device now sends
+                controlChannel.setScreenSize(static_cast<uint16_t>(frameWidth), static_cast<uint16_t>(frameHeight));
+            }
+            decodedWidth = frameWidth;
+            decodedHeight = frameHeight;
+            
+            FrameRef frameRef;
+            try {
+                frameRef = produceFrame(frame);
+            } catch (const std::exception& e) {
+                utils::Logger::getInstance().error("Error converting frame: ", e.what());
+            }
+            
+            av_frame_unref(frame);
+            freeFrames->tryPush(frame);
+            decoderWake.notify();
+            
+            if (!frameRef) {
+                continue;
+            }
+            
+            frameRef->timestamps = queued.timestamps;
+            frameRef->timestamps.converted = FrameTimestamps::Clock::now();
+            recordLatency(convertLatency, queued.timestamps.decoded, frameRef->timestamps.converted);
+            
+            frameCount++;
+            auto now = std::chrono::steady_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - lastStatsTime);
+            
+            // Log performance stats every 5 seconds
+            if (duration.count() >= 5) {
+                float fps = frameCount / static_cast<float>(duration.count());
+                FramePoolStats poolStats = framePool.getStats();
+                PipelineStats pipeline = getPipelineStats();
+                utils::Logger::getInstance().debug("Mirroring performance: ", 
+                    fps, " FPS, Frame size: ", frameWidth, "x", frameHeight,
+                    ", Frame pool: ", poolStats.hits, " hits, ", poolStats.misses,
+                    " misses, high-water ", poolStats.highWaterMark,
+                    ", Queues: packets ", pipeline.decoder.occupancy, "/", pipeline.decoder.queueDepth,
+                    ", frames ", pipeline.converter.occupancy, "/", pipeline.converter.queueDepth,
+                    ", Stalls: reader ", pipeline.reader.stalls, ", decoder ", pipeline.decoder.stalls,
+                    ", Decode: avg ", pipeline.decode.averageUs, "us, max ", pipeline.decode.maxUs, "us",
+                    ", Latency: p50 ", totalLatency.percentile(50.0) / 1000.0,
+                    "ms, p99 ", totalLatency.percentile(99.0) / 1000.0, "ms");
                 
-                // Notify callback
+                frameCount = 0;
+                lastStatsTime = now;
+            }
+            
+            latencyProbe.onFrame(*frameRef);
+            captureFrame(frameRef);
+            
+            try {
                 std::lock_guard<std::mutex> lock(callbackMutex);
                 if (frameCallback) {
-                    frameCallback(frameData);
+                    frameCallback(frameRef);
                 }
-                
             } catch (const std::exception& e) {
-                utils::Logger::getInstance().error("Error in capture loop: ", e.what());
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                utils::Logger::getInstance().error("Error in frame callback: ", e.what());
+            }
+            converterCounters.processed++;
+        }
+    }
+    
+    // Stage queue entries carry the frame's timestamps along
+    struct QueuedPacket {
+        AVPacket* packet = nullptr;
+        FrameTimestamps::Clock::time_point received;
+    };
+    
+    struct QueuedFrame {
+        AVFrame* frame = nullptr;
+        FrameTimestamps timestamps;
+    };
+    
+    // State of the bitrate controller, and the counters at the start of the
+    // current interval
+    struct Adaptation {
+        BitrateController controller;
+        std::chrono::steady_clock::time_point intervalStart;
+        uint64_t bytes = 0;
+        uint64_t frames = 0;
+        int64_t decodeUs = 0;
+        uint64_t dropped = 0;
+        bool frameThreads = false;
+    };
+    
+    static constexpr std::chrono::milliseconds kAdaptationInterval{1000};
+    
+    // A stock server only takes new encoder settings at startup, and every
+    // restart costs a second or two of picture
+    static constexpr std::chrono::seconds kAdaptiveRestartInterval{30};
+    
+    // scrcpy repeats the last frame every 100ms while the screen is static,
+    // so a gap this long between packets means the link has stalled
+    static constexpr std::chrono::milliseconds kStallThreshold{500};
+    
+    // Runs the controller on its own clock rather than per packet, so a
+    // stalled link that delivers nothing at all still backs off
+    void adaptationLoop() {
+        Adaptation adaptation;
+        bool warned = false;
+        std::unique_lock<std::mutex> lock(adaptationMutex);
+        while (active) {
+            adaptationWake.wait_for(lock, kAdaptationInterval, [this]() { return !active; });
+            if (!active || !adaptiveBitrate) {
+                continue;
+            }
+            if (!warned && !controlChannel.supports(ControlCapability::VideoSettings)) {
+                utils::Logger::getInstance().info("Server cannot change video settings in place, "
+                    "adaptive bitrate restarts the session at most every ",
+                    kAdaptiveRestartInterval.count(), " s");
+                warned = true;
             }
+            lock.unlock();
+            adaptStream(adaptation);
+            lock.lock();
         }
+    }
+    
+    // Once per interval, feed what the pipeline saw to the controller and
+    // pass any new target on to the encoder
+    void adaptStream(Adaptation& adaptation) {
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t bytes = receivedBytes.load();
         
-        av_frame_free(&frame);
-        av_packet_free(&packet);
-        close(sockfd);
+        if (adaptationReset.exchange(false)) {
+            const ScreenConfig config = getConfig();
+            BitrateControllerConfig bounds;
+            bounds.minBitrate = config.minBitrate;
+            bounds.maxBitrate = config.videoBitrate;
+            bounds.minFps = config.minFps;
+            bounds.maxFps = config.maxFps;
+            adaptation.controller.reset(bounds);
+            // After a restart for adaptation the encoder runs below the bounds
+            if (streamBitrate < bounds.maxBitrate || streamFps < bounds.maxFps) {
+                adaptation.controller.resume(streamBitrate, streamFps);
+            }
+            adaptation.frameThreads = config.decodeProfile == "throughput";
+            adaptation.intervalStart = now;
+            adaptation.bytes = bytes;
+            adaptation.frames = decodedFrames.load();
+            adaptation.decodeUs = totalDecodeUs.load();
+            adaptation.dropped = droppedPackets.load();
+            return;
+        }
         
-        utils::Logger::getInstance().info("Screen mirroring stopped");
+        const auto elapsed = now - adaptation.intervalStart;
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        const uint64_t frames = decodedFrames.load();
+        const int64_t decodeUs = totalDecodeUs.load();
+        const uint64_t dropped = droppedPackets.load();
+        
+        LinkSample sample;
+        sample.receivedBps = (bytes - adaptation.bytes) * 8.0 / seconds;
+        if (frames > adaptation.frames) {
+            sample.decodeUs = (decodeUs - adaptation.decodeUs) /
+                static_cast<int64_t>(frames - adaptation.frames);
+            // Frame threads overlap several frames; each core has that long
+            if (adaptation.frameThreads) {
+                sample.decodeUs /= std::max(decodeThreads, 1);
+            }
+        }
+        const int64_t bitrate = std::max(streamBitrate.load(), 1);
+        const int64_t backlogMs = static_cast<int64_t>(socketBacklog.load()) * 8000 / bitrate;
+        sample.lagMs = std::max(backlogMs, loadShedding ? packetLagMs.load() : int64_t{0});
+        const auto idle = now - lastPacketAt.load();
+        if (idle >= kStallThreshold) {
+            sample.lagMs = std::max<int64_t>(sample.lagMs,
+                std::chrono::duration_cast<std::chrono::milliseconds>(idle).count());
+        }
+        sample.queued = packetQueue->size();
+        sample.queueDepth = packetQueue->capacity();
+        sample.droppedPackets = dropped - adaptation.dropped;
+        
+        adaptation.intervalStart = now;
+        adaptation.bytes = bytes;
+        adaptation.frames = frames;
+        adaptation.decodeUs = decodeUs;
+        adaptation.dropped = dropped;
+        receivedBps = static_cast<int64_t>(sample.receivedBps);
+        
+        const BitrateDecision decision = adaptation.controller.update(sample);
+        bitrateDecreases = adaptation.controller.getDecreases();
+        bitrateIncreases = adaptation.controller.getIncreases();
+        if (!controlChannel.supports(ControlCapability::VideoSettings)) {
+            // The target may have moved on while restarts were held back
+            if (decision.bitrate != streamBitrate || decision.maxFps != streamFps) {
+                requestRestart(decision);
+            }
+            return;
+        }
+        if (!decision.changed) {
+            return;
+        }
+        
+        const ScreenConfig config = getConfig();
+        VideoSettings settings;
+        settings.bitrate = static_cast<uint32_t>(decision.bitrate);
+        settings.maxFps = static_cast<uint16_t>(decision.maxFps);
+        settings.maxSize = static_cast<uint16_t>(streamMaxSize(config));
+        if (!controlChannel.sendVideoSettings(settings)) {
+            return;
+        }
+        streamBitrate = decision.bitrate;
+        streamFps = decision.maxFps;
+        utils::Logger::getInstance().debug("Adaptive bitrate: ", decision.bitrate, " bps @ ",
+            decision.maxFps, "fps (received ", static_cast<int64_t>(sample.receivedBps),
+            " bps, lag ", sample.lagMs, "ms, decode ", sample.decodeUs, "us)");
     }
     
-    int connectToServer() {
-        int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-        if (sockfd < 0) {
-            utils::Logger::getInstance().error("Failed to create socket");
-            return -1;
+    // Have the restart thread bring the session back up at the
+    // controller's target. Stopping the session joins this thread, so the
+    // restart cannot run here.
+    void requestRestart(const BitrateDecision& decision) {
+        if (std::chrono::steady_clock::now() - sessionStartedAt < kAdaptiveRestartInterval) {
+            return;
         }
+        // A restart would end them
+        if (recorder.isRecording() || latencyProbe.isRunning()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(restartMutex);
+            if (restartRequested || restartStopping) {
+                return;
+            }
+            restartRequested = true;
+            restartTarget = decision;
+            restartSession = sessionId;
+            if (!restartThread.joinable()) {
+                restartThread = std::thread(&Impl::restartLoop, this);
+            }
+        }
+        restartWake.notify_one();
+    }
+    
+    void restartLoop() {
+        std::unique_lock<std::mutex> lock(restartMutex);
+        while (true) {
+            restartWake.wait(lock, [this]() { return restartStopping || restartRequested; });
+            if (restartStopping) {
+                return;
+            }
+            const BitrateDecision target = restartTarget;
+            const uint64_t session = restartSession;
+            lock.unlock();
+            
+            {
+                std::lock_guard<std::mutex> sessionLock(sessionMutex);
+                // Skipped if the session was stopped or replaced meanwhile
+                if (active && sessionId == session) {
+                    utils::Logger::getInstance().info("Restarting session for adaptive bitrate: ",
+                        target.bitrate, " bps @ ", target.maxFps, "fps");
+                    const ScreenConfig config = getConfig();
+                    stop();
+                    adaptiveRestarts++;
+                    if (!start(config, &target)) {
+                        utils::Logger::getInstance().error("Session did not come back after adaptive restart");
+                    }
+                }
+            }
+            
+            lock.lock();
+            restartRequested = false;
+        }
+    }
+    
+    void stopRestarts() {
+        {
+            std::lock_guard<std::mutex> lock(restartMutex);
+            restartStopping = true;
+        }
+        restartWake.notify_all();
+        if (restartThread.joinable()) {
+            restartThread.join();
+        }
+    }
+    
+    // Decide how much to skip before decoding a packet, from how long it
+    // waited in the pipeline plus how much stream is still waiting on the
+    // socket. Returns false if the packet should be dropped.
+    bool shedLoad(LoadShedder& shedder, const QueuedPacket& queued) {
+        const AVPacket* packet = queued.packet;
+        const bool config = packet->pts == AV_NOPTS_VALUE;
+        const bool keyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
         
-        struct sockaddr_in serverAddr;
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(27183);
-        serverAddr.sin_addr.s_addr = inet_addr("127.0.0.1");
-        
-        if (connect(sockfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-            utils::Logger::getInstance().error("Failed to connect to scrcpy server");
-            close(sockfd);
-            return -1;
+        SkipLevel level = SkipLevel::None;
+        if (loadShedding && !config) {
+            const int64_t ageMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                FrameTimestamps::Clock::now() - queued.received).count();
+            const int64_t bitrate = std::max(streamBitrate.load(), 1);
+            const int64_t backlogMs = static_cast<int64_t>(socketBacklog.load()) * 8000 / bitrate;
+            const int64_t lagMs = ageMs + backlogMs;
+            packetLagMs = lagMs;
+            
+            // Without keyframe requests, dropping to the next keyframe
+            // would freeze the picture for a whole keyframe interval
+            shedder.setSkipToKeyframe(controlChannel.supports(ControlCapability::RequestKeyframe));
+            const SkipLevel previous = shedder.getLevel();
+            level = shedder.update(lagMs);
+            if (level != previous) {
+                nonReferenceEpisodes = shedder.getNonReferenceEpisodes();
+                keyframeEpisodes = shedder.getKeyframeEpisodes();
+                if (level == SkipLevel::UntilKeyframe) {
+                    utils::Logger::getInstance().warn("Decoder ", lagMs, "ms behind, skipping to the next keyframe");
+                    controlChannel.requestKeyframe();
+                } else {
+                    utils::Logger::getInstance().debug("Load shedding level ", static_cast<int>(level),
+                        " at ", lagMs, "ms behind");
+                }
+            }
+            
+            if (level == SkipLevel::UntilKeyframe) {
+                if (!keyframe) {
+                    droppedPackets++;
+                    sheddingLevel = level;
+                    return false;
+                }
+                shedder.keyframeReached();
+                level = shedder.getLevel();
+            }
+        } else if (!config) {
+            shedder = LoadShedder();
         }
         
-        return sockfd;
+        const AVDiscard discard = level == SkipLevel::None ? AVDISCARD_DEFAULT : AVDISCARD_NONREF;
+        if (codecContext->skip_frame != discard) {
+            codecContext->skip_frame = discard;
+        }
+        if (level != SkipLevel::None) {
+            nonReferencePackets++;
+        }
+        sheddingLevel = level;
+        return true;
     }
     
-    bool readVideoPacket(int sockfd, AVPacket* packet) {
-        // Read packet header (12 bytes)
-        uint8_t header[12];
-        ssize_t n = read(sockfd, header, sizeof(header));
-        if (n != sizeof(header)) {
-            return false;
+    struct StageCounters {
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> stalls{0};
+        std::atomic<uint64_t> idleWaits{0};
+        
+        void reset() {
+            processed = 0;
+            stalls = 0;
+            idleWaits = 0;
         }
         
-        // Parse packet size from header (first 4 bytes, big-endian)
-        uint32_t packetSize = (header[0] << 24) | (header[1] << 16) | 
-                             (header[2] << 8) | header[3];
+        template<typename Queue>
+        PipelineStageStats snapshot(const Queue* input) const {
+            PipelineStageStats stats;
+            stats.processed = processed.load();
+            stats.stalls = stalls.load();
+            stats.idleWaits = idleWaits.load();
+            if (input) {
+                stats.occupancy = input->size();
+                stats.queueDepth = input->capacity();
+            }
+            return stats;
+        }
+    };
+    
+    // Remembers when each pts entered a stage, so the time can be looked
+    // up when the matching frame comes out, even if frames are reordered
+    class PtsClock {
+    public:
+        void mark(int64_t pts, std::chrono::steady_clock::time_point received,
+                  std::chrono::steady_clock::time_point submitted) {
+            entries[next] = {pts, received, submitted};
+            next = (next + 1) % entries.size();
+        }
         
-        // Allocate packet data
-        if (av_new_packet(packet, packetSize) < 0) {
+        bool take(int64_t pts, std::chrono::steady_clock::time_point& received,
+                  std::chrono::steady_clock::time_point& submitted) {
+            for (auto& entry : entries) {
+                if (entry.pts == pts && pts != AV_NOPTS_VALUE) {
+                    received = entry.received;
+                    submitted = entry.submitted;
+                    entry.pts = AV_NOPTS_VALUE;
+                    return true;
+                }
+            }
             return false;
         }
         
-        // Read packet payload
-        size_t totalRead = 0;
-        while (totalRead < packetSize) {
-            n = read(sockfd, packet->data + totalRead, packetSize - totalRead);
-            if (n <= 0) {
-                av_packet_unref(packet);
+    private:
+        struct Entry {
+            int64_t pts = AV_NOPTS_VALUE;
+            std::chrono::steady_clock::time_point received;
+            std::chrono::steady_clock::time_point submitted;
+        };
+        std::array<Entry, 64> entries;
+        size_t next = 0;
+    };
+    
+    // Skips stages whose start or end was not measured
+    static void recordLatency(utils::LatencyHistogram& histogram,
+                              FrameTimestamps::Clock::time_point from,
+                              FrameTimestamps::Clock::time_point to) {
+        if (from.time_since_epoch().count() == 0 || to.time_since_epoch().count() == 0) {
+            return;
+        }
+        histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+    }
+    
+    void recordDecodeTime(int64_t micros) {
+        decodedFrames++;
+        lastDecodeUs = micros;
+        totalDecodeUs += micros;
+        if (micros > maxDecodeUs) {
+            maxDecodeUs = micros;
+        }
+    }
+    
+    // Pop from a free list, counting one stall per wait for downstream room.
+    // The stage returning items to the list notifies wake.
+    template<typename T>
+    bool waitForFree(utils::SpscQueue<T*>& freeList, T*& item, StageCounters& counters, utils::WakeSignal& wake) {
+        utils::Backoff backoff(wake);
+        bool stalled = false;
+        while (!freeList.tryPop(item)) {
+            if (!active) {
                 return false;
             }
-            totalRead += n;
+            if (!stalled) {
+                counters.stalls++;
+                stalled = true;
+            }
+            backoff.wait([&]() { return !freeList.empty() || !active; });
+        }
+        return true;
+    }
+    
+    static int alignStride(int bytes) {
+        return (bytes + 31) & ~31;
+    }
+    
+    // Get a pooled frame with the plane layout of the given format
+    FrameRef allocateFrame(PixelFormat format, int width, int height) {
+        const int chromaWidth = (width + 1) / 2;
+        const int chromaHeight = (height + 1) / 2;
+        int strides[3] = {0, 0, 0};
+        size_t planeSizes[3] = {0, 0, 0};
+        
+        switch (format) {
+            case PixelFormat::RGBA:
+                strides[0] = alignStride(width * 4);
+                planeSizes[0] = static_cast<size_t>(strides[0]) * height;
+                break;
+            case PixelFormat::YUV420P:
+                strides[0] = alignStride(width);
+                strides[1] = strides[2] = alignStride(chromaWidth);
+                planeSizes[0] = static_cast<size_t>(strides[0]) * height;
+                planeSizes[1] = planeSizes[2] = static_cast<size_t>(strides[1]) * chromaHeight;
+                break;
+            case PixelFormat::NV12:
+                strides[0] = alignStride(width);
+                strides[1] = alignStride(chromaWidth * 2);
+                planeSizes[0] = static_cast<size_t>(strides[0]) * height;
+                planeSizes[1] = static_cast<size_t>(strides[1]) * chromaHeight;
+                break;
+        }
+        
+        FrameRef frameRef = framePool.acquire(planeSizes[0] + planeSizes[1] + planeSizes[2]);
+        FrameData& frameData = *frameRef;
+        frameData.width = width;
+        frameData.height = height;
+        frameData.format = format;
+        
+        uint8_t* plane = frameData.data.data();
+        for (int i = 0; i < 3; ++i) {
+            frameData.planes[i] = planeSizes[i] ? plane : nullptr;
+            frameData.strides[i] = strides[i];
+            plane += planeSizes[i];
+        }
+        return frameRef;
+    }
+    
+    // Copy or convert a decoded frame into the configured output format, at
+    // the decoded size; scaling to the window is left to the renderer.
+    // YUV420P and NV12 are copied plane by plane and RGBA output uses
+    // ColorConverter; only unusual decoder formats go through swscale.
+    FrameRef produceFrame(const AVFrame* frame) {
+        const auto sourceFormat = static_cast<AVPixelFormat>(frame->format);
+        const bool planar420 = sourceFormat == AV_PIX_FMT_YUV420P || sourceFormat == AV_PIX_FMT_YUVJ420P;
+        // The deprecated J formats mean full range by themselves
+        const bool jpegFormat = sourceFormat == AV_PIX_FMT_YUVJ420P ||
+            sourceFormat == AV_PIX_FMT_YUVJ422P || sourceFormat == AV_PIX_FMT_YUVJ444P;
+        const bool bt709 = frame->colorspace == AVCOL_SPC_BT709;
+        const bool fullRange = frame->color_range == AVCOL_RANGE_JPEG || jpegFormat;
+        
+        const OutputSettings output = getOutputSettings();
+        if (output.format != PixelFormat::RGBA &&
+            (planar420 || sourceFormat == AV_PIX_FMT_NV12)) {
+            const PixelFormat format = planar420 ? PixelFormat::YUV420P : PixelFormat::NV12;
+            FrameRef frameRef = allocateFrame(format, frame->width, frame->height);
+            FrameData& frameData = *frameRef;
+            frameData.timestamp = frame->pts;
+            // Planes are copied as they are; the renderer converts them
+            // with the source's matrix and range
+            frameData.bt709 = bt709;
+            frameData.fullRange = fullRange;
+            
+            const int chromaHeight = (frame->height + 1) / 2;
+            av_image_copy_plane(frameData.planes[0], frameData.strides[0],
+                               frame->data[0], frame->linesize[0], frame->width, frame->height);
+            if (format == PixelFormat::YUV420P) {
+                const int chromaWidth = (frame->width + 1) / 2;
+                av_image_copy_plane(frameData.planes[1], frameData.strides[1],
+                                   frame->data[1], frame->linesize[1], chromaWidth, chromaHeight);
+                av_image_copy_plane(frameData.planes[2], frameData.strides[2],
+                                   frame->data[2], frame->linesize[2], chromaWidth, chromaHeight);
+            } else {
+                av_image_copy_plane(frameData.planes[1], frameData.strides[1],
+                                   frame->data[1], frame->linesize[1],
+                                   ((frame->width + 1) / 2) * 2, chromaHeight);
+            }
+            return frameRef;
         }
         
-        // Set packet timestamp from header
-        packet->pts = (header[4] << 56) | (header[5] << 48) | 
-                     (header[6] << 40) | (header[7] << 32) |
-                     (header[8] << 24) | (header[9] << 16) |
-                     (header[10] << 8) | header[11];
+        const bool toRgba = output.format == PixelFormat::RGBA;
+        const int destWidth = frame->width;
+        const int destHeight = frame->height;
         
-        return true;
+        // YUV420P to RGBA skips swscale and uses the SIMD converter
+        if (toRgba && planar420) {
+            if (!colorConverter) {
+                colorConverter = std::make_unique<ColorConverter>();
+                utils::Logger::getInstance().info("Color conversion kernel: ",
+                    ColorConverter::kernelName(colorConverter->getKernel()));
+            }
+            
+            ColorConversion conversion;
+            conversion.matrix = bt709 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+            conversion.range = fullRange ? ColorRange::Full : ColorRange::Limited;
+            
+            FrameRef frameRef = allocateFrame(PixelFormat::RGBA, destWidth, destHeight);
+            FrameData& frameData = *frameRef;
+            frameData.timestamp = frame->pts;
+            frameData.bt709 = bt709;
+            frameData.fullRange = fullRange;
+            
+            const uint8_t* const sourcePlanes[3] = { frame->data[0], frame->data[1], frame->data[2] };
+            const int sourceStrides[3] = { frame->linesize[0], frame->linesize[1], frame->linesize[2] };
+            colorConverter->convert(sourcePlanes, sourceStrides, frame->width, frame->height,
+                                    frameData.planes[0], frameData.strides[0], conversion);
+            return frameRef;
+        }
+        
+        swsContext = sws_getCachedContext(swsContext,
+            frame->width, frame->height, sourceFormat,
+            destWidth, destHeight, toRgba ? AV_PIX_FMT_RGBA : AV_PIX_FMT_YUV420P,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!swsContext) {
+            utils::Logger::getInstance().error("Could not initialize conversion context");
+            return FrameRef();
+        }
+        
+        FrameRef frameRef = allocateFrame(toRgba ? PixelFormat::RGBA : PixelFormat::YUV420P,
+                                          destWidth, destHeight);
+        FrameData& frameData = *frameRef;
+        frameData.timestamp = frame->pts;
+        // swscale expands the J formats to limited range and passes any
+        // other range through unchanged
+        frameData.bt709 = bt709;
+        frameData.fullRange = fullRange && !jpegFormat;
+        
+        uint8_t* destSlice[4] = { frameData.planes[0], frameData.planes[1], frameData.planes[2], nullptr };
+        int destStride[4] = { frameData.strides[0], frameData.strides[1], frameData.strides[2], 0 };
+        
+        sws_scale(swsContext, frame->data, frame->linesize, 0,
+                 frame->height, destSlice, destStride);
+        return frameRef;
     }
     
     void cleanup() {
@@ -417,35 +1799,138 @@ private:
     }
     
     std::atomic<bool> active;
-    std::atomic<bool> recording;
-    std::thread captureThread;
+    std::atomic<bool> streamEnded{false};  // Set by the reader when the stream failed or closed
+    std::thread readerThread;
+    std::thread decoderThread;
+    std::thread converterThread;
+    std::mutex socketMutex;
+    int videoSocket = -1;  // Owned and closed by the reader; guarded by socketMutex
     std::mutex callbackMutex;
     FrameCallback frameCallback;
     ScreenConfig currentConfig;
-    std::unique_ptr<InputHandler> inputHandler;
+    OutputSettings output;
+    mutable std::mutex configMutex;
+    ControlChannel controlChannel;
+    AdbStream serverShell;  // scrcpy server process on the device
+    FramePool framePool;
+    
+    // Pipeline queues; each free list returns buffers to the upstream stage
+    std::unique_ptr<utils::SpscQueue<QueuedPacket>> packetQueue;
+    std::unique_ptr<utils::SpscQueue<AVPacket*>> freePackets;
+    std::unique_ptr<utils::SpscQueue<QueuedFrame>> frameQueue;
+    std::unique_ptr<utils::SpscQueue<AVFrame*>> freeFrames;
+    // A stage with nothing to do parks on its signal; whoever pushes to the
+    // queue or free list it waits on notifies it
+    utils::WakeSignal readerWake;
+    utils::WakeSignal decoderWake;
+    utils::WakeSignal converterWake;
+    StageCounters readerCounters;
+    StageCounters decoderCounters;
+    StageCounters converterCounters;
+    
+    // Decode timing, written by the decoder thread
+    std::atomic<uint64_t> decodedFrames{0};
+    std::atomic<int64_t> lastDecodeUs{0};
+    std::atomic<int64_t> totalDecodeUs{0};
+    std::atomic<int64_t> maxDecodeUs{0};
+    int decodeThreads{0};
+    
+    // Load shedding; the backlog is written by the reader, the rest by the
+    // decoder
+    std::atomic<size_t> socketBacklog{0};
+    std::atomic<int> streamBitrate{0};
+    std::atomic<bool> loadShedding{true};
+    std::atomic<uint64_t> droppedPackets{0};
+    std::atomic<uint64_t> nonReferencePackets{0};
+    std::atomic<uint64_t> nonReferenceEpisodes{0};
+    std::atomic<uint64_t> keyframeEpisodes{0};
+    std::atomic<SkipLevel> sheddingLevel{SkipLevel::None};
+    std::atomic<int64_t> packetLagMs{0};
+    
+    // Adaptive bitrate; the controller itself lives on the adaptation
+    // thread. streamBitrate and streamFps hold what the encoder was last
+    // asked for.
+    std::thread adaptationThread;
+    std::mutex adaptationMutex;
+    std::condition_variable adaptationWake;
+    std::atomic<bool> adaptiveBitrate{false};
+    std::atomic<bool> adaptationReset{true};
+    std::atomic<int> streamFps{0};
+    std::atomic<int64_t> receivedBps{0};
+    std::atomic<uint64_t> bitrateDecreases{0};
+    std::atomic<uint64_t> bitrateIncreases{0};
+    
+    // Restarts that apply the controller's target on a stock server. They
+    // run on restartThread, and only for the session that asked.
+    std::mutex sessionMutex;
+    std::thread restartThread;
+    std::mutex restartMutex;
+    std::condition_variable restartWake;
+    bool restartRequested = false;
+    bool restartStopping = false;
+    BitrateDecision restartTarget;
+    uint64_t restartSession = 0;
+    std::atomic<uint64_t> sessionId{0};
+    std::chrono::steady_clock::time_point sessionStartedAt;
+    std::atomic<uint64_t> adaptiveRestarts{0};
+    std::atomic<uint64_t> receivedBytes{0};
+    std::atomic<FrameTimestamps::Clock::time_point> lastPacketAt{};
+    
+    // Per-stage latency; the upload and present stages are reported by the
+    // renderer through recordPresentedFrame
+    utils::LatencyHistogram decodeLatency;
+    utils::LatencyHistogram convertLatency;
+    utils::LatencyHistogram uploadLatency;
+    utils::LatencyHistogram presentLatency;
+    utils::LatencyHistogram totalLatency;
+    std::mutex showTapsMutex;
+    bool showTapsChanged = false;  // Guarded by showTapsMutex
+    std::string showTapsBefore = "0";
+    LatencyProbe latencyProbe;
     
     // FFmpeg components
+    // Switched by the reader thread if the server picks another codec
+    std::atomic<const VideoCodec*> videoCodec{&kVideoCodecs[0]};
     const AVCodec* codec{nullptr};
     AVCodecContext* codecContext{nullptr};
     SwsContext* swsContext{nullptr};
+    std::unique_ptr<ColorConverter> colorConverter;
 
-    // Recording components
-    AVFormatContext* formatContext{nullptr};
-    AVStream* stream{nullptr};
-    std::chrono::steady_clock::time_point recordingStartTime;
+    // Size of the last decoded frame, written by the converter thread
+    std::atomic<int> decodedWidth{0};
+    std::atomic<int> decodedHeight{0};
+
+    // Recording; the reader thread feeds it every packet
+    Recorder recorder;
+    ReplayBuffer replayBuffer;
+    
+    // Screenshots: the newest frame, the running burst and the encoders
+    std::mutex captureMutex;
+    FrameRef latestFrame;
+    std::unique_ptr<Burst> burst;
+    std::unique_ptr<utils::ThreadPool> capturePool;
+    bool trimAfterBurst = false;
+    mutable std::mutex streamConfigMutex;
+    std::vector<uint8_t> streamConfig;
 };
 
 // Public interface implementation
 ScreenMirror::ScreenMirror() : pimpl(std::make_unique<Impl>()) {
     inputHandler = std::make_unique<InputHandler>();
+    inputHandler->setControlChannel(&pimpl->getControlChannel());
+}
+ScreenMirror::~ScreenMirror() {
+    // The probe injects through inputHandler, which goes first
+    pimpl->stopLatencyProbe();
 }
-ScreenMirror::~ScreenMirror() = default;
 
 bool ScreenMirror::start(const ScreenConfig& config) {
+    std::lock_guard<std::mutex> lock(pimpl->getSessionMutex());
     return pimpl->start(config);
 }
 
 void ScreenMirror::stop() {
+    std::lock_guard<std::mutex> lock(pimpl->getSessionMutex());
     pimpl->stop();
 }
 
@@ -454,26 +1939,78 @@ void ScreenMirror::setFrameCallback(FrameCallback callback) {
 }
 
 ScreenConfig ScreenMirror::getConfig() const {
-    return pimpl->currentConfig;
+    return pimpl->getConfig();
 }
 
 bool ScreenMirror::updateConfig(const ScreenConfig& config) {
-    stop();
-    return start(config);
+    std::lock_guard<std::mutex> lock(pimpl->getSessionMutex());
+    return pimpl->updateConfig(config);
 }
 
 bool ScreenMirror::isActive() const {
-    return pimpl->active;
+    return pimpl->isActive();
 }
 
-bool ScreenMirror::startRecording(const std::string& path) {
-    return pimpl->startRecording(path);
+bool ScreenMirror::startRecording(const std::string& path, const RecordingOptions& options) {
+    return pimpl->startRecording(path, options);
 }
 
 void ScreenMirror::stopRecording() {
     pimpl->stopRecording();
 }
 
+RecorderStats ScreenMirror::getRecorderStats() const {
+    return pimpl->getRecorderStats();
+}
+
+bool ScreenMirror::saveReplay(const std::string& path, int seconds) {
+    return pimpl->saveReplay(path, seconds);
+}
+
+ReplayBufferStats ScreenMirror::getReplayStats() const {
+    return pimpl->getReplayStats();
+}
+
+std::future<Screenshot> ScreenMirror::captureScreenshot(ImageFormat format) {
+    return pimpl->captureScreenshot(format);
+}
+
+std::future<std::vector<Screenshot>> ScreenMirror::captureBurst(int count, int fps, ImageFormat format) {
+    return pimpl->captureBurst(count, fps, format);
+}
+
+FramePoolStats ScreenMirror::getFramePoolStats() const {
+    return pimpl->getFramePoolStats();
+}
+
+PipelineStats ScreenMirror::getPipelineStats() const {
+    return pimpl->getPipelineStats();
+}
+
+void ScreenMirror::recordPresentedFrame(const FrameTimestamps& timestamps) {
+    pimpl->recordPresentedFrame(timestamps);
+}
+
+LatencyStats ScreenMirror::getLatencyStats() const {
+    return pimpl->getLatencyStats();
+}
+
+bool ScreenMirror::dumpLatencyStats(const std::string& path) const {
+    return pimpl->dumpLatencyStats(path);
+}
+
+bool ScreenMirror::startLatencyProbe(const LatencyProbeConfig& config) {
+    return pimpl->startLatencyProbe(config, *inputHandler);
+}
+
+void ScreenMirror::stopLatencyProbe() {
+    pimpl->stopLatencyProbe();
+}
+
+LatencyProbeStats ScreenMirror::getLatencyProbeStats() const {
+    return pimpl->getLatencyProbeStats();
+}
+
 InputHandler& ScreenMirror::getInputHandler() {
     return *inputHandler;
 }
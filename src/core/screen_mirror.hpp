@@ -1,33 +1,126 @@
 #pragma once
 
+#include <future>
 #include <memory>
+#include <string>
 #include <vector>
 #include <functional>
 #include <cstdint>
 #include "input_handler.hpp"
+#include "frame_pool.hpp"
+#include "image_encoder.hpp"
+#include "latency_probe.hpp"
+#include "load_shedder.hpp"
+#include "recorder.hpp"
+#include "replay_buffer.hpp"
+#include "../utils/latency_histogram.hpp"
 
 namespace mirrolink {
 
 struct ScreenConfig {
+    // Bounding box for the stream. The device scales its screen so the
+    // long side fits max(width, height), keeping its aspect ratio; frames
+    // arrive at that size and are scaled to the window by the renderer.
+    // 0x0 streams at the device's native resolution.
     int width;
     int height;
     int maxFps;
     bool recordAudio = false;
+    // "h264", "h265" (or "hevc") or "av1". Falls back to h264 when FFmpeg
+    // has no decoder for it.
     std::string videoCodec = "h264";
     int videoBitrate = 8000000; // 8 Mbps
+    // Frames are delivered as decoded YUV by default; RGBA costs a
+    // conversion pass and is only for consumers that need packed pixels
+    PixelFormat outputFormat = PixelFormat::YUV420P;
+    // Packets and frames buffered between the reader, decoder and
+    // converter stages
+    int pipelineDepth = 4;
+    // Decoder tuning: "lowlatency" uses slice threads and outputs every
+    // frame as soon as it is decoded; "throughput" uses frame threads, which
+    // adds a few frames of delay but scales to 4K and 120fps streams
+    std::string decodeProfile = "lowlatency";
+    int decodeThreads = 0;  // 0 = one per CPU core
+    // Skip frames when decoding falls behind the stream, instead of
+    // showing an ever staler picture. Dropping ahead to a keyframe needs
+    // a server that takes keyframe requests; others only skip
+    // non-reference frames.
+    bool loadShedding = true;
+    // Let the encoder's bitrate and frame rate follow what the link and
+    // decoder keep up with. videoBitrate and maxFps become the upper
+    // bounds; the floor is minBitrate and minFps. A server with the video
+    // settings extension is retuned in place; a stock one is restarted
+    // with the new settings, at most every 30 seconds and never while
+    // recording or probing latency.
+    bool adaptiveBitrate = false;
+    int minBitrate = 1000000;
+    int minFps = 15;
+    // Instant replay: keep the last replaySeconds of the encoded stream in
+    // a fixed-size memory ring for saveReplay(). 0 disables it.
+    int replaySeconds = 0;
+    size_t replayBufferBytes = 64 * 1024 * 1024;
 };
 
-struct FrameData {
-    std::vector<uint8_t> data;
-    int width;
-    int height;
-    int64_t timestamp;
-    int format;  // e.g., RGBA, YUV420P
+struct PipelineStageStats {
+    uint64_t processed = 0;  // Items handed on to the next stage
+    uint64_t stalls = 0;     // Times the stage waited for room downstream
+    uint64_t idleWaits = 0;  // Times the stage waited for input
+    size_t occupancy = 0;    // Items waiting in the stage's input queue
+    size_t queueDepth = 0;   // Capacity of the stage's input queue
+};
+
+struct DecodeStats {
+    uint64_t frames = 0;      // Frames measured
+    int64_t lastUs = 0;       // Packet-in to frame-out time of the latest frame
+    int64_t averageUs = 0;    // Mean over all measured frames
+    int64_t maxUs = 0;        // Worst frame so far
+    int threads = 0;          // Decoder threads in use
+    std::string codec;        // Codec the stream is decoded as
+};
+
+struct LoadSheddingStats {
+    uint64_t nonReferenceEpisodes = 0;  // Times non-reference skipping kicked in
+    uint64_t keyframeEpisodes = 0;      // Times the decoder dropped ahead to a keyframe
+    uint64_t droppedPackets = 0;        // Packets thrown away undecoded
+    uint64_t nonReferencePackets = 0;   // Packets decoded with non-reference frames skipped
+    SkipLevel level = SkipLevel::None;
+    int64_t lagMs = 0;                  // How far behind the latest packet was
+};
+
+struct AdaptiveBitrateStats {
+    bool enabled = false;         // Requested for this session
+    bool inPlace = false;         // The server takes new settings without a restart
+    int bitrate = 0;              // Bitrate the encoder was last asked for
+    int maxFps = 0;               // Frame rate cap the encoder was last asked for
+    int64_t receivedBps = 0;      // Stream throughput over the last interval
+    uint64_t decreases = 0;       // Times the controller backed off
+    uint64_t increases = 0;       // Times it probed upwards
+    uint64_t restarts = 0;        // Sessions restarted to apply a target, ever
+};
+
+struct PipelineStats {
+    PipelineStageStats reader;     // Socket -> packet queue (no input queue)
+    PipelineStageStats decoder;    // Packet queue -> frame queue
+    PipelineStageStats converter;  // Frame queue -> frame callback
+    DecodeStats decode;
+    LoadSheddingStats shedding;
+    AdaptiveBitrateStats adaptation;
+};
+
+// Per-stage latency distributions, from FrameTimestamps
+struct LatencyStats {
+    utils::LatencySummary decode;   // Socket receive -> decoded, including the packet queue
+    utils::LatencySummary convert;  // Decoded -> converted, including the frame queue
+    utils::LatencySummary upload;   // Converted -> texture upload, including the render wait
+    utils::LatencySummary present;  // Texture upload -> present
+    utils::LatencySummary total;    // Socket receive -> present
 };
 
 class ScreenMirror {
 public:
-    using FrameCallback = std::function<void(const FrameData&)>;
+    // Frames are pooled; keep a copy of the FrameRef to hold on to a frame
+    // past the callback
+    using FrameCallback = std::function<void(const FrameRef&)>;
     
     ScreenMirror();
     ~ScreenMirror();
@@ -44,15 +137,58 @@ public:
     // Get current configuration
     ScreenConfig getConfig() const;
     
-    // Update configuration while running
+    // Update configuration while running. Video changes are applied in
+    // place only on a server with the video settings extension; otherwise
+    // they restart the session.
     bool updateConfig(const ScreenConfig& config);
     
     // Check if mirroring is active
     bool isActive() const;
     
-    // Recording functions
-    bool startRecording(const std::string& path);
+    // Recording functions. The received stream is remuxed into the file
+    // (container chosen by extension) on a writer thread, without
+    // re-encoding. Options control segmenting and disk retention.
+    bool startRecording(const std::string& path, const RecordingOptions& options = RecordingOptions());
     void stopRecording();
+    RecorderStats getRecorderStats() const;
+    
+    // Write the last `seconds` (0 = the configured replay length) of the
+    // stream from the replay buffer, starting at a keyframe
+    bool saveReplay(const std::string& path, int seconds = 0);
+    ReplayBufferStats getReplayStats() const;
+    
+    // Encode the frame currently on screen. Encoding runs on a worker pool;
+    // the future throws utils::Error if there is no frame yet.
+    std::future<Screenshot> captureScreenshot(ImageFormat format = ImageFormat::PNG);
+    
+    // Capture `count` frames at up to `fps` from the live stream. Frames
+    // are referenced as they arrive and encoded in the background.
+    std::future<std::vector<Screenshot>> captureBurst(int count, int fps,
+                                                      ImageFormat format = ImageFormat::QOI);
+    
+    // Frame buffer pool counters
+    FramePoolStats getFramePoolStats() const;
+    
+    // Per-stage queue occupancy and stall counters
+    PipelineStats getPipelineStats() const;
+    
+    // Report the upload and present times of a frame once it is on
+    // screen; this closes its latency trace
+    void recordPresentedFrame(const FrameTimestamps& timestamps);
+    
+    // p50/p99/p99.9 per stage since start()
+    LatencyStats getLatencyStats() const;
+    
+    // Write the summaries and full percentile distributions to a file
+    bool dumpLatencyStats(const std::string& path) const;
+    
+    // Input-to-photon measurement: inject synthetic taps or keys and time
+    // the first frame that changes in the probe region, then its
+    // presentation. Taps turn on Android's "show taps" for the run so any
+    // region around the tap answers. Needs a running session.
+    bool startLatencyProbe(const LatencyProbeConfig& config);
+    void stopLatencyProbe();
+    LatencyProbeStats getLatencyProbeStats() const;
     
     // Get the input handler for this session
     InputHandler& getInputHandler() { return *inputHandler; }
@@ -0,0 +1,146 @@
+#include "server_tunnel.hpp"
+#include "../utils/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace mirrolink {
+
+namespace {
+
+// The server writes the dummy byte as soon as it accepts; a connection
+// that stays silent this long is as good as dropped
+constexpr int kDummyByteTimeoutMs = 2000;
+
+} // namespace
+
+ServerTunnel::ServerTunnel(const ServerTunnelConfig& config) : config(config) {}
+
+ServerTunnel::~ServerTunnel() {
+    close();
+}
+
+bool ServerTunnel::open(const std::atomic<bool>& keepTrying) {
+    close();
+    attempts = 0;
+
+    while (keepTrying && attempts < config.attempts) {
+        if (attempts > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.retryDelayMs));
+            if (!keepTrying) {
+                break;
+            }
+        }
+        attempts++;
+
+        const int sockfd = connectSocket();
+        if (sockfd < 0) {
+            continue;
+        }
+        if (awaitServer(sockfd, keepTrying)) {
+            videoSocket = sockfd;
+            break;
+        }
+        ::close(sockfd);
+    }
+    if (videoSocket < 0) {
+        if (keepTrying) {
+            utils::Logger::getInstance().error("scrcpy server did not answer after ", attempts, " attempts");
+        }
+        return false;
+    }
+
+    // The server is listening now, so the control socket connects first time
+    controlSocket = connectSocket();
+    if (controlSocket < 0) {
+        utils::Logger::getInstance().error("Failed to connect control socket: ", std::strerror(errno));
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ServerTunnel::close() {
+    for (int* sockfd : {&videoSocket, &controlSocket}) {
+        if (*sockfd >= 0) {
+            ::close(*sockfd);
+            *sockfd = -1;
+        }
+    }
+}
+
+int ServerTunnel::takeVideoSocket() {
+    const int sockfd = videoSocket;
+    videoSocket = -1;
+    return sockfd;
+}
+
+int ServerTunnel::takeControlSocket() {
+    const int sockfd = controlSocket;
+    controlSocket = -1;
+    return sockfd;
+}
+
+int ServerTunnel::connectSocket() const {
+    const int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        utils::Logger::getInstance().error("Failed to create socket: ", std::strerror(errno));
+        return -1;
+    }
+
+    if (videoSocket < 0) {
+        // The receive buffer has to be sized before connect to take effect
+        PacketReader::configureSocket(sockfd, config.video);
+    } else {
+        // Control messages are tiny and latency sensitive
+        int noDelay = 1;
+        setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    struct sockaddr_in serverAddr {};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(config.port);
+    serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(sockfd, reinterpret_cast<struct sockaddr*>(&serverAddr), sizeof(serverAddr)) < 0) {
+        const int error = errno;
+        ::close(sockfd);
+        errno = error;
+        return -1;
+    }
+    return sockfd;
+}
+
+bool ServerTunnel::awaitServer(int sockfd, const std::atomic<bool>& keepTrying) const {
+    // Poll in short slices so a stop does not wait out the timeout
+    const int slice = std::max(config.retryDelayMs, 1);
+    for (int waited = 0; waited < kDummyByteTimeoutMs && keepTrying; waited += slice) {
+        struct pollfd pollFd{sockfd, POLLIN, 0};
+        const int ready = poll(&pollFd, 1, slice);
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        uint8_t dummy = 0;
+        const ssize_t n = recv(sockfd, &dummy, 1, 0);
+        if (n == 1) {
+            return true;
+        }
+        if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+            // adb dropped it: the server is not listening yet
+            return false;
+        }
+    }
+    return false;
+}
+
+} // namespace mirrolink
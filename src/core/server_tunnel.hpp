@@ -0,0 +1,55 @@
+#pragma once
+
+#include "packet_reader.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace mirrolink {
+
+struct ServerTunnelConfig {
+    uint16_t port = 27183;  // Local end of `adb forward`
+    // adb accepts the connection even before the server listens and then
+    // drops it, so a connection only counts once the server's dummy byte
+    // arrives; until then it is retried
+    int attempts = 100;
+    int retryDelayMs = 100;
+    PacketReaderConfig video;  // Options of the video socket
+};
+
+// Opens the sockets of a scrcpy session started with tunnel_forward=true
+// and send_dummy_byte=true, in the order the server accepts them: video,
+// then control. The server only starts streaming once it has all of them,
+// so nothing may be read from the video socket before open() returns.
+class ServerTunnel {
+public:
+    explicit ServerTunnel(const ServerTunnelConfig& config = ServerTunnelConfig());
+    // Closes the sockets that were not taken
+    ~ServerTunnel();
+
+    ServerTunnel(const ServerTunnel&) = delete;
+    ServerTunnel& operator=(const ServerTunnel&) = delete;
+
+    // Connect both sockets. Gives up after config.attempts tries, or as
+    // soon as keepTrying turns false.
+    bool open(const std::atomic<bool>& keepTrying);
+    void close();
+
+    // Hand a socket over to the caller, who closes it; -1 if not open
+    int takeVideoSocket();
+    int takeControlSocket();
+
+    // Connections tried for the video socket by the last open()
+    int getAttempts() const { return attempts; }
+
+private:
+    int connectSocket() const;
+    // Wait for the dummy byte; false if the connection was dropped
+    bool awaitServer(int sockfd, const std::atomic<bool>& keepTrying) const;
+
+    ServerTunnelConfig config;
+    int videoSocket = -1;
+    int controlSocket = -1;
+    int attempts = 0;
+};
+
+} // namespace mirrolink
@@ -7,7 +7,7 @@ namespace gui {
 
 DeviceView::DeviceView(SDL_Renderer* renderer)
     : renderer(renderer)
-    , frameTexture(nullptr)
+    , frameTexture(renderer)
     , viewWidth(0)
     , viewHeight(0)
     , contentWidth(0)
@@ -18,11 +18,7 @@ DeviceView::DeviceView(SDL_Renderer* renderer)
     viewport = {0, 0, 0, 0};
 }
 
-DeviceView::~DeviceView() {
-    if (frameTexture) {
-        SDL_DestroyTexture(frameTexture);
-    }
-}
+DeviceView::~DeviceView() = default;
 
 bool DeviceView::initialize(int width, int height) {
     viewWidth = width;
@@ -32,15 +28,15 @@ bool DeviceView::initialize(int width, int height) {
 }
 
 void DeviceView::render() {
-    if (!frameTexture) return;
+    if (!frameTexture.get()) return;
     
     SDL_RenderSetViewport(renderer, &viewport);
-    SDL_SetTextureScaleMode(frameTexture, scaleMode);
-    SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr);
+    SDL_SetTextureScaleMode(frameTexture.get(), scaleMode);
+    SDL_RenderCopy(renderer, frameTexture.get(), nullptr, nullptr);
 }
 
 void DeviceView::handleMouseEvent(const SDL_MouseButtonEvent& event) {
-    if (!frameTexture) return;
+    if (!frameTexture.get()) return;
     
     float x = static_cast<float>(event.x - viewport.x);
     float y = static_cast<float>(event.y - viewport.y);
@@ -58,7 +54,7 @@ void DeviceView::handleMouseEvent(const SDL_MouseButtonEvent& event) {
 }
 
 void DeviceView::handleMouseMotion(const SDL_MouseMotionEvent& event) {
-    if (!frameTexture || !(event.state & SDL_BUTTON_LMASK)) return;
+    if (!frameTexture.get() || !(event.state & SDL_BUTTON_LMASK)) return;
     
     float x = static_cast<float>(event.x - viewport.x);
     float y = static_cast<float>(event.y - viewport.y);
@@ -76,7 +72,7 @@ void DeviceView::handleMouseMotion(const SDL_MouseMotionEvent& event) {
 }
 
 void DeviceView::handleKeyEvent(const SDL_KeyboardEvent& event) {
-    if (!frameTexture) return;
+    if (!frameTexture.get()) return;
     
     KeyboardEvent keyEvent{
         .keycode = event.keysym.scancode,
@@ -90,33 +86,15 @@ void DeviceView::handleKeyEvent(const SDL_KeyboardEvent& event) {
 }
 
 void DeviceView::updateFrame(const FrameData& frame) {
-    if (!frameTexture || 
-        frame.width != contentWidth || 
-        frame.height != contentHeight) {
-        
-        if (frameTexture) {
-            SDL_DestroyTexture(frameTexture);
-        }
-        
-        frameTexture = SDL_CreateTexture(
-            renderer,
-            SDL_PIXELFORMAT_RGBA8888,
-            SDL_TEXTUREACCESS_STREAMING,
-            frame.width,
-            frame.height
-        );
-        
-        if (!frameTexture) {
-            utils::Logger::getInstance().error("Failed to create texture: ", SDL_GetError());
-            return;
-        }
-        
+    if (!frameTexture.update(frame)) {
+        return;
+    }
+    
+    if (frame.width != contentWidth || frame.height != contentHeight) {
         contentWidth = frame.width;
         contentHeight = frame.height;
         updateViewport();
     }
-    
-    SDL_UpdateTexture(frameTexture, nullptr, frame.data.data(), frame.width * 4);
 }
 
 void DeviceView::resize(int width, int height) {
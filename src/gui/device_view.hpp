@@ -3,6 +3,7 @@
 #include <SDL2/SDL.h>
 #include "../core/screen_mirror.hpp"
 #include "../core/device_manager.hpp"
+#include "frame_texture.hpp"
 #include <memory>
 
 namespace mirrolink {
@@ -41,7 +42,7 @@ private:
     void scaleCoordinates(float& x, float& y);
 
     SDL_Renderer* renderer;
-    SDL_Texture* frameTexture;
+    FrameTexture frameTexture;
     SDL_Rect viewport;
     
     int viewWidth;
@@ -0,0 +1,190 @@
+#include "frame_texture.hpp"
+#include "../utils/logger.hpp"
+#include <cstring>
+
+namespace mirrolink {
+namespace gui {
+
+FrameTexture::FrameTexture(SDL_Renderer* renderer)
+    : renderer(renderer)
+    , texture(nullptr)
+    , width(0)
+    , height(0)
+    , format(PixelFormat::RGBA)
+    , conversion(SDL_YUV_CONVERSION_BT601)
+    , scaleMode(SDL_ScaleModeLinear)
+    , damageTracking(true)
+{}
+
+FrameTexture::~FrameTexture() {
+    reset();
+}
+
+bool FrameTexture::update(const FrameData& frame) {
+    const bool yuv = frame.format != PixelFormat::RGBA;
+    if (!texture || frame.width != width || frame.height != height || frame.format != format ||
+        (yuv && toConversionMode(frame) != conversion)) {
+        if (!recreate(frame)) {
+            return false;
+        }
+        damage.reset();
+    }
+
+    if (!damageTracking) {
+        return upload(frame, nullptr);
+    }
+
+    // Identical frames leave the texture as it is
+    if (!damage.update(frame, dirtyRects)) {
+        return true;
+    }
+#if !SDL_VERSION_ATLEAST(2, 0, 16)
+    if (frame.format == PixelFormat::NV12) {
+        // No region uploads for NV12 here; only identical frames are saved
+        return upload(frame, nullptr);
+    }
+#endif
+    for (const DamageRect& dirty : dirtyRects) {
+        const SDL_Rect rect{dirty.x, dirty.y, dirty.width, dirty.height};
+        if (!upload(frame, &rect)) {
+            // The texture no longer matches the hashes
+            damage.reset();
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameTexture::setDamageTracking(bool enabled) {
+    damageTracking = enabled;
+    damage.reset();
+}
+
+bool FrameTexture::upload(const FrameData& frame, const SDL_Rect* rect) {
+    // Regions start on even pixels, so chroma offsets are exact
+    const int x = rect ? rect->x : 0;
+    const int y = rect ? rect->y : 0;
+    const uint8_t* luma = frame.planes[0] + static_cast<size_t>(y) * frame.strides[0];
+
+    int result = 0;
+    switch (frame.format) {
+        case PixelFormat::RGBA:
+            result = SDL_UpdateTexture(texture, rect, luma + x * 4, frame.strides[0]);
+            break;
+
+        case PixelFormat::YUV420P:
+            result = SDL_UpdateYUVTexture(texture, rect,
+                luma + x, frame.strides[0],
+                frame.planes[1] + static_cast<size_t>(y / 2) * frame.strides[1] + x / 2, frame.strides[1],
+                frame.planes[2] + static_cast<size_t>(y / 2) * frame.strides[2] + x / 2, frame.strides[2]);
+            break;
+
+        case PixelFormat::NV12:
+#if SDL_VERSION_ATLEAST(2, 0, 16)
+            result = SDL_UpdateNVTexture(texture, rect,
+                luma + x, frame.strides[0],
+                frame.planes[1] + static_cast<size_t>(y / 2) * frame.strides[1] + x, frame.strides[1]);
+#else
+            {
+                // Older SDL has no NV upload; copy both planes of the whole
+                // frame through a lock, whatever region changed
+                void* pixels = nullptr;
+                int pitch = 0;
+                result = SDL_LockTexture(texture, nullptr, &pixels, &pitch);
+                if (result == 0) {
+                    auto* dst = static_cast<uint8_t*>(pixels);
+                    const int chromaHeight = (frame.height + 1) / 2;
+                    for (int row = 0; row < frame.height; ++row, dst += pitch) {
+                        std::memcpy(dst, frame.planes[0] + row * frame.strides[0], frame.width);
+                    }
+                    for (int row = 0; row < chromaHeight; ++row, dst += pitch) {
+                        std::memcpy(dst, frame.planes[1] + row * frame.strides[1], ((frame.width + 1) / 2) * 2);
+                    }
+                    SDL_UnlockTexture(texture);
+                }
+            }
+#endif
+            break;
+    }
+
+    if (result < 0) {
+        utils::Logger::getInstance().error("Failed to upload frame: ", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+void FrameTexture::reset(SDL_Renderer* newRenderer) {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+    width = 0;
+    height = 0;
+    if (newRenderer) {
+        renderer = newRenderer;
+    }
+}
+
+void FrameTexture::setScaleMode(SDL_ScaleMode mode) {
+    scaleMode = mode;
+    if (texture) {
+        SDL_SetTextureScaleMode(texture, scaleMode);
+    }
+}
+
+bool FrameTexture::recreate(const FrameData& frame) {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+
+    // Global in SDL, but only read here, when a YUV texture is created
+    conversion = toConversionMode(frame);
+    SDL_SetYUVConversionMode(conversion);
+    texture = SDL_CreateTexture(
+        renderer,
+        toSdlFormat(frame.format),
+        SDL_TEXTUREACCESS_STREAMING,
+        frame.width,
+        frame.height
+    );
+
+    if (!texture) {
+        utils::Logger::getInstance().error("Failed to create texture: ", SDL_GetError());
+        width = 0;
+        height = 0;
+        return false;
+    }
+    SDL_SetTextureScaleMode(texture, scaleMode);
+
+    width = frame.width;
+    height = frame.height;
+    format = frame.format;
+    return true;
+}
+
+SDL_YUV_CONVERSION_MODE FrameTexture::toConversionMode(const FrameData& frame) {
+    // SDL's only full-range mode is JPEG, BT.601 coefficients. Full-range
+    // BT.709 is rare from device encoders; getting the range right matters
+    // far more than the slightly different matrix.
+    if (frame.fullRange) {
+        return SDL_YUV_CONVERSION_JPEG;
+    }
+    return frame.bt709 ? SDL_YUV_CONVERSION_BT709 : SDL_YUV_CONVERSION_BT601;
+}
+
+Uint32 FrameTexture::toSdlFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::YUV420P:
+            return SDL_PIXELFORMAT_IYUV;
+        case PixelFormat::NV12:
+            return SDL_PIXELFORMAT_NV12;
+        case PixelFormat::RGBA:
+        default:
+            // Byte order R, G, B, A regardless of host endianness
+            return SDL_PIXELFORMAT_RGBA32;
+    }
+}
+
+}} // namespace mirrolink::gui
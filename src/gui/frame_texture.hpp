@@ -0,0 +1,59 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include "../core/damage_tracker.hpp"
+#include "../core/frame_pool.hpp"
+#include <vector>
+
+namespace mirrolink {
+namespace gui {
+
+// Streaming texture that follows the size and pixel format of incoming
+// frames. YUV frames are uploaded plane by plane, so the GPU does the colour
+// conversion instead of the capture thread, and scaling to the window
+// happens when the texture is drawn. Only the tiles that changed since the
+// last frame are uploaded. The renderer picks the YUV matrix and range of
+// a texture when it is created, so a frame that changes them recreates it.
+class FrameTexture {
+public:
+    explicit FrameTexture(SDL_Renderer* renderer);
+    ~FrameTexture();
+
+    // Upload a frame, recreating the texture if size or format changed
+    bool update(const FrameData& frame);
+
+    // Upload whole frames instead of the changed regions
+    void setDamageTracking(bool enabled);
+    const DamageStats& getDamageStats() const { return damage.getStats(); }
+
+    // Drop the texture, e.g. before the renderer is destroyed. Pass the new
+    // renderer when one is recreated.
+    void reset(SDL_Renderer* newRenderer = nullptr);
+
+    // Filter used when the texture is drawn at another size
+    void setScaleMode(SDL_ScaleMode mode);
+
+    SDL_Texture* get() const { return texture; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    bool recreate(const FrameData& frame);
+    // Upload one region, or the whole frame if rect is null
+    bool upload(const FrameData& frame, const SDL_Rect* rect);
+    static Uint32 toSdlFormat(PixelFormat format);
+    static SDL_YUV_CONVERSION_MODE toConversionMode(const FrameData& frame);
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    int width;
+    int height;
+    PixelFormat format;
+    SDL_YUV_CONVERSION_MODE conversion;
+    SDL_ScaleMode scaleMode;
+    bool damageTracking;
+    DamageTracker damage;
+    std::vector<DamageRect> dirtyRects;
+};
+
+}} // namespace mirrolink::gui
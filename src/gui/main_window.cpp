@@ -1,19 +1,69 @@
 #include "main_window.hpp"
 #include "../utils/logger.hpp"
 #include "../utils/error.hpp"
+#include "../utils/config_manager.hpp"
 #include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cstdio>
 
 namespace mirrolink {
 namespace gui {
 
+namespace {
+
+SDL_ScaleMode parseScaleMode(const std::string& name) {
+    if (name == "nearest") {
+        return SDL_ScaleModeNearest;
+    }
+    if (name == "best") {
+        return SDL_ScaleModeBest;
+    }
+    return SDL_ScaleModeLinear;
+}
+
+// Long side of a "WIDTHxHEIGHT" resolution setting; anything else, such as
+// "native", leaves the stream at the device's own resolution
+int parseMaxSize(const std::string& resolution) {
+    int width = 0;
+    int height = 0;
+    if (std::sscanf(resolution.c_str(), "%dx%d", &width, &height) != 2) {
+        return 0;
+    }
+    return std::max(std::max(width, height), 0);
+}
+
+// Id of the second finger while emulating a pinch; SDL uses -1 for touch
+// mice and small numbers for real ones
+constexpr uint32_t kPinchPointerId = SDL_TOUCH_MOUSEID - 1;
+
+// The mouse finger plus one mirrored through the center of the video.
+// Dragging toward or away from the center pinches, around it rotates.
+void pinchPair(const TouchEvent& primary, TouchEvent (&pair)[2]) {
+    pair[0] = primary;
+    pair[1] = primary;
+    pair[1].id = kPinchPointerId;
+    pair[1].x = 1.0f - primary.x;
+    pair[1].y = 1.0f - primary.y;
+}
+
+} // namespace
+
 MainWindow::MainWindow()
     : window(nullptr)
     , renderer(nullptr)
-    , frameTexture(nullptr)
+    , videoRect{0, 0, 0, 0}
+    , refreshInterval(std::chrono::microseconds(16667))
+    , vsyncEnabled(false)
     , windowWidth(1280)
     , windowHeight(720)
+    , drawableWidth(1280)
+    , drawableHeight(720)
     , isRunning(false)
     , fullscreenMode(false)
+    , dragging(false)
+    , pinching(false)
+    , pendingStreamSize(-1)
+    , renegotiationStopping(false)
 {
     deviceManager = std::make_unique<DeviceManager>();
     screenMirror = std::make_unique<ScreenMirror>();
@@ -76,6 +126,35 @@ bool MainWindow::initialize(const char* title, int width, int height) {
             }
         }
         utils::Logger::getInstance().debug("Renderer created successfully");
+        
+        // Frames are paced to the display's refresh; with vsync the present
+        // call does the waiting
+        SDL_RendererInfo rendererInfo;
+        vsyncEnabled = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 &&
+            (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+        SDL_DisplayMode displayMode;
+        if (SDL_GetWindowDisplayMode(window, &displayMode) == 0 && displayMode.refresh_rate > 0) {
+            refreshInterval = std::chrono::duration_cast<FrameTimestamps::Clock::duration>(
+                std::chrono::duration<double>(1.0 / displayMode.refresh_rate));
+        }
+        
+        // The stream is drawn scaled into the window; its own resolution
+        // is capped by the configured display resolution
+        auto& settings = utils::ConfigManager::getInstance();
+        frameTexture = std::make_unique<FrameTexture>(renderer);
+        frameTexture->setScaleMode(parseScaleMode(
+            settings.get<std::string>("display.scaleMode", "linear")));
+        SDL_GetRendererOutputSize(renderer, &drawableWidth, &drawableHeight);
+        
+        FrameSchedulerConfig scheduling;
+        scheduling.maxDelayFrames = settings.get<int>("display.jitterFrames", 1);
+        frameScheduler.setConfig(scheduling);
+        {
+            std::lock_guard<std::mutex> lock(sizeMutex);
+            sizePolicy = StreamSizePolicy(parseMaxSize(
+                settings.get<std::string>("display.resolution", "1920x1080")));
+            sizePolicy.windowResized(drawableWidth, drawableHeight, SDL_GetTicks());
+        }
 
         // Initialize device manager with error recovery
         int deviceRetryCount = 0;
@@ -118,7 +197,7 @@ bool MainWindow::initialize(const char* title, int width, int height) {
 
         // Initialize screen mirror with error recovery
         screenMirror = std::make_unique<ScreenMirror>();
-        screenMirror->setFrameCallback([this](const FrameData& frame) {
+        screenMirror->setFrameCallback([this](const FrameRef& frame) {
             try {
                 PERFORMANCE_SCOPE("Frame Processing");
                 this->onFrameReceived(frame);
@@ -126,6 +205,7 @@ bool MainWindow::initialize(const char* title, int width, int height) {
                 utils::Logger::getInstance().error("Error processing frame: ", e.what());
             }
         });
+        inputDispatcher = std::make_unique<InputDispatcher>(screenMirror->getInputHandler());
 
         isRunning = true;
         utils::Logger::getInstance().info("Main window initialized successfully");
@@ -145,7 +225,8 @@ void MainWindow::run() {
     Uint32 frameStart;
     int frameCount = 0;
     Uint32 fpsTimer = SDL_GetTicks();
-    const int frameDelay = 1000 / 60;  // Target 60 FPS
+    const int frameDelay = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(refreshInterval).count());
     
     while (isRunning) {
         frameStart = SDL_GetTicks();
@@ -173,6 +254,10 @@ void MainWindow::run() {
                             handleMouseMotion(event.motion);
                             break;
 
+                        case SDL_MOUSEWHEEL:
+                            handleMouseWheel(event.wheel);
+                            break;
+
                         case SDL_WINDOWEVENT:
                             if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
                                 windowWidth = event.window.data1;
@@ -194,31 +279,86 @@ void MainWindow::run() {
                 }
             }
 
+            // Renegotiate the stream size only once the window has settled
+            int streamSize = 0;
+            bool renegotiate = false;
+            {
+                std::lock_guard<std::mutex> lock(sizeMutex);
+                renegotiate = sizePolicy.poll(SDL_GetTicks(), streamSize);
+            }
+            if (renegotiate) {
+                applyStreamSize(streamSize);
+            }
+
             // Render frame with error handling
             if (SDL_RenderClear(renderer) < 0) {
                 throw utils::Error("Failed to clear renderer: " + std::string(SDL_GetError()));
             }
             
-            if (frameTexture) {
-                if (SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr) < 0) {
+            // Upload the newest frame due by the time this one is shown;
+            // with vsync that is the next refresh
+            const auto now = FrameTimestamps::Clock::now();
+            const auto displayTime = vsyncEnabled ? now + refreshInterval : now;
+            FrameRef frame;
+            bool uploaded = false;
+            FrameTimestamps timestamps;
+            if (frameTexture && frameScheduler.next(displayTime, refreshInterval, frame)) {
+                const int previousWidth = frameTexture->getWidth();
+                const int previousHeight = frameTexture->getHeight();
+                frameTexture->update(*frame);
+                if (frameTexture->getWidth() != previousWidth ||
+                    frameTexture->getHeight() != previousHeight) {
+                    updateVideoRect();
+                    std::lock_guard<std::mutex> lock(sizeMutex);
+                    sizePolicy.streamResized(frameTexture->getWidth(), frameTexture->getHeight());
+                }
+                timestamps = frame->timestamps;
+                timestamps.uploaded = FrameTimestamps::Clock::now();
+                uploaded = true;
+            }
+            
+            if (frameTexture && frameTexture->get()) {
+                if (SDL_RenderCopy(renderer, frameTexture->get(), nullptr, &videoRect) < 0) {
                     throw utils::Error("Failed to copy texture: " + std::string(SDL_GetError()));
                 }
             }
             
             SDL_RenderPresent(renderer);
+            
+            if (uploaded) {
+                timestamps.presented = FrameTimestamps::Clock::now();
+                screenMirror->recordPresentedFrame(timestamps);
+            }
 
             // Frame rate control and monitoring
             frameCount++;
             if (SDL_GetTicks() - fpsTimer >= 1000) {
                 float fps = frameCount / ((SDL_GetTicks() - fpsTimer) / 1000.0f);
-                utils::Logger::getInstance().debug("Current FPS: ", fps);
+                const FrameSchedulerStats pacing = frameScheduler.getStats();
+                utils::Logger::getInstance().debug("Current FPS: ", fps,
+                    ", frames shown ", pacing.presented,
+                    ", late ", pacing.late, ", overflowed ", pacing.overflows,
+                    ", jitter ", pacing.jitterUs, "us, buffer delay ", pacing.delayUs, "us");
+                if (frameTexture) {
+                    const DamageStats& damage = frameTexture->getDamageStats();
+                    utils::Logger::getInstance().debug("Texture uploads: ", damage.uploadBytes / 1024,
+                        " KiB, saved ", damage.savedBytes / 1024, " KiB, ",
+                        damage.unchanged, " unchanged and ", damage.partial, " partial frames");
+                }
+                if (inputDispatcher) {
+                    const InputDispatcherStats input = inputDispatcher->getStats();
+                    utils::Logger::getInstance().debug("Input: ", input.dispatched, " of ", input.received,
+                        " events sent, queue depth ", input.queueDepth,
+                        ", moves coalesced ", static_cast<int>(input.coalescingRatio * 100.0), "%, ",
+                        input.lost, " lost to a full queue");
+                }
                 frameCount = 0;
                 fpsTimer = SDL_GetTicks();
             }
 
-            // Frame timing
+            // Frame timing; only needed when present does not wait for vsync
             int frameTime = SDL_GetTicks() - frameStart;
-            if (frameDelay > frameTime) {
+            if (!vsyncEnabled && frameDelay > frameTime) {
                 SDL_Delay(frameDelay - frameTime);
             }
             
@@ -237,10 +377,9 @@ void MainWindow::run() {
 }
 
 void MainWindow::cleanup() {
-    if (frameTexture) {
-        SDL_DestroyTexture(frameTexture);
-        frameTexture = nullptr;
-    }
+    // Waits for a restart in progress, which still uses the session
+    stopRenegotiation();
+    frameTexture.reset();
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = nullptr;
@@ -265,6 +404,28 @@ void MainWindow::setFullscreen(bool fullscreen) {
     fullscreenMode = fullscreen;
 }
 
+void MainWindow::toggleLatencyProbe() {
+    if (screenMirror->getLatencyProbeStats().running) {
+        screenMirror->stopLatencyProbe();
+        return;
+    }
+
+    auto& settings = utils::ConfigManager::getInstance();
+    LatencyProbeConfig probe;
+    probe.regionX = static_cast<float>(settings.get<double>("latencyProbe.regionX", probe.regionX));
+    probe.regionY = static_cast<float>(settings.get<double>("latencyProbe.regionY", probe.regionY));
+    probe.regionWidth = static_cast<float>(settings.get<double>("latencyProbe.regionWidth", probe.regionWidth));
+    probe.regionHeight = static_cast<float>(settings.get<double>("latencyProbe.regionHeight", probe.regionHeight));
+    probe.stimulus = settings.get<std::string>("latencyProbe.stimulus", "tap") == "key"
+        ? ProbeStimulus::Key : ProbeStimulus::Tap;
+    probe.keycode = static_cast<uint32_t>(settings.get<int>("latencyProbe.keycode", 0));
+    probe.threshold = settings.get<int>("latencyProbe.threshold", probe.threshold);
+    probe.intervalMs = settings.get<int>("latencyProbe.intervalMs", probe.intervalMs);
+    probe.timeoutMs = settings.get<int>("latencyProbe.timeoutMs", probe.timeoutMs);
+    probe.samples = settings.get<int>("latencyProbe.samples", probe.samples);
+    screenMirror->startLatencyProbe(probe);
+}
+
 void MainWindow::handleKeyboard(const SDL_KeyboardEvent& event) {
     KeyboardEvent keyEvent{
         .keycode = event.keysym.scancode,
@@ -280,45 +441,115 @@ void MainWindow::handleKeyboard(const SDL_KeyboardEvent& event) {
             setFullscreen(!fullscreenMode);
             return;
         }
+        if (event.keysym.scancode == SDL_SCANCODE_F12) {
+            toggleLatencyProbe();
+            return;
+        }
     }
 
     // Forward other keys to input handler
-    screenMirror->getInputHandler().sendKeyEvent(keyEvent);
+    inputDispatcher->pushKey(keyEvent);
 }
 
 void MainWindow::handleMouse(const SDL_MouseButtonEvent& event) {
+    float x = 0.0f;
+    float y = 0.0f;
+    const bool inside = toDevicePosition(event.x, event.y, x, y);
+    // Presses on the letterbox bars are ignored; releases always go
+    // through so no touch is left down on the device
+    if (event.type == SDL_MOUSEBUTTONDOWN && !inside) {
+        return;
+    }
+
+    const bool pressed = event.type == SDL_MOUSEBUTTONDOWN;
+    dragging = pressed;
+    if (pressed) {
+        // Ctrl+drag pinches and rotates around the center of the video
+        pinching = (SDL_GetModState() & KMOD_CTRL) != 0;
+    }
+
     TouchEvent touchEvent{
         .id = event.which,
-        .x = static_cast<float>(event.x) / windowWidth,
-        .y = static_cast<float>(event.y) / windowHeight,
-        .pressed = event.type == SDL_MOUSEBUTTONDOWN
+        .x = x,
+        .y = y,
+        .pressed = pressed
     };
 
-    screenMirror->getInputHandler().sendTouchEvent(touchEvent);
+    if (pinching) {
+        TouchEvent pair[2];
+        pinchPair(touchEvent, pair);
+        inputDispatcher->pushMultiTouch(pair, 2);
+        pinching = pressed;
+        return;
+    }
+
+    inputDispatcher->pushTouch(touchEvent);
 }
 
 void MainWindow::handleMouseMotion(const SDL_MouseMotionEvent& event) {
-    if (event.state & SDL_BUTTON_LMASK) {
+    if (dragging && (event.state & SDL_BUTTON_LMASK)) {
+        // Drags past the edge of the video stay on its border
+        float x = 0.0f;
+        float y = 0.0f;
+        toDevicePosition(event.x, event.y, x, y);
+
         TouchEvent touchEvent{
             .id = event.which,
-            .x = static_cast<float>(event.x) / windowWidth,
-            .y = static_cast<float>(event.y) / windowHeight,
+            .x = x,
+            .y = y,
             .pressed = true
         };
 
-        screenMirror->getInputHandler().sendTouchEvent(touchEvent);
+        if (pinching) {
+            TouchEvent pair[2];
+            pinchPair(touchEvent, pair);
+            inputDispatcher->pushMultiTouchMove(pair, 2);
+        } else {
+            inputDispatcher->pushTouchMove(touchEvent);
+        }
     }
 }
 
+void MainWindow::handleMouseWheel(const SDL_MouseWheelEvent& event) {
+    int mouseX = 0;
+    int mouseY = 0;
+    SDL_GetMouseState(&mouseX, &mouseY);
+
+    float x = 0.0f;
+    float y = 0.0f;
+    if (!toDevicePosition(mouseX, mouseY, x, y)) {
+        return;
+    }
+
+    const float direction = event.direction == SDL_MOUSEWHEEL_FLIPPED ? -1.0f : 1.0f;
+    ScrollEvent scrollEvent{
+        .x = x,
+        .y = y,
+        .hscroll = direction * static_cast<float>(event.x),
+        .vscroll = direction * static_cast<float>(event.y)
+    };
+
+    inputDispatcher->pushScroll(scrollEvent);
+}
+
 void MainWindow::onDeviceConnected(const DeviceInfo& device) {
     utils::Logger::getInstance().info("Device connected: ", device.model);
     
+    // The device scales to this long side itself; the window only
+    // decides how the result is drawn
+    int streamSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(sizeMutex);
+        streamSize = sizePolicy.initialSize();
+    }
     ScreenConfig config{
-        .width = windowWidth,
-        .height = windowHeight,
+        .width = streamSize,
+        .height = streamSize,
         .maxFps = 60
     };
 
+    // A new stream starts a new pts timeline
+    frameScheduler.reset();
     if (!screenMirror->start(config)) {
         utils::Logger::getInstance().error("Failed to start screen mirroring");
     }
@@ -329,34 +560,117 @@ void MainWindow::onDeviceDisconnected(const DeviceInfo& device) {
     screenMirror->stop();
 }
 
-void MainWindow::onFrameReceived(const FrameData& frame) {
-    if (!frameTexture) {
-        frameTexture = SDL_CreateTexture(
-            renderer,
-            SDL_PIXELFORMAT_RGBA8888,
-            SDL_TEXTUREACCESS_STREAMING,
-            frame.width,
-            frame.height
-        );
-    }
-
-    if (frameTexture) {
-        SDL_UpdateTexture(frameTexture, nullptr, frame.data.data(), frame.width * 4);
-    }
+void MainWindow::onFrameReceived(const FrameRef& frame) {
+    // Never blocks on the renderer; the scheduler holds a few frames and
+    // drops the oldest when full
+    frameScheduler.push(frame);
 }
 
 void MainWindow::resize(int width, int height) {
     windowWidth = width;
     windowHeight = height;
+    if (renderer) {
+        SDL_GetRendererOutputSize(renderer, &drawableWidth, &drawableHeight);
+    }
     
-    // Update screen mirror configuration if active
-    if (screenMirror->isActive()) {
-        ScreenConfig config{
-            .width = width,
-            .height = height,
-            .maxFps = 60
-        };
-        screenMirror->updateConfig(config);
+    // Only the drawing changes; the stream keeps its size unless the
+    // policy decides otherwise once the window has settled
+    updateVideoRect();
+    std::lock_guard<std::mutex> lock(sizeMutex);
+    sizePolicy.windowResized(drawableWidth, drawableHeight, SDL_GetTicks());
+}
+
+void MainWindow::updateVideoRect() {
+    const int contentWidth = frameTexture ? frameTexture->getWidth() : 0;
+    const int contentHeight = frameTexture ? frameTexture->getHeight() : 0;
+    if (!contentWidth || !contentHeight) {
+        videoRect = {0, 0, drawableWidth, drawableHeight};
+        return;
+    }
+    
+    // Compare aspect ratios without division
+    if (static_cast<int64_t>(contentWidth) * drawableHeight >
+        static_cast<int64_t>(drawableWidth) * contentHeight) {
+        videoRect.w = drawableWidth;
+        videoRect.h = static_cast<int>(static_cast<int64_t>(drawableWidth) * contentHeight / contentWidth);
+    } else {
+        videoRect.h = drawableHeight;
+        videoRect.w = static_cast<int>(static_cast<int64_t>(drawableHeight) * contentWidth / contentHeight);
+    }
+    videoRect.x = (drawableWidth - videoRect.w) / 2;
+    videoRect.y = (drawableHeight - videoRect.h) / 2;
+}
+
+bool MainWindow::toDevicePosition(int x, int y, float& deviceX, float& deviceY) const {
+    if (videoRect.w <= 0 || videoRect.h <= 0 || windowWidth <= 0 || windowHeight <= 0) {
+        return false;
+    }
+    
+    // Mouse events are in window coordinates, the video rect in drawable
+    // pixels
+    const float pixelX = static_cast<float>(x) * drawableWidth / windowWidth;
+    const float pixelY = static_cast<float>(y) * drawableHeight / windowHeight;
+    const float relativeX = (pixelX - videoRect.x) / videoRect.w;
+    const float relativeY = (pixelY - videoRect.y) / videoRect.h;
+    
+    deviceX = std::clamp(relativeX, 0.0f, 1.0f);
+    deviceY = std::clamp(relativeY, 0.0f, 1.0f);
+    return relativeX == deviceX && relativeY == deviceY;
+}
+
+void MainWindow::applyStreamSize(int size) {
+    if (!screenMirror->isActive()) {
+        return;
+    }
+    
+    utils::Logger::getInstance().info("Window settled at ", drawableWidth, "x", drawableHeight,
+        ", asking for a ", size > 0 ? std::to_string(size) : std::string("native"), " stream");
+    {
+        // Only the newest size matters if the last one is still being applied
+        std::lock_guard<std::mutex> lock(renegotiationMutex);
+        pendingStreamSize = size;
+        if (!renegotiationThread.joinable()) {
+            renegotiationStopping = false;
+            renegotiationThread = std::thread(&MainWindow::renegotiationLoop, this);
+        }
+    }
+    renegotiationReady.notify_one();
+}
+
+void MainWindow::renegotiationLoop() {
+    std::unique_lock<std::mutex> lock(renegotiationMutex);
+    while (true) {
+        renegotiationReady.wait(lock, [this]() {
+            return renegotiationStopping || pendingStreamSize >= 0;
+        });
+        if (renegotiationStopping) {
+            return;
+        }
+        const int size = pendingStreamSize;
+        pendingStreamSize = -1;
+        lock.unlock();
+        
+        if (screenMirror->isActive()) {
+            ScreenConfig config = screenMirror->getConfig();
+            config.width = size;
+            config.height = size;
+            // A stock scrcpy server cannot resize its stream, so this stops
+            // and restarts the session, which takes seconds
+            screenMirror->updateConfig(config);
+        }
+        lock.lock();
+    }
+}
+
+void MainWindow::stopRenegotiation() {
+    {
+        std::lock_guard<std::mutex> lock(renegotiationMutex);
+        renegotiationStopping = true;
+        pendingStreamSize = -1;
+    }
+    renegotiationReady.notify_all();
+    if (renegotiationThread.joinable()) {
+        renegotiationThread.join();
     }
 }
 
@@ -365,8 +679,7 @@ void MainWindow::handleRendererReset() {
     
     try {
         if (frameTexture) {
-            SDL_DestroyTexture(frameTexture);
-            frameTexture = nullptr;
+            frameTexture->reset();
         }
         
         if (renderer) {
@@ -381,6 +694,10 @@ void MainWindow::handleRendererReset() {
             throw utils::Error("Failed to recreate renderer: " + std::string(SDL_GetError()));
         }
         
+        if (frameTexture) {
+            frameTexture->reset(renderer);
+        }
+        
         utils::Logger::getInstance().info("Graphics device recovery successful");
     } catch (const std::exception& e) {
         utils::Logger::getInstance().error("Failed to recover from graphics device reset: ", e.what());
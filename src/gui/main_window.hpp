@@ -2,8 +2,16 @@
 
 #include <SDL2/SDL.h>
 #include "../core/device_manager.hpp"
+#include "../core/frame_scheduler.hpp"
+#include "../core/input_dispatcher.hpp"
 #include "../core/screen_mirror.hpp"
+#include "frame_texture.hpp"
+#include "stream_size_policy.hpp"
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace mirrolink {
 namespace gui {
@@ -28,29 +36,77 @@ public:
     void onDeviceConnected(const DeviceInfo& device);
     void onDeviceDisconnected(const DeviceInfo& device);
     
-    // Frame handling
-    void onFrameReceived(const FrameData& frame);
+    // Frame handling. Called on the capture thread; the frame is only
+    // uploaded by run() on the render thread, when it is due.
+    void onFrameReceived(const FrameRef& frame);
 
 private:
     // Event handlers
     void handleKeyboard(const SDL_KeyboardEvent& event);
     void handleMouse(const SDL_MouseButtonEvent& event);
     void handleMouseMotion(const SDL_MouseMotionEvent& event);
+    void handleMouseWheel(const SDL_MouseWheelEvent& event);
+    
+    // F12: start or stop the input-to-photon probe, set up from the
+    // latencyProbe.* settings
+    void toggleLatencyProbe();
+    
+    // Fit the stream into the window, keeping its aspect ratio
+    void updateVideoRect();
+    
+    // Map a window position to normalized device coordinates, clamped to
+    // the video; returns false if the position is outside it
+    bool toDevicePosition(int x, int y, float& deviceX, float& deviceY) const;
+    
+    // Ask the device for a stream of a different size. Applied on the
+    // renegotiation thread, since it may restart the session.
+    void applyStreamSize(int size);
+    void renegotiationLoop();
+    void stopRenegotiation();
     
     // Window state
     SDL_Window* window;
     SDL_Renderer* renderer;
-    SDL_Texture* frameTexture;
+    std::unique_ptr<FrameTexture> frameTexture;
+    SDL_Rect videoRect;
+    
+    // Stream resolution follows the window only through this policy;
+    // guarded because devices connect on the device manager's thread
+    StreamSizePolicy sizePolicy;
+    std::mutex sizeMutex;
+    
+    // Decoded frames waiting for their presentation time, handed from the
+    // capture thread to run()
+    FrameScheduler frameScheduler;
+    FrameTimestamps::Clock::duration refreshInterval;
+    bool vsyncEnabled;
     
     // Core components
     std::unique_ptr<DeviceManager> deviceManager;
     std::unique_ptr<ScreenMirror> screenMirror;
+    // Input goes to the device from here, never from the event loop
+    std::unique_ptr<InputDispatcher> inputDispatcher;
     
     // Window properties
     int windowWidth;
     int windowHeight;
+    int drawableWidth;   // Renderer output size; differs on high-DPI displays
+    int drawableHeight;
     bool isRunning;
     bool fullscreenMode;
+    
+    // A drag that started on the video, and whether it is an emulated
+    // two-finger gesture
+    bool dragging;
+    bool pinching;
+    
+    // Hands stream sizes from run() to the renegotiation thread;
+    // pendingStreamSize is -1 when there is none
+    std::thread renegotiationThread;
+    std::mutex renegotiationMutex;
+    std::condition_variable renegotiationReady;
+    int pendingStreamSize;
+    bool renegotiationStopping;
 };
 
 }} // namespace mirrolink::gui
\ No newline at end of file
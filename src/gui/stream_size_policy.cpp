@@ -0,0 +1,86 @@
+#include "stream_size_policy.hpp"
+#include <algorithm>
+
+namespace mirrolink {
+namespace gui {
+
+namespace {
+
+// Stream sizes worth asking for; in-between window sizes round up, so a
+// step covers a range of windows and small drags change nothing
+constexpr int kSizeSteps[] = {720, 1080, 1440, 1920, 2560, 3840};
+
+// A stream this much bigger than the window wastes bandwidth and decode
+// time; one this much smaller looks soft
+constexpr int kShrinkFactor = 2;
+constexpr float kGrowFactor = 1.1f;
+
+} // namespace
+
+StreamSizePolicy::StreamSizePolicy(int maxSize, Uint32 debounceMs)
+    : maxSize(std::max(maxSize, 0))
+    , debounceMs(debounceMs)
+    , windowLongSide(0)
+    , streamLongSide(0)
+    , requested(0)
+    , lastResize(0)
+    , pending(false)
+{}
+
+int StreamSizePolicy::initialSize() {
+    streamLongSide = 0;
+    requested = targetFor(windowLongSide);
+    pending = false;
+    return requested;
+}
+
+void StreamSizePolicy::windowResized(int width, int height, Uint32 now) {
+    windowLongSide = std::max(width, height);
+    lastResize = now;
+    pending = true;
+}
+
+void StreamSizePolicy::streamResized(int width, int height) {
+    streamLongSide = std::max(width, height);
+}
+
+bool StreamSizePolicy::poll(Uint32 now, int& size) {
+    if (!pending || now - lastResize < debounceMs || streamLongSide == 0) {
+        return false;
+    }
+    pending = false;
+
+    const int target = targetFor(windowLongSide);
+    if (target == requested) {
+        return false;
+    }
+    const bool tooSmall = windowLongSide > streamLongSide * kGrowFactor;
+    const bool tooBig = windowLongSide * kShrinkFactor < streamLongSide;
+    if (!tooSmall && !tooBig) {
+        return false;
+    }
+    // Already native: asking for more than the device has gains nothing
+    if (tooSmall && requested == 0) {
+        return false;
+    }
+
+    requested = target;
+    size = target;
+    return true;
+}
+
+int StreamSizePolicy::targetFor(int longSide) const {
+    int target = 0;
+    for (int step : kSizeSteps) {
+        if (step >= longSide) {
+            target = step;
+            break;
+        }
+    }
+    if (maxSize > 0) {
+        target = target > 0 ? std::min(target, maxSize) : maxSize;
+    }
+    return target;
+}
+
+}} // namespace mirrolink::gui
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+namespace mirrolink {
+namespace gui {
+
+// Decides the stream resolution from the window size. The renderer scales
+// whatever arrives, so a resize alone never touches the stream; a new size
+// is only asked for once the window has stayed put for a while and the
+// stream is clearly too small for it, or far bigger than it.
+class StreamSizePolicy {
+public:
+    // maxSize caps the long side of the stream; 0 allows the device's
+    // native resolution
+    explicit StreamSizePolicy(int maxSize = 0, Uint32 debounceMs = 750);
+
+    // Long side to ask for when a stream starts in the current window
+    int initialSize();
+
+    // The window's drawable size changed
+    void windowResized(int width, int height, Uint32 now);
+
+    // Long side of the frames actually arriving
+    void streamResized(int width, int height);
+
+    // True once a different stream size is worth a renegotiation; the new
+    // long side is returned in size
+    bool poll(Uint32 now, int& size);
+
+private:
+    int targetFor(int windowLongSide) const;
+
+    int maxSize;
+    Uint32 debounceMs;
+    int windowLongSide;
+    int streamLongSide;
+    int requested;
+    Uint32 lastResize;
+    bool pending;
+};
+
+}} // namespace mirrolink::gui
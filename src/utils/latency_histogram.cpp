@@ -0,0 +1,133 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+namespace mirrolink {
+namespace utils {
+
+namespace {
+
+int bitWidth(uint64_t value) {
+    int width = 0;
+    while (value) {
+        value >>= 1;
+        width++;
+    }
+    return width;
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucketFor(uint64_t micros) {
+    if (micros < static_cast<uint64_t>(kExactLimit)) {
+        return static_cast<size_t>(micros);
+    }
+
+    // Keep the top 6 significant bits: 32..63 after the shift
+    const int exponent = std::min(bitWidth(micros) - 6, kMaxExponent);
+    const uint64_t subBucket = std::min<uint64_t>(micros >> exponent, 2 * kSubBuckets - 1);
+    return kExactLimit + static_cast<size_t>(exponent - 1) * kSubBuckets +
+           static_cast<size_t>(subBucket - kSubBuckets);
+}
+
+int64_t LatencyHistogram::bucketUpperValue(size_t bucket) {
+    if (bucket < static_cast<size_t>(kExactLimit)) {
+        return static_cast<int64_t>(bucket);
+    }
+    if (bucket == kBucketCount - 1) {
+        // Everything past the top of the range is clamped into this bucket
+        return std::numeric_limits<int64_t>::max();
+    }
+
+    const size_t offset = bucket - kExactLimit;
+    const int exponent = static_cast<int>(offset / kSubBuckets) + 1;
+    const int64_t subBucket = static_cast<int64_t>(offset % kSubBuckets) + kSubBuckets;
+    return ((subBucket + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::record(int64_t micros) {
+    micros = std::max<int64_t>(micros, 0);
+
+    buckets[bucketFor(static_cast<uint64_t>(micros))].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(static_cast<uint64_t>(micros), std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t previous = maxValue.load(std::memory_order_relaxed);
+    while (micros > previous &&
+           !maxValue.compare_exchange_weak(previous, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total = 0;
+    sum = 0;
+    maxValue = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::percentile(double percent) const {
+    const uint64_t recorded = count();
+    if (recorded == 0) {
+        return 0;
+    }
+
+    const double clamped = std::clamp(percent, 0.0, 100.0);
+    const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(
+        std::ceil(clamped / 100.0 * static_cast<double>(recorded))));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            // The bucket's upper bound can exceed anything actually recorded
+            return std::min(bucketUpperValue(i), maxValue.load(std::memory_order_relaxed));
+        }
+    }
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    LatencySummary result;
+    result.count = count();
+    if (result.count == 0) {
+        return result;
+    }
+
+    result.meanMs = static_cast<double>(sum.load(std::memory_order_relaxed)) / result.count / 1000.0;
+    result.p50Ms = percentile(50.0) / 1000.0;
+    result.p99Ms = percentile(99.0) / 1000.0;
+    result.p999Ms = percentile(99.9) / 1000.0;
+    result.maxMs = maxValue.load(std::memory_order_relaxed) / 1000.0;
+    return result;
+}
+
+void LatencyHistogram::writeDistribution(std::ostream& out) const {
+    const uint64_t recorded = count();
+    if (recorded == 0) {
+        return;
+    }
+
+    const int64_t maxRecorded = maxValue.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        const uint64_t inBucket = buckets[i].load(std::memory_order_relaxed);
+        if (inBucket == 0) {
+            continue;
+        }
+        seen += inBucket;
+        out << std::fixed << std::setprecision(3)
+            << std::min(bucketUpperValue(i), maxRecorded) / 1000.0 << ' '
+            << std::setprecision(4) << 100.0 * static_cast<double>(seen) / recorded << ' '
+            << seen << '\n';
+    }
+}
+
+}} // namespace mirrolink::utils
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace mirrolink {
+namespace utils {
+
+struct LatencySummary {
+    uint64_t count = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double p999Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Log-linear histogram of durations in microseconds, in the style of
+// HdrHistogram: values below 64us are exact, and every power of two above
+// that is split into 32 linear buckets, so percentiles are within ~3% from
+// 1us up to about an hour. Recording is lock-free and allocation-free.
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(int64_t micros);
+    void reset();
+
+    uint64_t count() const;
+
+    // Highest value in the bucket holding the given percentile (0-100)
+    int64_t percentile(double percent) const;
+
+    LatencySummary summary() const;
+
+    // One "value_ms percentile cumulative_count" line per non-empty bucket
+    void writeDistribution(std::ostream& out) const;
+
+private:
+    static constexpr int kSubBuckets = 32;
+    static constexpr int kExactLimit = 2 * kSubBuckets;
+    static constexpr int kMaxExponent = 27;  // Top bucket starts at 2^32us
+    static constexpr size_t kBucketCount = kExactLimit + kMaxExponent * kSubBuckets;
+
+    static size_t bucketFor(uint64_t micros);
+    static int64_t bucketUpperValue(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<int64_t> maxValue{0};
+};
+
+}} // namespace mirrolink::utils
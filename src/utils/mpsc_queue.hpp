@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mirrolink {
+namespace utils {
+
+// Bounded lock-free queue for any number of producer threads and one
+// consumer thread. Each slot carries a sequence number that tells whose
+// turn it is, so producers only contend on the tail index and never on
+// each other's slots. Storage is allocated once in the constructor.
+template<typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity) {
+        size_t storage = 1;
+        while (storage < capacity) {
+            storage <<= 1;
+        }
+        slots = std::vector<Slot>(storage);
+        for (size_t i = 0; i < storage; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = storage - 1;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Producer side, any thread. Returns false if the queue is full.
+    bool tryPush(T value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[tail & mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - tail);
+            if (difference == 0) {
+                // The slot is free for this lap; claim it
+                if (tailIndex.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                tail = tailIndex.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side. Returns false if the queue is empty or the next item
+    // is still being written.
+    bool tryPop(T& value) {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        Slot& slot = slots[head & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.sequence.store(head + slots.size(), std::memory_order_release);
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items; exact when all sides are idle
+    size_t size() const {
+        const size_t tail = tailIndex.load(std::memory_order_acquire);
+        const size_t head = headIndex.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return slots.size(); }
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    alignas(64) std::atomic<size_t> headIndex{0};
+};
+
+}} // namespace mirrolink::utils
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mirrolink {
+namespace utils {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Storage is allocated once in the constructor; push and pop never
+// touch the heap.
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : maxSize(capacity > 0 ? capacity : 1)
+    {
+        size_t storage = 1;
+        while (storage < maxSize) {
+            storage <<= 1;
+        }
+        slots.resize(storage);
+        mask = storage - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false if the queue is full.
+    bool tryPush(T value) {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead >= maxSize) {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead >= maxSize) {
+                return false;
+            }
+        }
+        slots[tail & mask] = std::move(value);
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool tryPop(T& value) {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[head & mask]);
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items; exact when both sides are idle
+    size_t size() const {
+        const size_t tail = tailIndex.load(std::memory_order_acquire);
+        const size_t head = headIndex.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    size_t capacity() const { return maxSize; }
+    bool empty() const { return size() == 0; }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    const size_t maxSize;
+
+    // Producer and consumer indexes live on separate cache lines, each next
+    // to the owning side's cached copy of the other index
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> headIndex{0};
+    size_t cachedTail = 0;
+};
+
+// Lets a thread that found nothing to do sleep until another thread hands
+// it work. While nobody sleeps, notify() is a fence and a load.
+class WakeSignal {
+public:
+    // Sleep until notify() or the timeout. ready() is checked again once
+    // the sleeper is registered, so work published by a notify() that saw
+    // no sleeper is not slept through.
+    template<typename Ready>
+    void wait(Ready ready, std::chrono::milliseconds timeout) {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const uint64_t seen = generation.load(std::memory_order_acquire);
+        if (!ready()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait_for(lock, timeout, [&]() {
+                return generation.load(std::memory_order_acquire) != seen;
+            });
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Call after publishing the work
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation.fetch_add(1, std::memory_order_release);
+        }
+        wakeup.notify_all();
+    }
+
+private:
+    std::atomic<int> sleepers{0};
+    std::atomic<uint64_t> generation{0};
+    std::mutex mutex;
+    std::condition_variable wakeup;
+};
+
+// Wait strategy for pipeline stages polling a queue: spin briefly, then
+// yield, then park on the stage's WakeSignal until a producer hands it
+// work. Without a signal it sleeps in short steps instead.
+class Backoff {
+public:
+    Backoff() = default;
+    explicit Backoff(WakeSignal& signal) : signal(&signal) {}
+
+    void wait() {
+        wait([]() { return false; });
+    }
+
+    // ready() says whether there is work after all; it is checked right
+    // before parking
+    template<typename Ready>
+    void wait(Ready ready) {
+        if (attempts < 64) {
+            ++attempts;
+        } else if (attempts < 128) {
+            ++attempts;
+            std::this_thread::yield();
+        } else if (signal) {
+            // The timeout only bounds a wait whose wakeup went missing
+            signal->wait(ready, std::chrono::milliseconds(100));
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    void reset() { attempts = 0; }
+
+private:
+    WakeSignal* signal = nullptr;
+    int attempts = 0;
+};
+
+}} // namespace mirrolink::utils
@@ -0,0 +1,126 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace mirrolink {
+namespace utils {
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::runParallel(int count, int bands, BandBody body, void* context) {
+    if (count <= 0) {
+        return;
+    }
+
+    bands = std::clamp(bands, 1, count);
+    const int helpers = std::min(bands - 1, static_cast<int>(workers.size()));
+    if (helpers == 0) {
+        body(context, 0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> serial(parallelMutex);
+    BandJob current;
+    current.body = body;
+    current.context = context;
+    current.count = count;
+    current.bands = bands;
+    current.bandSize = (count + bands - 1) / bands;
+    current.helperSlots = helpers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &current;
+    }
+    wake.notify_all();
+
+    runBands(current);
+
+    // Helpers reference this stack frame, so close the job to latecomers
+    // and wait for the ones already in it, not just for the bands to be
+    // claimed
+    std::unique_lock<std::mutex> lock(mutex);
+    job = nullptr;
+    jobDone.wait(lock, [&]() { return current.helpersRunning == 0; });
+}
+
+void ThreadPool::runBands(BandJob& job) {
+    for (int band = job.nextBand++; band < job.bands; band = job.nextBand++) {
+        const int begin = band * job.bandSize;
+        const int end = std::min(job.count, begin + job.bandSize);
+        if (begin < end) {
+            job.body(job.context, begin, end);
+        }
+    }
+}
+
+size_t ThreadPool::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        BandJob* bands = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() {
+                return stopping || !tasks.empty() || (job && job->helperSlots > 0);
+            });
+            // Bands first: their caller is blocked until they are done
+            if (job && job->helperSlots > 0) {
+                bands = job;
+                bands->helperSlots--;
+                bands->helpersRunning++;
+            } else if (stopping && tasks.empty()) {
+                return;
+            } else {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+        }
+
+        if (bands) {
+            runBands(*bands);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--bands->helpersRunning == 0) {
+                jobDone.notify_one();
+            }
+            continue;
+        }
+        task();
+    }
+}
+
+}} // namespace mirrolink::utils
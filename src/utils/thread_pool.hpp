@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mirrolink {
+namespace utils {
+
+// Fixed set of worker threads fed from a FIFO task queue
+class ThreadPool {
+public:
+    // 0 threads means one per CPU core
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task; the future carries its result or exception
+    template<typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // Split [0, count) into up to `bands` contiguous ranges and run
+    // body(begin, end) on each, using the calling thread as one of the
+    // workers. Returns once every range is done. Idle workers claim bands
+    // straight from the caller, so nothing is allocated per call.
+    template<typename F>
+    void parallelFor(int count, int bands, F&& body) {
+        using Body = std::remove_reference_t<F>;
+        runParallel(count, bands, [](void* context, int begin, int end) {
+            (*static_cast<Body*>(context))(begin, end);
+        }, const_cast<std::remove_const_t<Body>*>(std::addressof(body)));
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Tasks queued but not yet started
+    size_t pending() const;
+
+private:
+    using BandBody = void (*)(void* context, int begin, int end);
+
+    // A parallelFor call in progress; lives on the caller's stack
+    struct BandJob {
+        BandBody body;
+        void* context;
+        int count;
+        int bands;
+        int bandSize;
+        std::atomic<int> nextBand{0};
+        int helperSlots;         // Workers that may still join; guarded by mutex
+        int helpersRunning = 0;  // Guarded by mutex
+    };
+
+    void runParallel(int count, int bands, BandBody body, void* context);
+    static void runBands(BandJob& job);
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    BandJob* job = nullptr;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable jobDone;
+    std::mutex parallelMutex;  // One parallelFor at a time
+    bool stopping = false;
+};
+
+}} // namespace mirrolink::utils
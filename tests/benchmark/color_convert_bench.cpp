@@ -0,0 +1,95 @@
+#include "../../src/core/color_convert.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+using namespace mirrolink;
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr int kIterations = 200;
+
+double millisecondsPerFrame(const std::function<void()>& convertFrame) {
+    // Warm caches and thread pools before timing
+    for (int i = 0; i < 10; ++i) {
+        convertFrame();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        convertFrame();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / kIterations;
+}
+
+void report(const char* name, double ms, double baseline) {
+    std::printf("%-20s %8.3f ms/frame  %7.1f fps  %5.2fx\n", name, ms, 1000.0 / ms, baseline / ms);
+}
+
+} // namespace
+
+int main() {
+    const int chromaWidth = kWidth / 2;
+    std::vector<uint8_t> y(static_cast<size_t>(kWidth) * kHeight);
+    std::vector<uint8_t> u(static_cast<size_t>(chromaWidth) * kHeight / 2);
+    std::vector<uint8_t> v(u.size());
+    std::vector<uint8_t> rgba(static_cast<size_t>(kWidth) * kHeight * 4);
+
+    std::mt19937 rng(1);
+    for (auto* plane : {&y, &u, &v}) {
+        for (auto& sample : *plane) {
+            sample = static_cast<uint8_t>(rng());
+        }
+    }
+
+    const uint8_t* planes[3] = { y.data(), u.data(), v.data() };
+    const int strides[3] = { kWidth, chromaWidth, chromaWidth };
+
+    // The path ScreenMirror used before ColorConverter existed
+    SwsContext* sws = sws_getContext(kWidth, kHeight, AV_PIX_FMT_YUV420P,
+        kWidth, kHeight, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        std::fprintf(stderr, "Could not create swscale context\n");
+        return 1;
+    }
+
+    uint8_t* dst[4] = { rgba.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { kWidth * 4, 0, 0, 0 };
+    const double baseline = millisecondsPerFrame([&]() {
+        sws_scale(sws, planes, strides, 0, kHeight, dst, dstStride);
+    });
+    sws_freeContext(sws);
+
+    std::printf("YUV420P -> RGBA, %dx%d\n", kWidth, kHeight);
+    report("swscale bilinear", baseline, baseline);
+
+    ColorConversion conversion;
+    for (ColorKernel kernel : {ColorKernel::Scalar, ColorKernel::SSE2, ColorKernel::AVX2, ColorKernel::AVX512}) {
+        if (!ColorConverter::isSupported(kernel)) {
+            continue;
+        }
+
+        ColorConverter converter(1, kernel);
+        report(ColorConverter::kernelName(kernel), millisecondsPerFrame([&]() {
+            converter.convert(planes, strides, kWidth, kHeight, rgba.data(), kWidth * 4, conversion);
+        }), baseline);
+    }
+
+    ColorConverter banded;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s, banded", ColorConverter::kernelName(banded.getKernel()));
+    report(name, millisecondsPerFrame([&]() {
+        banded.convert(planes, strides, kWidth, kHeight, rgba.data(), kWidth * 4, conversion);
+    }), baseline);
+
+    return 0;
+}
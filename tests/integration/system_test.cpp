@@ -39,7 +39,7 @@ TEST_F(SystemIntegrationTest, CompleteWorkflow) {
         
         // Set up screen mirroring
         auto screenMirror = std::make_unique<ScreenMirror>();
-        screenMirror->setFrameCallback([&](const FrameData& frame) {
+        screenMirror->setFrameCallback([&](const FrameRef& frame) {
             frameReceived = true;
         });
         
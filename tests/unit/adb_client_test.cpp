@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+#include "../../src/core/adb_client.hpp"
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+namespace {
+
+// Stand-in for the adb server: accepts connections on an ephemeral port and
+// hands each one to a handler that speaks the host protocol
+class FakeAdbServer {
+public:
+    using Handler = std::function<void(FakeAdbServer&, int)>;
+
+    explicit FakeAdbServer(Handler handler) : handler(std::move(handler)) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        listen(listener, 8);
+        socklen_t length = sizeof(addr);
+        getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length);
+        port = ntohs(addr.sin_port);
+
+        thread = std::thread([this]() {
+            while (true) {
+                int client = accept(listener, nullptr, nullptr);
+                if (client < 0) {
+                    return;
+                }
+                connections++;
+                this->handler(*this, client);
+                close(client);
+            }
+        });
+    }
+
+    ~FakeAdbServer() {
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        thread.join();
+    }
+
+    // Next request on the connection, without its length prefix
+    std::string readRequest(int fd) {
+        std::string length = readBytes(fd, 4);
+        if (length.size() < 4) {
+            return std::string();
+        }
+        std::string service = readBytes(fd, std::stoul(length, nullptr, 16));
+        requests.push_back(service);
+        return service;
+    }
+
+    std::string readBytes(int fd, size_t size) {
+        std::string data(size, '\0');
+        size_t received = 0;
+        while (received < size) {
+            ssize_t n = recv(fd, &data[received], size - received, 0);
+            if (n <= 0) {
+                data.resize(received);
+                break;
+            }
+            received += static_cast<size_t>(n);
+        }
+        return data;
+    }
+
+    static void reply(int fd, const std::string& data) {
+        send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    }
+
+    static void okay(int fd) {
+        reply(fd, "OKAY");
+    }
+
+    static void fail(int fd, const std::string& message) {
+        reply(fd, "FAIL" + AdbClient::encodeRequest(message));
+    }
+
+    uint16_t port = 0;
+    std::atomic<int> connections{0};
+    std::vector<std::string> requests;
+
+private:
+    Handler handler;
+    int listener = -1;
+    std::thread thread;
+};
+
+uint32_t littleEndian(const std::string& bytes) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | static_cast<uint8_t>(bytes[i]);
+    }
+    return value;
+}
+
+} // namespace
+
+TEST(AdbClientTest, EncodesRequests) {
+    EXPECT_EQ(AdbClient::encodeRequest("host:version"), "000chost:version");
+    EXPECT_EQ(AdbClient::encodeRequest(""), "0000");
+}
+
+TEST(AdbClientTest, HostQueries) {
+    FakeAdbServer server([](FakeAdbServer& self, int fd) {
+        const std::string request = self.readRequest(fd);
+        if (request == "host:version") {
+            FakeAdbServer::okay(fd);
+            FakeAdbServer::reply(fd, "00040029");
+        } else if (request == "host:devices") {
+            FakeAdbServer::okay(fd);
+            FakeAdbServer::reply(fd, AdbClient::encodeRequest("emulator-5554\tdevice\nR58M\tunauthorized\n"));
+        }
+    });
+    AdbClient adb(server.port);
+
+    AdbResult<int> version = adb.version();
+    ASSERT_TRUE(version) << version.error;
+    EXPECT_EQ(version.value, 41);
+
+    AdbResult<std::vector<AdbDevice>> devices = adb.devices();
+    ASSERT_TRUE(devices) << devices.error;
+    ASSERT_EQ(devices.value.size(), 2u);
+    EXPECT_EQ(devices.value[0].serial, "emulator-5554");
+    EXPECT_EQ(devices.value[0].state, "device");
+    EXPECT_EQ(devices.value[1].state, "unauthorized");
+}
+
+TEST(AdbClientTest, ShellThroughTransport) {
+    FakeAdbServer server([](FakeAdbServer& self, int fd) {
+        const std::string transport = self.readRequest(fd);
+        if (transport != "host:transport:emulator-5554") {
+            FakeAdbServer::fail(fd, "device '" + transport.substr(15) + "' not found");
+            return;
+        }
+        FakeAdbServer::okay(fd);
+        const std::string shell = self.readRequest(fd);
+        FakeAdbServer::okay(fd);
+        FakeAdbServer::reply(fd, "ran " + shell.substr(6) + "\n");
+    });
+    AdbClient adb(server.port);
+
+    adb.setSerial("emulator-5554");
+    AdbResult<std::string> output = adb.shell("input tap 10 20");
+    ASSERT_TRUE(output) << output.error;
+    EXPECT_EQ(output.value, "ran input tap 10 20\n");
+
+    adb.setSerial("missing");
+    output = adb.shell("true");
+    EXPECT_FALSE(output);
+    EXPECT_EQ(output.error, "device 'missing' not found");
+}
+
+TEST(AdbClientTest, ForwardWaitsForBothReplies) {
+    FakeAdbServer server([](FakeAdbServer& self, int fd) {
+        self.readRequest(fd);
+        FakeAdbServer::okay(fd);
+        FakeAdbServer::fail(fd, "cannot bind listener");
+    });
+    AdbClient adb(server.port);
+
+    AdbStatus status = adb.forward("tcp:27183", "localabstract:scrcpy");
+    EXPECT_FALSE(status);
+    EXPECT_EQ(status.error, "cannot bind listener");
+    ASSERT_EQ(server.requests.size(), 1u);
+    EXPECT_EQ(server.requests[0], "host:forward:tcp:27183;localabstract:scrcpy");
+}
+
+TEST(AdbClientTest, PushesOverOneSyncConnection) {
+    std::vector<std::string> files;
+    FakeAdbServer server([&files](FakeAdbServer& self, int fd) {
+        if (self.readRequest(fd) != "host:transport-any") {
+            return;
+        }
+        FakeAdbServer::okay(fd);
+        if (self.readRequest(fd) != "sync:") {
+            return;
+        }
+        FakeAdbServer::okay(fd);
+
+        std::string file;
+        while (true) {
+            const std::string header = self.readBytes(fd, 8);
+            if (header.size() < 8 || header.compare(0, 4, "QUIT") == 0) {
+                return;
+            }
+            const std::string body = header.compare(0, 4, "DONE") == 0
+                ? std::string() : self.readBytes(fd, littleEndian(header.substr(4)));
+            if (header.compare(0, 4, "SEND") == 0) {
+                file = body + ":";
+            } else if (header.compare(0, 4, "DATA") == 0) {
+                file += body;
+            } else if (header.compare(0, 4, "DONE") == 0) {
+                files.push_back(file);
+                FakeAdbServer::reply(fd, std::string("OKAY\0\0\0\0", 8));
+            }
+        }
+    });
+
+    {
+        AdbClient adb(server.port);
+        std::vector<uint8_t> payload(100000, 'x');
+        ASSERT_TRUE(adb.push(payload, "/data/local/tmp/a"));
+        const std::string text = "hello";
+        ASSERT_TRUE(adb.push(std::vector<uint8_t>(text.begin(), text.end()), "/data/local/tmp/b", 0755));
+    }
+
+    ASSERT_EQ(files.size(), 2u);
+    EXPECT_EQ(files[0], "/data/local/tmp/a,33188:" + std::string(100000, 'x'));
+    EXPECT_EQ(files[1], "/data/local/tmp/b,33261:hello");
+    EXPECT_EQ(server.connections.load(), 1);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "../../src/core/bitrate_controller.hpp"
+
+using namespace mirrolink;
+
+TEST(BitrateControllerTest, BacksOffAndHoldsOnCongestion) {
+    BitrateControllerConfig config;
+    config.minBitrate = 2000000;
+    config.maxBitrate = 8000000;
+    BitrateController controller(config);
+
+    LinkSample congested;
+    congested.receivedBps = 8000000;
+    congested.lagMs = 300;
+    BitrateDecision decision = controller.update(congested);
+    EXPECT_TRUE(decision.changed);
+    EXPECT_EQ(decision.bitrate, 5600000);
+    EXPECT_EQ(decision.maxFps, 60);
+
+    // The cut has not taken effect yet; no second cut for holdIntervals
+    for (int i = 0; i < config.holdIntervals; ++i) {
+        EXPECT_FALSE(controller.update(congested).changed);
+    }
+    for (int i = 0; i < 10; ++i) {
+        controller.update(congested);
+    }
+    EXPECT_EQ(controller.getBitrate(), config.minBitrate);
+}
+
+TEST(BitrateControllerTest, ProbesUpOnlyWhenStableAndUsed) {
+    BitrateControllerConfig config;
+    config.minBitrate = 1000000;
+    config.maxBitrate = 4000000;
+    config.holdIntervals = 0;
+    BitrateController controller(config);
+
+    LinkSample congested;
+    congested.queued = 4;
+    congested.queueDepth = 4;
+    controller.update(congested);
+    ASSERT_EQ(controller.getBitrate(), 2800000);
+
+    // A static screen uses a fraction of the cap: stay put
+    LinkSample idle;
+    idle.receivedBps = 500000;
+    for (int i = 0; i < 2 * config.stableIntervals; ++i) {
+        EXPECT_FALSE(controller.update(idle).changed);
+    }
+
+    LinkSample busy;
+    busy.receivedBps = 2700000;
+    for (int i = 0; i < config.stableIntervals - 1; ++i) {
+        EXPECT_FALSE(controller.update(busy).changed);
+    }
+    EXPECT_EQ(controller.update(busy).bitrate, 3300000);
+    EXPECT_EQ(controller.getDecreases(), 1u);
+    EXPECT_EQ(controller.getIncreases(), 1u);
+}
+
+TEST(BitrateControllerTest, SlowDecoderLowersFrameRate) {
+    BitrateControllerConfig config;
+    config.minFps = 20;
+    config.maxFps = 60;
+    config.holdIntervals = 0;
+    BitrateController controller(config);
+
+    LinkSample slow;
+    slow.receivedBps = 8000000;
+    slow.decodeUs = 25000;  // Over the 16.7ms a frame at 60fps allows
+    BitrateDecision decision = controller.update(slow);
+    EXPECT_EQ(decision.maxFps, 45);
+    EXPECT_EQ(decision.bitrate, config.maxBitrate);
+    EXPECT_EQ(controller.update(slow).maxFps, 33);
+    EXPECT_EQ(controller.update(slow).maxFps, 24);
+    // 25ms fits in a 24fps frame; the rate settles there
+    EXPECT_FALSE(controller.update(slow).changed);
+}
+
+TEST(BitrateControllerTest, ResumesFromAppliedSettings) {
+    BitrateControllerConfig config;
+    config.minBitrate = 2000000;
+    config.maxBitrate = 8000000;
+    BitrateController controller(config);
+    controller.resume(3000000, 90);
+    EXPECT_EQ(controller.getBitrate(), 3000000);
+    EXPECT_EQ(controller.getMaxFps(), config.maxFps);
+
+    // The restart is still settling; no cut until the hold is over
+    LinkSample congested;
+    congested.lagMs = 300;
+    for (int i = 0; i < config.holdIntervals; ++i) {
+        EXPECT_FALSE(controller.update(congested).changed);
+    }
+    const BitrateDecision decision = controller.update(congested);
+    EXPECT_TRUE(decision.changed);
+    EXPECT_EQ(decision.bitrate, 2100000);
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include "../../src/core/color_convert.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+using namespace mirrolink;
+
+namespace {
+
+struct TestImage {
+    int width;
+    int height;
+    int strides[3];
+    std::vector<uint8_t> y, u, v;
+
+    // Strides are padded past the visible width, as decoders do
+    TestImage(int w, int h, unsigned seed, bool uniformChroma = false)
+        : width(w), height(h) {
+        strides[0] = w + 24;
+        strides[1] = strides[2] = (w + 1) / 2 + 16;
+        const int chromaHeight = (h + 1) / 2;
+        y.resize(static_cast<size_t>(strides[0]) * h);
+        u.resize(static_cast<size_t>(strides[1]) * chromaHeight);
+        v.resize(static_cast<size_t>(strides[2]) * chromaHeight);
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> byte(0, 255);
+        for (auto& sample : y) sample = static_cast<uint8_t>(byte(rng));
+        if (uniformChroma) {
+            // Constant chroma makes any chroma upsampling filter exact
+            std::fill(u.begin(), u.end(), static_cast<uint8_t>(byte(rng)));
+            std::fill(v.begin(), v.end(), static_cast<uint8_t>(byte(rng)));
+        } else {
+            for (auto& sample : u) sample = static_cast<uint8_t>(byte(rng));
+            for (auto& sample : v) sample = static_cast<uint8_t>(byte(rng));
+        }
+    }
+
+    const uint8_t* planes[3];
+    const uint8_t* const* planePointers() {
+        planes[0] = y.data();
+        planes[1] = u.data();
+        planes[2] = v.data();
+        return planes;
+    }
+};
+
+std::vector<uint8_t> convert(ColorConverter& converter, TestImage& image,
+                             const ColorConversion& conversion) {
+    std::vector<uint8_t> out(static_cast<size_t>(image.width) * 4 * image.height);
+    converter.convert(image.planePointers(), image.strides, image.width, image.height,
+                      out.data(), image.width * 4, conversion);
+    return out;
+}
+
+} // namespace
+
+class ColorKernelTest : public ::testing::TestWithParam<ColorKernel> {};
+
+TEST(ColorConvertTest, ScalarMatchesFloatReference) {
+    ColorConverter converter(1, ColorKernel::Scalar);
+    TestImage image(37, 9, 1);
+    ColorConversion conversion;
+    conversion.matrix = ColorMatrix::BT709;
+    const auto out = convert(converter, image, conversion);
+
+    const double kr = 0.2126, kb = 0.0722, kg = 1.0 - kr - kb;
+    for (int row = 0; row < image.height; ++row) {
+        for (int x = 0; x < image.width; ++x) {
+            const double luma = (image.y[row * image.strides[0] + x] - 16) * 255.0 / 219.0;
+            const double cb = (image.u[(row / 2) * image.strides[1] + x / 2] - 128) * 255.0 / 224.0;
+            const double cr = (image.v[(row / 2) * image.strides[2] + x / 2] - 128) * 255.0 / 224.0;
+            const double expected[3] = {
+                luma + 2.0 * (1.0 - kr) * cr,
+                luma - 2.0 * kb * (1.0 - kb) / kg * cb - 2.0 * kr * (1.0 - kr) / kg * cr,
+                luma + 2.0 * (1.0 - kb) * cb,
+            };
+
+            const uint8_t* pixel = &out[(row * image.width + x) * 4];
+            for (int c = 0; c < 3; ++c) {
+                const double clamped = std::min(255.0, std::max(0.0, expected[c]));
+                EXPECT_LE(std::abs(pixel[c] - clamped), 1.0) << "x=" << x << " row=" << row;
+            }
+            EXPECT_EQ(pixel[3], 255);
+        }
+    }
+}
+
+TEST(ColorConvertTest, BgraSwapsRedAndBlue) {
+    ColorConverter converter(1, ColorKernel::Auto);
+    TestImage image(64, 4, 2);
+    ColorConversion rgba;
+    ColorConversion bgra;
+    bgra.bgra = true;
+
+    const auto a = convert(converter, image, rgba);
+    const auto b = convert(converter, image, bgra);
+    for (size_t i = 0; i < a.size(); i += 4) {
+        EXPECT_EQ(a[i], b[i + 2]);
+        EXPECT_EQ(a[i + 1], b[i + 1]);
+        EXPECT_EQ(a[i + 2], b[i]);
+    }
+}
+
+TEST(ColorConvertTest, BandsMatchSingleThread) {
+    ColorConverter single(1);
+    ColorConverter banded(4);
+    TestImage image(1280, 720, 3);
+    ColorConversion conversion;
+    conversion.range = ColorRange::Full;
+
+    EXPECT_EQ(convert(single, image, conversion), convert(banded, image, conversion));
+}
+
+TEST_P(ColorKernelTest, KernelIsBitExactWithScalar) {
+    if (!ColorConverter::isSupported(GetParam())) {
+        GTEST_SKIP() << ColorConverter::kernelName(GetParam()) << " not supported on this CPU";
+    }
+
+    ColorConverter scalar(1, ColorKernel::Scalar);
+    ColorConverter simd(1, GetParam());
+    ASSERT_EQ(simd.getKernel(), GetParam());
+
+    // Odd widths exercise the scalar tail after the vector loop
+    for (int width : {1, 7, 33, 67, 250, 1921}) {
+        TestImage image(width, 6, width);
+        for (ColorMatrix matrix : {ColorMatrix::BT601, ColorMatrix::BT709}) {
+            for (ColorRange range : {ColorRange::Limited, ColorRange::Full}) {
+                for (bool bgra : {false, true}) {
+                    ColorConversion conversion{matrix, range, bgra};
+                    EXPECT_EQ(convert(scalar, image, conversion), convert(simd, image, conversion))
+                        << "width=" << width;
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, ColorKernelTest,
+    ::testing::Values(ColorKernel::SSE2, ColorKernel::AVX2, ColorKernel::AVX512),
+    [](const ::testing::TestParamInfo<ColorKernel>& info) {
+        return std::string(ColorConverter::kernelName(info.param));
+    });
+
+TEST(ColorConvertTest, MatchesSwscale) {
+    const int width = 640;
+    const int height = 64;
+
+    for (ColorMatrix matrix : {ColorMatrix::BT601, ColorMatrix::BT709}) {
+        for (ColorRange range : {ColorRange::Limited, ColorRange::Full}) {
+            TestImage image(width, height, 4 + static_cast<int>(matrix) * 2 + static_cast<int>(range), true);
+
+            SwsContext* sws = sws_getContext(width, height, AV_PIX_FMT_YUV420P,
+                width, height, AV_PIX_FMT_RGBA,
+                SWS_POINT | SWS_ACCURATE_RND | SWS_BITEXACT, nullptr, nullptr, nullptr);
+            ASSERT_NE(sws, nullptr);
+
+            const int* coefficients = sws_getCoefficients(
+                matrix == ColorMatrix::BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601);
+            sws_setColorspaceDetails(sws, coefficients, range == ColorRange::Full ? 1 : 0,
+                coefficients, 1, 0, 1 << 16, 1 << 16);
+
+            std::vector<uint8_t> expected(static_cast<size_t>(width) * 4 * height);
+            uint8_t* dst[4] = { expected.data(), nullptr, nullptr, nullptr };
+            int dstStride[4] = { width * 4, 0, 0, 0 };
+            sws_scale(sws, image.planePointers(), image.strides, 0, height, dst, dstStride);
+            sws_freeContext(sws);
+
+            ColorConverter converter(1);
+            ColorConversion conversion{matrix, range, false};
+            const auto actual = convert(converter, image, conversion);
+
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_LE(std::abs(actual[i] - expected[i]), 1) << "byte " << i;
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "../../src/core/control_channel.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+TEST(ControlChannelTest, EncodesVideoSettings) {
+    VideoSettings settings;
+    settings.bitrate = 8000000;
+    settings.maxFps = 60;
+    settings.maxSize = 1920;
+
+    const std::vector<uint8_t> expected = {
+        0x80,
+        0x00, 0x7A, 0x12, 0x00,
+        0x00, 0x3C,
+        0x07, 0x80,
+    };
+    EXPECT_EQ(ControlChannel::encodeVideoSettings(settings), expected);
+}
+
+TEST(ControlChannelTest, SendsExtensionsOnlyOnceAnnounced) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    ControlChannel channel;
+    EXPECT_FALSE(channel.sendVideoSettings(VideoSettings()));
+    channel.attach(fds[0]);
+    ASSERT_TRUE(channel.isConnected());
+
+    // A stock server never announces anything
+    VideoSettings settings;
+    settings.bitrate = 4000000;
+    EXPECT_FALSE(channel.sendVideoSettings(settings));
+    EXPECT_FALSE(channel.requestKeyframe());
+
+    // A clipboard message split across writes, then the announcement
+    const uint8_t clipboard[] = {0x00, 0, 0, 0, 3, 'a', 'b', 'c'};
+    const uint8_t capabilities[] = {0x80, 0, 0, 0, 0x01};
+    ASSERT_EQ(write(fds[1], clipboard, 3), 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(write(fds[1], clipboard + 3, sizeof(clipboard) - 3), static_cast<ssize_t>(sizeof(clipboard) - 3));
+    ASSERT_EQ(write(fds[1], capabilities, sizeof(capabilities)), static_cast<ssize_t>(sizeof(capabilities)));
+    for (int i = 0; i < 200 && !channel.supports(ControlCapability::VideoSettings); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_TRUE(channel.supports(ControlCapability::VideoSettings));
+    EXPECT_FALSE(channel.requestKeyframe());
+    ASSERT_TRUE(channel.sendVideoSettings(settings));
+
+    // Nothing was written before the announcement
+    uint8_t received[16];
+    ASSERT_EQ(read(fds[1], received, sizeof(received)), 9);
+    EXPECT_EQ(received[0], static_cast<uint8_t>(ControlMessageType::SetVideoSettings));
+
+    channel.close();
+    EXPECT_FALSE(channel.isConnected());
+    EXPECT_EQ(channel.getCapabilities(), 0u);
+    close(fds[1]);
+}
+
+TEST(ControlChannelTest, EncodesInputMessages) {
+    TouchMessage touch;
+    touch.action = TouchAction::Move;
+    touch.pointerId = 1;
+    touch.position = {100, 200, 1080, 2400};
+    touch.pressure = 1.0f;
+
+    uint8_t buffer[ControlChannel::kTouchMessageSize];
+    ASSERT_EQ(ControlChannel::encodeTouch(touch, buffer), ControlChannel::kTouchMessageSize);
+    const std::vector<uint8_t> expectedTouch = {
+        0x02, 0x02,
+        0, 0, 0, 0, 0, 0, 0, 1,
+        0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0xC8,
+        0x04, 0x38, 0x09, 0x60,
+        0xFF, 0xFF,
+        0, 0, 0, 0,
+        0, 0, 0, 0,
+    };
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + sizeof(buffer)), expectedTouch);
+
+    ScrollMessage scroll;
+    scroll.position = {1, 2, 3, 4};
+    scroll.hscroll = -1.0f;
+    scroll.vscroll = 0.5f;
+    ASSERT_EQ(ControlChannel::encodeScroll(scroll, buffer), ControlChannel::kScrollMessageSize);
+    EXPECT_EQ(buffer[0], 0x03);
+    EXPECT_EQ(buffer[13], 0x80);
+    EXPECT_EQ(buffer[14], 0x00);
+    EXPECT_EQ(buffer[15], 0x40);
+    EXPECT_EQ(buffer[16], 0x00);
+
+    KeycodeMessage key;
+    key.action = KeyAction::Up;
+    key.keycode = 66;
+    key.metaState = 0x1000;
+    ASSERT_EQ(ControlChannel::encodeKeycode(key, buffer), ControlChannel::kKeycodeMessageSize);
+    const std::vector<uint8_t> expectedKey = {
+        0x00, 0x01, 0, 0, 0, 66, 0, 0, 0, 0, 0, 0, 0x10, 0x00,
+    };
+    EXPECT_EQ(std::vector<uint8_t>(buffer, buffer + ControlChannel::kKeycodeMessageSize), expectedKey);
+}
+
+TEST(ControlChannelTest, QueuesWhileTheSocketIsFull) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int bufferSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    ControlChannel channel;
+    channel.attach(fds[0]);
+
+    // Nobody reads yet, so all of this cannot fit into the socket; sends
+    // must neither block nor reorder
+    TouchMessage touch;
+    touch.action = TouchAction::Move;
+    touch.position = {0, 0, 1080, 2400};
+    const int count = 1000;
+    for (int i = 0; i < count; ++i) {
+        touch.position.x = i;
+        ASSERT_TRUE(channel.injectTouch(touch));
+    }
+    EXPECT_GT(channel.getPendingBytes(), 0u);
+
+    std::vector<uint8_t> received(count * ControlChannel::kTouchMessageSize);
+    size_t total = 0;
+    while (total < received.size()) {
+        const ssize_t n = read(fds[1], received.data() + total, received.size() - total);
+        ASSERT_GT(n, 0);
+        total += static_cast<size_t>(n);
+    }
+    for (int i = 0; i < count; ++i) {
+        const uint8_t* message = &received[i * ControlChannel::kTouchMessageSize];
+        ASSERT_EQ(message[0], static_cast<uint8_t>(ControlMessageType::InjectTouchEvent));
+        EXPECT_EQ(message[12] << 8 | message[13], i);
+    }
+    EXPECT_EQ(channel.getPendingBytes(), 0u);
+
+    channel.close();
+    close(fds[1]);
+}
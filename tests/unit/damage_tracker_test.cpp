@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include "../../src/core/damage_tracker.hpp"
+#include <vector>
+
+using namespace mirrolink;
+
+TEST(DamageTrackerTest, FindsChangedTiles) {
+    // 4x3 tiles of 64 pixels, the last column and row cut short
+    const int width = 230;
+    const int height = 150;
+    std::vector<uint8_t> pixels(width * height * 4);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<uint8_t>(i * 7);
+    }
+    FrameData frame{};
+    frame.width = width;
+    frame.height = height;
+    frame.format = PixelFormat::RGBA;
+    frame.planes[0] = pixels.data();
+    frame.strides[0] = width * 4;
+
+    DamageTracker tracker;
+    std::vector<DamageRect> rects;
+    ASSERT_TRUE(tracker.update(frame, rects));
+    ASSERT_EQ(rects.size(), 1u);
+    EXPECT_EQ(rects[0].width, width);
+
+    EXPECT_FALSE(tracker.update(frame, rects));
+    EXPECT_TRUE(rects.empty());
+
+    // One pixel in tile (1, 0) and a column down the last tiles
+    pixels[(10 * width + 70) * 4] ^= 1;
+    for (int y = 0; y < height; ++y) {
+        pixels[(y * width + 229) * 4 + 3] ^= 0x80;
+    }
+    ASSERT_TRUE(tracker.update(frame, rects));
+    ASSERT_EQ(rects.size(), 2u);
+    EXPECT_EQ(rects[0].x, 64);
+    EXPECT_EQ(rects[0].y, 0);
+    EXPECT_EQ(rects[0].width, 64);
+    EXPECT_EQ(rects[0].height, 64);
+    // Same columns in every row merge into one rect
+    EXPECT_EQ(rects[1].x, 192);
+    EXPECT_EQ(rects[1].width, width - 192);
+    EXPECT_EQ(rects[1].height, height);
+
+    const DamageStats& stats = tracker.getStats();
+    EXPECT_EQ(stats.unchanged, 1u);
+    EXPECT_EQ(stats.partial, 1u);
+    EXPECT_EQ(stats.uploadBytes, static_cast<uint64_t>(width * height + 64 * 64 + (width - 192) * height) * 4);
+}
+
+TEST(DamageTrackerTest, SeesChromaOnlyChanges) {
+    const int width = 128;
+    const int height = 128;
+    std::vector<uint8_t> luma(width * height, 100);
+    std::vector<uint8_t> uv(width * height / 2, 128);
+    FrameData frame{};
+    frame.width = width;
+    frame.height = height;
+    frame.format = PixelFormat::NV12;
+    frame.planes[0] = luma.data();
+    frame.planes[1] = uv.data();
+    frame.strides[0] = width;
+    frame.strides[1] = width;
+
+    DamageTracker tracker;
+    std::vector<DamageRect> rects;
+    tracker.update(frame, rects);
+
+    // V sample of the bottom-right tile
+    uv[(40 * width) + 100 + 1] = 50;
+    ASSERT_TRUE(tracker.update(frame, rects));
+    ASSERT_EQ(rects.size(), 1u);
+    EXPECT_EQ(rects[0].x, 64);
+    EXPECT_EQ(rects[0].y, 64);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../../src/core/frame_pool.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace mirrolink;
+
+class FramePoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        pool = std::make_unique<FramePool>();
+    }
+
+    void TearDown() override {
+        pool.reset();
+    }
+
+    std::unique_ptr<FramePool> pool;
+};
+
+TEST_F(FramePoolTest, FirstAcquireIsMiss) {
+    FrameRef frame = pool->acquire(1920 * 1080 * 4);
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->data.size(), 1920u * 1080u * 4u);
+
+    auto stats = pool->getStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.outstanding, 1u);
+}
+
+TEST_F(FramePoolTest, ReleasedBufferIsRecycled) {
+    const uint8_t* first = nullptr;
+    {
+        FrameRef frame = pool->acquire(4096);
+        first = frame->data.data();
+    }
+
+    FrameRef frame = pool->acquire(4096);
+    EXPECT_EQ(frame->data.data(), first);
+
+    auto stats = pool->getStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.capacity, 1u);
+}
+
+TEST_F(FramePoolTest, CopiesShareOneBuffer) {
+    FrameRef frame = pool->acquire(64);
+    FrameRef copy = frame;
+    EXPECT_EQ(frame.useCount(), 2u);
+    EXPECT_EQ(copy.get(), frame.get());
+
+    frame.reset();
+    EXPECT_EQ(copy.useCount(), 1u);
+    EXPECT_EQ(pool->getStats().outstanding, 1u);
+
+    copy.reset();
+    EXPECT_EQ(pool->getStats().outstanding, 0u);
+}
+
+TEST_F(FramePoolTest, SteadyStateHasNoMisses) {
+    // Simulate a capture thread with up to three frames in flight
+    std::vector<FrameRef> inFlight;
+    for (int i = 0; i < 300; ++i) {
+        inFlight.push_back(pool->acquire(1280 * 720 * 4));
+        if (inFlight.size() > 3) {
+            inFlight.erase(inFlight.begin());
+        }
+    }
+
+    auto stats = pool->getStats();
+    EXPECT_EQ(stats.misses, 4u);
+    EXPECT_EQ(stats.hits, 296u);
+    EXPECT_EQ(stats.highWaterMark, 4u);
+}
+
+TEST_F(FramePoolTest, LargerFrameCountsAsMiss) {
+    pool->acquire(100);
+    FrameRef frame = pool->acquire(200);
+    EXPECT_EQ(frame->data.size(), 200u);
+    EXPECT_EQ(pool->getStats().misses, 2u);
+}
+
+TEST_F(FramePoolTest, HandleOutlivesPool) {
+    FrameRef frame = pool->acquire(128);
+    pool.reset();
+
+    frame->data[0] = 42;
+    EXPECT_EQ(frame->data[0], 42);
+    frame.reset();
+}
+
+TEST_F(FramePoolTest, ConcurrentRelease) {
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < 4; ++t) {
+        consumers.emplace_back([this]() {
+            for (int i = 0; i < 1000; ++i) {
+                FrameRef frame = pool->acquire(256);
+                FrameRef copy = frame;
+            }
+        });
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    auto stats = pool->getStats();
+    EXPECT_EQ(stats.outstanding, 0u);
+    EXPECT_EQ(stats.hits + stats.misses, 4000u);
+    EXPECT_LE(stats.capacity, 4u);
+}
+
+TEST_F(FramePoolTest, TrimReleasesIdleBuffers) {
+    FrameRef held = pool->acquire(64);
+    pool->acquire(64);
+    EXPECT_EQ(pool->getStats().capacity, 2u);
+
+    pool->trim();
+    EXPECT_EQ(pool->getStats().capacity, 1u);
+}
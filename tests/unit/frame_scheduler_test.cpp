@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "../../src/core/frame_scheduler.hpp"
+#include <chrono>
+#include <vector>
+
+using namespace mirrolink;
+
+TEST(FrameSchedulerTest, SmoothsBurstyArrivals) {
+    using Clock = FrameScheduler::Clock;
+    const int64_t interval = 16667;
+    const Clock::time_point start = Clock::now();
+    auto at = [&](int64_t us) { return start + std::chrono::microseconds(us); };
+
+    FramePool pool;
+    FrameScheduler scheduler;
+
+    // Every other frame is held back and arrives together with the next
+    int next = 0;
+    auto arrival = [&](int i) { return i * interval + (i % 2 == 0 ? interval : 0); };
+    std::vector<int64_t> shown;
+    for (int tick = 1; tick < 120; ++tick) {
+        const int64_t now = tick * interval + 500;
+        for (; arrival(next) <= now; ++next) {
+            FrameRef frame = pool.acquire(16);
+            frame->timestamp = next * interval;
+            scheduler.push(frame, at(arrival(next)));
+        }
+        FrameRef frame;
+        if (scheduler.next(at(now), std::chrono::microseconds(interval), frame)) {
+            shown.push_back(frame->timestamp);
+        }
+    }
+
+    // Once the jitter is measured, one frame per refresh, none skipped
+    ASSERT_GT(shown.size(), 60u);
+    for (size_t i = shown.size() - 60; i < shown.size(); ++i) {
+        EXPECT_EQ(shown[i] - shown[i - 1], interval);
+    }
+    const FrameSchedulerStats stats = scheduler.getStats();
+    EXPECT_LE(stats.delayUs, interval);
+    EXPECT_GT(stats.jitterUs, interval / 2);
+}
+
+TEST(FrameSchedulerTest, ShowsNewestDueFrameWithoutBuffering) {
+    using Clock = FrameScheduler::Clock;
+    FrameSchedulerConfig config;
+    config.maxDelayFrames = 0;
+    FrameScheduler scheduler(config);
+    FramePool pool;
+
+    const Clock::time_point now = Clock::now();
+    for (int i = 0; i < 3; ++i) {
+        FrameRef frame = pool.acquire(16);
+        frame->timestamp = i * 10000;
+        scheduler.push(frame, now);
+    }
+    FrameRef frame;
+    ASSERT_TRUE(scheduler.next(now + std::chrono::milliseconds(20), std::chrono::milliseconds(16), frame));
+    EXPECT_EQ(frame->timestamp, 20000);
+    EXPECT_EQ(scheduler.getStats().late, 2u);
+    EXPECT_FALSE(scheduler.next(now + std::chrono::milliseconds(40), std::chrono::milliseconds(16), frame));
+}
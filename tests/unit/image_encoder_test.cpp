@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "../../src/core/image_encoder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace mirrolink;
+
+namespace {
+
+// Reference QOI decoder, straight from the format specification
+std::vector<uint8_t> decodeQoi(const std::vector<uint8_t>& data, int& width, int& height) {
+    auto read32 = [&](size_t at) {
+        return static_cast<uint32_t>(data[at]) << 24 | static_cast<uint32_t>(data[at + 1]) << 16 |
+               static_cast<uint32_t>(data[at + 2]) << 8 | data[at + 3];
+    };
+    width = static_cast<int>(read32(4));
+    height = static_cast<int>(read32(8));
+
+    std::vector<uint8_t> pixels;
+    uint8_t seen[64][4]{};
+    uint8_t px[4] = {0, 0, 0, 255};
+    size_t pos = 14;
+    const size_t total = static_cast<size_t>(width) * height;
+    while (pixels.size() < total * 4) {
+        const uint8_t op = data[pos++];
+        int run = 1;
+        if (op == 0xfe) {
+            px[0] = data[pos++]; px[1] = data[pos++]; px[2] = data[pos++];
+        } else if (op == 0xff) {
+            px[0] = data[pos++]; px[1] = data[pos++]; px[2] = data[pos++]; px[3] = data[pos++];
+        } else if ((op & 0xc0) == 0x00) {
+            std::memcpy(px, seen[op], 4);
+        } else if ((op & 0xc0) == 0x40) {
+            px[0] += ((op >> 4) & 3) - 2; px[1] += ((op >> 2) & 3) - 2; px[2] += (op & 3) - 2;
+        } else if ((op & 0xc0) == 0x80) {
+            const int dg = (op & 0x3f) - 32;
+            const uint8_t next = data[pos++];
+            px[0] += dg + ((next >> 4) & 0x0f) - 8; px[1] += dg; px[2] += dg + (next & 0x0f) - 8;
+        } else {
+            run = (op & 0x3f) + 1;
+        }
+        std::memcpy(seen[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        for (int i = 0; i < run; ++i) {
+            pixels.insert(pixels.end(), px, px + 4);
+        }
+    }
+    return pixels;
+}
+
+} // namespace
+
+TEST(ImageEncoderTest, QoiRoundTrips) {
+    // Flat areas, gradients, noise and alpha, to hit every QOI op
+    const int width = 97;
+    const int height = 61;
+    const int stride = width * 4 + 12;
+    std::vector<uint8_t> image(static_cast<size_t>(stride) * height);
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* px = &image[static_cast<size_t>(y) * stride + x * 4];
+            seed = seed * 1103515245 + 12345;
+            if (y < 20) {
+                px[0] = 30; px[1] = 60; px[2] = 90; px[3] = 255;
+            } else if (y < 40) {
+                px[0] = static_cast<uint8_t>(x * 2); px[1] = static_cast<uint8_t>(x * 2 + y);
+                px[2] = static_cast<uint8_t>(y); px[3] = 255;
+            } else {
+                px[0] = static_cast<uint8_t>(seed >> 8); px[1] = static_cast<uint8_t>(seed >> 16);
+                px[2] = static_cast<uint8_t>(seed >> 24); px[3] = (x % 7 == 0) ? 128 : 255;
+            }
+        }
+    }
+
+    std::vector<uint8_t> encoded;
+    ImageEncoder::encodeQoi(image.data(), width, height, stride, encoded);
+    ASSERT_GT(encoded.size(), 22u);
+    EXPECT_EQ(std::memcmp(encoded.data(), "qoif", 4), 0);
+    const std::vector<uint8_t> end = {0, 0, 0, 0, 0, 0, 0, 1};
+    EXPECT_TRUE(std::equal(end.begin(), end.end(), encoded.end() - 8));
+
+    int decodedWidth = 0;
+    int decodedHeight = 0;
+    const std::vector<uint8_t> decoded = decodeQoi(encoded, decodedWidth, decodedHeight);
+    ASSERT_EQ(decodedWidth, width);
+    ASSERT_EQ(decodedHeight, height);
+    for (int y = 0; y < height; ++y) {
+        ASSERT_EQ(std::memcmp(&decoded[static_cast<size_t>(y) * width * 4],
+                              &image[static_cast<size_t>(y) * stride], width * 4), 0) << "row " << y;
+    }
+}
+
+TEST(ImageEncoderTest, Nv12MatchesYuv420p) {
+    const int width = 64;
+    const int height = 32;
+    std::vector<uint8_t> luma(width * height);
+    std::vector<uint8_t> u(width / 2 * height / 2);
+    std::vector<uint8_t> v(u.size());
+    std::vector<uint8_t> uv(u.size() * 2);
+    for (size_t i = 0; i < luma.size(); ++i) {
+        luma[i] = static_cast<uint8_t>(16 + i % 220);
+    }
+    for (size_t i = 0; i < u.size(); ++i) {
+        u[i] = static_cast<uint8_t>(40 + i % 180);
+        v[i] = static_cast<uint8_t>(200 - i % 150);
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+
+    FrameData planar{};
+    planar.width = width;
+    planar.height = height;
+    planar.format = PixelFormat::YUV420P;
+    planar.planes[0] = luma.data();
+    planar.planes[1] = u.data();
+    planar.planes[2] = v.data();
+    planar.strides[0] = width;
+    planar.strides[1] = planar.strides[2] = width / 2;
+
+    FrameData semiPlanar = planar;
+    semiPlanar.format = PixelFormat::NV12;
+    semiPlanar.planes[1] = uv.data();
+    semiPlanar.planes[2] = nullptr;
+    semiPlanar.strides[1] = width;
+
+    std::vector<uint8_t> fromPlanar;
+    std::vector<uint8_t> fromSemiPlanar;
+    ASSERT_TRUE(ImageEncoder::toRgba(planar, fromPlanar));
+    ASSERT_TRUE(ImageEncoder::toRgba(semiPlanar, fromSemiPlanar));
+    EXPECT_EQ(fromPlanar.size(), static_cast<size_t>(width * height * 4));
+    EXPECT_EQ(fromPlanar, fromSemiPlanar);
+}
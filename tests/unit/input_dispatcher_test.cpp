@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "../../src/core/control_channel.hpp"
+#include "../../src/core/input_dispatcher.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+TEST(InputDispatcherTest, CoalescesMovesButKeepsPressAndRelease) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ControlChannel channel;
+    channel.attach(fds[0]);
+    channel.setScreenSize(1000, 1000);
+    InputHandler handler;
+    handler.setControlChannel(&channel);
+
+    // Fewer than the queue holds, so no move is dropped
+    const int count = 1000;
+    InputDispatcherStats stats;
+    {
+        InputDispatcher dispatcher(handler);
+        dispatcher.pushTouch({0, 0.0f, 0.0f, true});
+        for (int i = 1; i <= count; ++i) {
+            dispatcher.pushTouchMove({0, i / static_cast<float>(count), 0.5f, true});
+        }
+        dispatcher.pushTouch({0, 1.0f, 0.5f, false});
+        dispatcher.pushKey({0x24, true, false, false, false});
+        // Every event ends up either delivered or replaced by a newer move;
+        // an empty queue alone does not mean the last batch is through
+        stats = dispatcher.getStats();
+        while (stats.dispatched + stats.coalesced < stats.received) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stats = dispatcher.getStats();
+        }
+    }
+    EXPECT_EQ(stats.received, static_cast<uint64_t>(count + 3));
+    EXPECT_EQ(stats.moves, static_cast<uint64_t>(count));
+    EXPECT_EQ(stats.dropped, 0u);
+
+    std::vector<uint8_t> received;
+    std::thread reader([&]() {
+        uint8_t chunk[4096];
+        ssize_t n = 0;
+        while ((n = read(fds[1], chunk, sizeof(chunk))) > 0) {
+            received.insert(received.end(), chunk, chunk + n);
+        }
+    });
+    while (channel.getPendingBytes() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    channel.close();
+    reader.join();
+    close(fds[1]);
+    ASSERT_EQ((received.size() - ControlChannel::kKeycodeMessageSize) % ControlChannel::kTouchMessageSize, 0u);
+
+    // Down, moves in increasing order ending at the last position, up,
+    // then the key
+    const size_t touches = (received.size() - ControlChannel::kKeycodeMessageSize) / ControlChannel::kTouchMessageSize;
+    ASSERT_GE(touches, 3u);
+    EXPECT_EQ(touches - 2 + stats.coalesced, static_cast<uint64_t>(count));
+    auto action = [&](size_t i) { return received[i * ControlChannel::kTouchMessageSize + 1]; };
+    auto x = [&](size_t i) {
+        const uint8_t* p = &received[i * ControlChannel::kTouchMessageSize + 10];
+        return p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    };
+    EXPECT_EQ(action(0), static_cast<uint8_t>(TouchAction::Down));
+    for (size_t i = 1; i + 1 < touches; ++i) {
+        EXPECT_EQ(action(i), static_cast<uint8_t>(TouchAction::Move));
+        EXPECT_GT(x(i), x(i - 1));
+    }
+    EXPECT_EQ(x(touches - 2), 999);
+    EXPECT_EQ(action(touches - 1), static_cast<uint8_t>(TouchAction::Up));
+    EXPECT_EQ(received[touches * ControlChannel::kTouchMessageSize], static_cast<uint8_t>(ControlMessageType::InjectKeycode));
+}
+
+TEST(InputDispatcherTest, WakesForInputAfterIdling) {
+    InputHandler handler;
+    InputDispatcher dispatcher(handler);
+    // Long enough for the dispatcher thread to block
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto pushed = std::chrono::steady_clock::now();
+    dispatcher.pushKey({0x24, true, false, false, false});
+    while (dispatcher.getStats().dispatched < 1 &&
+           std::chrono::steady_clock::now() - pushed < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(dispatcher.getStats().dispatched, 1u);
+    EXPECT_EQ(dispatcher.getStats().lost, 0u);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "../../src/core/control_channel.hpp"
+#include "../../src/core/input_handler.hpp"
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+TEST(InputHandlerTest, InjectsMultiTouchFramesAsBatches) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ControlChannel channel;
+    channel.attach(fds[0]);
+    channel.setScreenSize(1000, 2000);
+    InputHandler handler;
+    handler.setControlChannel(&channel);
+
+    // Down, then one move, then up; ids stay the same across frames
+    std::vector<TouchEvent> frame = {{7, 0.25f, 0.5f, true}, {9, 0.75f, 0.5f, true}};
+    handler.sendMultiTouchEvents(frame);
+    frame[0].x = 0.2f;
+    frame[1].x = 0.8f;
+    handler.sendMultiTouchEvents(frame);
+    frame[0].pressed = false;
+    frame[1].pressed = false;
+    handler.sendMultiTouchEvents(frame);
+    // Releasing pointers that are no longer down sends nothing
+    handler.sendMultiTouchEvents(frame);
+
+    const size_t size = ControlChannel::kTouchMessageSize;
+    std::vector<uint8_t> received(6 * size);
+    size_t total = 0;
+    while (total < received.size()) {
+        const ssize_t n = read(fds[1], received.data() + total, received.size() - total);
+        ASSERT_GT(n, 0);
+        total += static_cast<size_t>(n);
+    }
+    channel.close();
+    uint8_t extra = 0;
+    EXPECT_EQ(read(fds[1], &extra, 1), 0);
+    close(fds[1]);
+
+    const uint8_t expectedActions[] = {0, 0, 2, 2, 1, 1};
+    const uint8_t expectedIds[] = {7, 9, 7, 9, 7, 9};
+    const int expectedX[] = {250, 750, 200, 800, 200, 800};
+    for (size_t i = 0; i < 6; ++i) {
+        const uint8_t* message = &received[i * size];
+        EXPECT_EQ(message[0], static_cast<uint8_t>(ControlMessageType::InjectTouchEvent));
+        EXPECT_EQ(message[1], expectedActions[i]);
+        EXPECT_EQ(message[9], expectedIds[i]);
+        EXPECT_EQ(message[12] << 8 | message[13], expectedX[i]);
+        EXPECT_EQ(message[16] << 8 | message[17], 1000);
+    }
+}
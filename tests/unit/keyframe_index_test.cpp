@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "../../src/core/keyframe_index.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+TEST(KeyframeIndexTest, RoundTripsEntries) {
+    const std::string path = ::testing::TempDir() + "keyframe_index_test.idx";
+    {
+        KeyframeIndexWriter writer;
+        ASSERT_TRUE(writer.open(path));
+        for (uint64_t i = 0; i < 100; ++i) {
+            KeyframeEntry entry;
+            entry.ptsUs = static_cast<int64_t>(i) * 2000000;
+            entry.byteOffset = i * 1000000 + 48;
+            entry.frameNumber = i * 120;
+            ASSERT_TRUE(writer.append(entry));
+        }
+    }
+
+    KeyframeIndex index;
+    ASSERT_TRUE(index.load(path));
+    ASSERT_EQ(index.getEntries().size(), 100u);
+    EXPECT_EQ(index.getEntries()[42].byteOffset, 42000048u);
+    EXPECT_EQ(index.getEntries()[42].frameNumber, 5040u);
+
+    EXPECT_EQ(index.find(-5)->ptsUs, 0);
+    EXPECT_EQ(index.find(7000000)->ptsUs, 6000000);
+    EXPECT_EQ(index.find(8000000)->ptsUs, 8000000);
+    EXPECT_EQ(index.find(INT64_MAX)->ptsUs, 198000000);
+    std::remove(path.c_str());
+}
+
+TEST(KeyframeIndexTest, IgnoresTruncatedRecord) {
+    const std::string path = ::testing::TempDir() + "keyframe_index_truncated.idx";
+    {
+        KeyframeIndexWriter writer;
+        ASSERT_TRUE(writer.open(path));
+        ASSERT_TRUE(writer.append(KeyframeEntry{0, 0, 0}));
+        ASSERT_TRUE(writer.append(KeyframeEntry{1000000, 5000, 30}));
+    }
+    // As if the recorder died halfway through a record
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x01\x02\x03", 3);
+    }
+
+    KeyframeIndex index;
+    ASSERT_TRUE(index.load(path));
+    EXPECT_EQ(index.getEntries().size(), 2u);
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(index.load(path));
+    EXPECT_TRUE(index.empty());
+    EXPECT_EQ(index.find(0), nullptr);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "../../src/utils/latency_histogram.hpp"
+#include <sstream>
+#include <string>
+
+using namespace mirrolink;
+
+TEST(LatencyHistogramTest, ExactBelowSixtyFourMicros) {
+    utils::LatencyHistogram histogram;
+    for (int i = 1; i <= 50; ++i) {
+        histogram.record(i);
+    }
+    EXPECT_EQ(histogram.count(), 50u);
+    EXPECT_EQ(histogram.percentile(50.0), 25);
+    EXPECT_EQ(histogram.percentile(100.0), 50);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinBucketPrecision) {
+    utils::LatencyHistogram histogram;
+    // 1..100000us uniformly, so p50 is ~50ms and p99 is ~99ms
+    for (int i = 1; i <= 100000; ++i) {
+        histogram.record(i);
+    }
+
+    auto summary = histogram.summary();
+    EXPECT_NEAR(summary.p50Ms, 50.0, 50.0 * 0.035);
+    EXPECT_NEAR(summary.p99Ms, 99.0, 99.0 * 0.035);
+    EXPECT_NEAR(summary.p999Ms, 99.9, 99.9 * 0.035);
+    EXPECT_DOUBLE_EQ(summary.maxMs, 100.0);
+    EXPECT_NEAR(summary.meanMs, 50.0, 0.01);
+}
+
+TEST(LatencyHistogramTest, HugeValuesLandInTopBucket) {
+    utils::LatencyHistogram histogram;
+    histogram.record(-5);
+    histogram.record(int64_t(1) << 40);
+    EXPECT_EQ(histogram.percentile(0.0), 0);
+    EXPECT_EQ(histogram.percentile(100.0), int64_t(1) << 40);
+
+    std::ostringstream out;
+    histogram.writeDistribution(out);
+    EXPECT_NE(out.str().find("100.0000 2"), std::string::npos);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "../../src/core/latency_probe.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace mirrolink;
+
+TEST(LatencyProbeTest, SignatureOnlyCoversTheRegion) {
+    const int width = 64;
+    const int height = 64;
+    std::vector<uint8_t> luma(width * height, 16);
+    FrameData frame{};
+    frame.width = width;
+    frame.height = height;
+    frame.format = PixelFormat::YUV420P;
+    frame.planes[0] = luma.data();
+    frame.strides[0] = width;
+
+    LatencyProbeConfig config;
+    config.regionX = 0.5f;
+    config.regionY = 0.5f;
+    config.regionWidth = 0.5f;
+    config.regionHeight = 0.5f;
+    LatencyProbe::Signature before;
+    LatencyProbe::computeSignature(frame, config, before);
+
+    // Outside the region
+    std::fill(luma.begin(), luma.begin() + width * 16, 235);
+    LatencyProbe::Signature after;
+    LatencyProbe::computeSignature(frame, config, after);
+    EXPECT_EQ(before, after);
+
+    // The bottom-right corner is the last cell of the region
+    luma[(height - 1) * width + width - 1] = 235;
+    luma[(height - 2) * width + width - 1] = 235;
+    LatencyProbe::computeSignature(frame, config, after);
+    EXPECT_EQ(before[0], after[0]);
+    EXPECT_GT(after[LatencyProbe::kGrid * LatencyProbe::kGrid - 1], before[0]);
+}
+
+TEST(LatencyProbeTest, RejectsInvalidConfig) {
+    LatencyProbe probe;
+    auto stimulus = []() {};
+    LatencyProbeConfig config;
+    config.regionX = 0.9f;
+    EXPECT_FALSE(probe.start(config, stimulus));
+
+    config = LatencyProbeConfig();
+    config.timeoutMs = 0;
+    EXPECT_FALSE(probe.start(config, stimulus));
+
+    config = LatencyProbeConfig();
+    config.stimulus = ProbeStimulus::Key;
+    EXPECT_FALSE(probe.start(config, stimulus));
+    EXPECT_FALSE(probe.isRunning());
+}
+
+TEST(LatencyProbeTest, TimesInputsToTheFramesThatShowThem) {
+    using Clock = LatencyProbe::Clock;
+    const int width = 64;
+    const int height = 64;
+    std::vector<uint8_t> luma(width * height, 16);
+    FrameData frame{};
+    frame.width = width;
+    frame.height = height;
+    frame.format = PixelFormat::YUV420P;
+    frame.planes[0] = luma.data();
+    frame.strides[0] = width;
+
+    // The "device" lights up or darkens the region on each input
+    std::atomic<int> inputs{0};
+    LatencyProbeConfig config;
+    config.intervalMs = 5;
+    config.timeoutMs = 1000;
+    config.samples = 3;
+    LatencyProbe probe;
+    ASSERT_TRUE(probe.start(config, [&inputs]() { inputs++; }));
+    EXPECT_FALSE(probe.start(config, [&inputs]() { inputs++; }));
+
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+    int shown = 0;
+    while (probe.isRunning() && Clock::now() < deadline) {
+        const int seen = inputs.load();
+        if (seen != shown) {
+            std::fill(luma.begin(), luma.end(), seen % 2 ? 200 : 16);
+            shown = seen;
+        }
+        frame.timestamps.converted = Clock::now();
+        probe.onFrame(frame);
+        FrameTimestamps presented = frame.timestamps;
+        presented.presented = Clock::now();
+        probe.onPresented(presented);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const LatencyProbeStats stats = probe.getStats();
+    EXPECT_FALSE(stats.running);
+    EXPECT_EQ(stats.probes, 3u);
+    EXPECT_EQ(stats.detected, 3u);
+    EXPECT_EQ(stats.missed, 0u);
+    EXPECT_EQ(stats.inputToFrame.count, 3u);
+    EXPECT_EQ(stats.inputToPhoton.count, 3u);
+    EXPECT_GE(stats.inputToPhoton.maxMs, stats.inputToFrame.maxMs);
+}
+
+TEST(LatencyProbeTest, ReportsTheEndOfEveryRun) {
+    LatencyProbeConfig config;
+    config.intervalMs = 1;
+    config.timeoutMs = 1;
+    config.samples = 2;
+
+    // Without frames no input goes out, so only stop() ends the run
+    std::atomic<int> finished{0};
+    LatencyProbe probe;
+    ASSERT_TRUE(probe.start(config, []() {}, [&finished]() { finished++; }));
+    probe.stop();
+    EXPECT_EQ(finished.load(), 1);
+
+    // With frames, two unanswered inputs end the run by itself
+    std::vector<uint8_t> luma(16 * 16, 16);
+    FrameData frame{};
+    frame.width = 16;
+    frame.height = 16;
+    frame.format = PixelFormat::YUV420P;
+    frame.planes[0] = luma.data();
+    frame.strides[0] = 16;
+    ASSERT_TRUE(probe.start(config, []() {}, [&finished]() { finished++; }));
+    const auto deadline = LatencyProbe::Clock::now() + std::chrono::seconds(10);
+    while (finished.load() < 2 && LatencyProbe::Clock::now() < deadline) {
+        probe.onFrame(frame);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(finished.load(), 2);
+    EXPECT_FALSE(probe.isRunning());
+    EXPECT_EQ(probe.getStats().missed, 2u);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "../../src/core/load_shedder.hpp"
+
+using namespace mirrolink;
+
+TEST(LoadShedderTest, EscalatesWithLag) {
+    LoadShedder shedder;
+    EXPECT_EQ(shedder.update(20), SkipLevel::None);
+    EXPECT_EQ(shedder.update(150), SkipLevel::NonReference);
+    EXPECT_EQ(shedder.update(600), SkipLevel::UntilKeyframe);
+
+    // Only a keyframe ends the drop, whatever the lag
+    EXPECT_EQ(shedder.update(0), SkipLevel::UntilKeyframe);
+    shedder.keyframeReached();
+    EXPECT_EQ(shedder.getLevel(), SkipLevel::NonReference);
+    EXPECT_EQ(shedder.getNonReferenceEpisodes(), 1u);
+    EXPECT_EQ(shedder.getKeyframeEpisodes(), 1u);
+}
+
+TEST(LoadShedderTest, StopsAtNonReferenceWithoutKeyframeRequests) {
+    LoadShedder shedder;
+    shedder.setSkipToKeyframe(false);
+    EXPECT_EQ(shedder.update(150), SkipLevel::NonReference);
+    EXPECT_EQ(shedder.update(5000), SkipLevel::NonReference);
+    EXPECT_EQ(shedder.getKeyframeEpisodes(), 0u);
+
+    shedder.setSkipToKeyframe(true);
+    EXPECT_EQ(shedder.update(600), SkipLevel::UntilKeyframe);
+}
+
+TEST(LoadShedderTest, RecoversWithHysteresis) {
+    LoadShedderConfig config;
+    config.recoverPackets = 5;
+    LoadShedder shedder(config);
+    ASSERT_EQ(shedder.update(120), SkipLevel::NonReference);
+
+    // Between the recover and trigger thresholds nothing changes
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(shedder.update(60), SkipLevel::NonReference);
+    }
+    // A spike restarts the count
+    for (int i = 0; i < 4; ++i) {
+        shedder.update(10);
+    }
+    shedder.update(50);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(shedder.update(10), SkipLevel::NonReference);
+    }
+    EXPECT_EQ(shedder.update(10), SkipLevel::None);
+}
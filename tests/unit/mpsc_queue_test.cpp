@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "../../src/utils/mpsc_queue.hpp"
+#include "../../src/utils/spsc_queue.hpp"
+#include <thread>
+#include <vector>
+
+using namespace mirrolink;
+
+TEST(MpscQueueTest, KeepsEachProducersOrder) {
+    utils::MpscQueue<int> queue(8);
+    const int producers = 4;
+    const int perProducer = 50000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p]() {
+            utils::Backoff backoff;
+            for (int i = 0; i < perProducer; ++i) {
+                while (!queue.tryPush(p * perProducer + i)) {
+                    backoff.wait();
+                }
+                backoff.reset();
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    utils::Backoff backoff;
+    for (int received = 0; received < producers * perProducer;) {
+        int value = -1;
+        if (!queue.tryPop(value)) {
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+        const int producer = value / perProducer;
+        ASSERT_EQ(value % perProducer, next[producer]);
+        next[producer]++;
+        received++;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "../../src/core/packet_reader.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace mirrolink;
+
+class PacketReaderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        packet = av_packet_alloc();
+    }
+
+    void TearDown() override {
+        av_packet_free(&packet);
+        if (fds[0] >= 0) close(fds[0]);
+        if (fds[1] >= 0) close(fds[1]);
+    }
+
+    static std::vector<uint8_t> encode(uint64_t ptsAndFlags, const std::vector<uint8_t>& payload) {
+        std::vector<uint8_t> bytes(PacketReader::kHeaderSize);
+        const uint32_t size = static_cast<uint32_t>(payload.size());
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<uint8_t>(ptsAndFlags >> (56 - 8 * i));
+        }
+        for (int i = 0; i < 4; ++i) {
+            bytes[8 + i] = static_cast<uint8_t>(size >> (24 - 8 * i));
+        }
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+        return bytes;
+    }
+
+    void send(const std::vector<uint8_t>& bytes) {
+        ASSERT_EQ(write(fds[1], bytes.data(), bytes.size()), static_cast<ssize_t>(bytes.size()));
+    }
+
+    int fds[2] = {-1, -1};
+    AVPacket* packet = nullptr;
+};
+
+TEST_F(PacketReaderTest, ReadsBufferedPackets) {
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 3; ++i) {
+        auto bytes = encode(1000 + i, std::vector<uint8_t>(100 + i, static_cast<uint8_t>(i)));
+        stream.insert(stream.end(), bytes.begin(), bytes.end());
+    }
+    send(stream);
+
+    PacketReader reader(fds[0]);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(reader.readPacket(packet));
+        EXPECT_EQ(packet->size, 100 + i);
+        EXPECT_EQ(packet->pts, 1000 + i);
+        EXPECT_EQ(packet->data[packet->size - 1], i);
+    }
+
+    // All three packets arrived in one read
+    EXPECT_EQ(reader.getStats().reads, 1u);
+    EXPECT_EQ(reader.getStats().packets, 3u);
+}
+
+TEST_F(PacketReaderTest, HandlesSplitHeaderAndPayload) {
+    std::vector<uint8_t> payload(5000);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i * 7);
+    }
+    const auto bytes = encode(42, payload);
+
+    std::thread writer([&]() {
+        // Dribble the packet out so the header itself is split
+        const size_t cuts[] = {5, 12, 700, bytes.size()};
+        size_t offset = 0;
+        for (size_t cut : cuts) {
+            if (write(fds[1], bytes.data() + offset, cut - offset) < 0) {
+                break;
+            }
+            offset = cut;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    PacketReader reader(fds[0]);
+    ASSERT_TRUE(reader.readPacket(packet));
+    writer.join();
+
+    ASSERT_EQ(packet->size, 5000);
+    EXPECT_EQ(std::memcmp(packet->data, payload.data(), payload.size()), 0);
+    EXPECT_EQ(packet->pts, 42);
+}
+
+TEST_F(PacketReaderTest, DecodesScrcpyFlags) {
+    send(encode((1ULL << 63) | 5, {1, 2, 3}));
+    send(encode((1ULL << 62) | 77, {4, 5, 6}));
+
+    PacketReader reader(fds[0]);
+    ASSERT_TRUE(reader.readPacket(packet));
+    EXPECT_EQ(packet->pts, AV_NOPTS_VALUE);
+
+    ASSERT_TRUE(reader.readPacket(packet));
+    EXPECT_EQ(packet->pts, 77);
+    EXPECT_TRUE(packet->flags & AV_PKT_FLAG_KEY);
+}
+
+TEST_F(PacketReaderTest, ReportsClosedStream) {
+    send(encode(1, {9, 9}));
+    close(fds[1]);
+    fds[1] = -1;
+
+    PacketReader reader(fds[0]);
+    ASSERT_TRUE(reader.readPacket(packet));
+    EXPECT_FALSE(reader.readPacket(packet));
+    EXPECT_TRUE(reader.isClosed());
+}
+
+TEST_F(PacketReaderTest, ReportsBacklog) {
+    PacketReader reader(fds[0]);
+    EXPECT_EQ(reader.getBacklog(), 0u);
+
+    auto first = encode(1, std::vector<uint8_t>(100, 1));
+    auto second = encode(2, std::vector<uint8_t>(200, 2));
+    send(first);
+    send(second);
+    EXPECT_EQ(reader.getBacklog(), first.size() + second.size());
+
+    ASSERT_TRUE(reader.readPacket(packet));
+    EXPECT_EQ(reader.getBacklog(), second.size());
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include "../../src/core/keyframe_index.hpp"
+#include "../../src/core/recorder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace mirrolink;
+
+TEST(RecorderTest, NamesSegmentsAfterRecordingPath) {
+    EXPECT_EQ(Recorder::segmentPath("/data/rec/session.mp4", 3), "/data/rec/session_00003.mp4");
+    EXPECT_EQ(Recorder::segmentPath("capture.mkv", 12), "capture_00012.mkv");
+}
+
+TEST(RecorderTest, IgnoresPacketsWhenStopped) {
+    Recorder recorder;
+    AVPacket* packet = av_packet_alloc();
+    EXPECT_FALSE(recorder.isRecording());
+    EXPECT_FALSE(recorder.push(packet));
+    EXPECT_EQ(recorder.getStats().dropped, 0u);
+    av_packet_free(&packet);
+}
+
+// Records a synthetic stream to real files. Matroska stores MJPEG packets
+// as they are, so the payload needs no encoder behind it.
+class RecorderFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        packet = av_packet_alloc();
+        const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        directory = std::filesystem::path(::testing::TempDir()) / (std::string("recorder_") + info->name());
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        path = (directory / "session.mkv").string();
+        stream.codecId = AV_CODEC_ID_MJPEG;
+        stream.width = 64;
+        stream.height = 64;
+    }
+
+    void TearDown() override {
+        av_packet_free(&packet);
+        std::filesystem::remove_all(directory);
+    }
+
+    // 30fps; the payload starts with the frame number
+    void pushFrame(Recorder& recorder, int frame, bool keyframe, int size = 256) {
+        payload.assign(size, 0);
+        std::memcpy(payload.data(), &frame, sizeof(frame));
+        packet->data = payload.data();
+        packet->size = size;
+        packet->pts = static_cast<int64_t>(frame) * 1000000 / 30;
+        packet->flags = keyframe ? AV_PKT_FLAG_KEY : 0;
+        EXPECT_TRUE(recorder.push(packet));
+        packet->data = nullptr;
+        packet->size = 0;
+    }
+
+    std::vector<KeyframeEntry> segmentIndex(uint64_t segment) {
+        KeyframeIndex index;
+        index.load(KeyframeIndex::pathFor(Recorder::segmentPath(path, segment)));
+        return index.getEntries();
+    }
+
+    std::filesystem::path directory;
+    std::string path;
+    MuxerStreamInfo stream;
+    AVPacket* packet = nullptr;
+    std::vector<uint8_t> payload;
+};
+
+TEST_F(RecorderFileTest, RotatesAtSegmentDuration) {
+    Recorder recorder;
+    RecordingOptions options;
+    options.segmentSeconds = 1;
+    ASSERT_TRUE(recorder.start(path, stream, options));
+    // Five seconds with a keyframe every half second
+    for (int i = 0; i < 150; ++i) {
+        pushFrame(recorder, i, i % 15 == 0);
+    }
+    recorder.stop();
+
+    auto stats = recorder.getStats();
+    EXPECT_EQ(stats.written, 150u);
+    EXPECT_EQ(stats.segments, 5u);
+    EXPECT_EQ(stats.writeErrors, 0u);
+    for (uint64_t i = 0; i < 5; ++i) {
+        EXPECT_GT(std::filesystem::file_size(Recorder::segmentPath(path, i)), 30u * 256) << "segment " << i;
+        const auto entries = segmentIndex(i);
+        ASSERT_EQ(entries.size(), 2u) << "segment " << i;
+        EXPECT_EQ(entries[0].ptsUs, 0);
+        EXPECT_EQ(entries[1].ptsUs, 500000);
+        EXPECT_EQ(entries[1].frameNumber, 15u);
+    }
+    EXPECT_FALSE(std::filesystem::exists(Recorder::segmentPath(path, 5)));
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST_F(RecorderFileTest, CutsOnlyAtKeyframes) {
+    Recorder recorder;
+    RecordingOptions options;
+    options.segmentSeconds = 1;
+    ASSERT_TRUE(recorder.start(path, stream, options));
+    // Keyframes at 0, 0.67, 2.5, 3 and 5 seconds
+    const std::vector<int> keyframes = {0, 20, 75, 90, 150};
+    for (int i = 0; i < 180; ++i) {
+        pushFrame(recorder, i, std::find(keyframes.begin(), keyframes.end(), i) != keyframes.end());
+    }
+    recorder.stop();
+
+    // A segment ends at the first keyframe a second or more after its
+    // start: frames 0-74, 75-149 and 150-179
+    EXPECT_EQ(recorder.getStats().written, 180u);
+    EXPECT_EQ(recorder.getStats().segments, 3u);
+    auto entries = segmentIndex(0);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[1].frameNumber, 20u);
+    entries = segmentIndex(1);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].frameNumber, 0u);
+    EXPECT_EQ(entries[1].ptsUs, 500000);
+    EXPECT_EQ(entries[1].frameNumber, 15u);
+    entries = segmentIndex(2);
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].ptsUs, 0);
+    EXPECT_FALSE(std::filesystem::exists(Recorder::segmentPath(path, 3)));
+}
+
+TEST_F(RecorderFileTest, DeletesOldestSegmentsOverBudget) {
+    const uint64_t budget = 300000;
+    {
+        Recorder recorder;
+        RecordingOptions options;
+        options.segmentSeconds = 1;
+        options.maxTotalBytes = budget;
+        ASSERT_TRUE(recorder.start(path, stream, options));
+        // Five one-second segments of about 120 KB each
+        for (int i = 0; i < 150; ++i) {
+            pushFrame(recorder, i, i % 30 == 0, 4000);
+        }
+        recorder.stop();
+        EXPECT_EQ(recorder.getStats().segments, 5u);
+        EXPECT_EQ(recorder.getStats().deletedSegments, 3u);
+        // Destroying the recorder waits for the deletions
+    }
+
+    uint64_t kept = 0;
+    for (uint64_t i = 0; i < 5; ++i) {
+        const std::string segment = Recorder::segmentPath(path, i);
+        const bool expired = i < 3;
+        EXPECT_EQ(std::filesystem::exists(segment), !expired) << "segment " << i;
+        EXPECT_EQ(std::filesystem::exists(KeyframeIndex::pathFor(segment)), !expired) << "segment " << i;
+        if (!expired) {
+            kept += std::filesystem::file_size(segment);
+        }
+    }
+    EXPECT_GT(kept, 0u);
+    EXPECT_LE(kept, budget);
+}
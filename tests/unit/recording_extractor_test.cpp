@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "../../src/core/recorder.hpp"
+#include "../../src/core/recording_extractor.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+using namespace mirrolink;
+
+// Records a synthetic stream with the Recorder and reads it back, once per
+// container (the parameter is the file extension). Matroska and MP4 store
+// MJPEG packets as they are, so the payload needs no encoder behind it.
+class RecordingExtractorTest : public ::testing::TestWithParam<std::string> {
+protected:
+    void SetUp() override {
+        const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        std::string name = std::string("extractor_") + info->name();
+        std::replace(name.begin(), name.end(), '/', '_');
+        directory = std::filesystem::path(::testing::TempDir()) / name;
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        path = (directory / ("session." + GetParam())).string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    // 30fps with a keyframe every second; the payload starts with the
+    // frame number
+    void record(int frames) {
+        MuxerStreamInfo stream;
+        stream.codecId = AV_CODEC_ID_MJPEG;
+        stream.width = 64;
+        stream.height = 64;
+        Recorder recorder;
+        ASSERT_TRUE(recorder.start(path, stream));
+
+        AVPacket* packet = av_packet_alloc();
+        std::vector<uint8_t> payload;
+        for (int i = 0; i < frames; ++i) {
+            payload.assign(256, 0);
+            std::memcpy(payload.data(), &i, sizeof(i));
+            packet->data = payload.data();
+            packet->size = static_cast<int>(payload.size());
+            packet->pts = static_cast<int64_t>(i) * 1000000 / 30;
+            packet->flags = i % 30 == 0 ? AV_PKT_FLAG_KEY : 0;
+            EXPECT_TRUE(recorder.push(packet));
+        }
+        packet->data = nullptr;
+        packet->size = 0;
+        av_packet_free(&packet);
+        recorder.stop();
+    }
+
+    std::filesystem::path directory;
+    std::string path;
+};
+
+TEST_P(RecordingExtractorTest, IndexPointsAtTheKeyframesCluster) {
+    record(150);
+
+    KeyframeIndex index;
+    ASSERT_TRUE(index.load(KeyframeIndex::pathFor(path)));
+    ASSERT_EQ(index.getEntries().size(), 5u);
+
+    // Each keyframe opens a Matroska cluster or an MP4 fragment exactly at
+    // its offset, not somewhere in the GOP before it
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    for (const KeyframeEntry& entry : index.getEntries()) {
+        uint8_t head[8] = {};
+        ASSERT_EQ(std::fseek(file, static_cast<long>(entry.byteOffset), SEEK_SET), 0);
+        ASSERT_EQ(std::fread(head, 1, sizeof(head), file), sizeof(head));
+        if (GetParam() == "mkv") {
+            const uint8_t clusterId[4] = {0x1F, 0x43, 0xB6, 0x75};
+            EXPECT_EQ(std::memcmp(head, clusterId, 4), 0) << "keyframe " << entry.frameNumber;
+        } else {
+            EXPECT_EQ(std::memcmp(head + 4, "moof", 4), 0) << "keyframe " << entry.frameNumber;
+        }
+    }
+    std::fclose(file);
+}
+
+TEST_P(RecordingExtractorTest, ClipStartsAtKeyframeBeforeSeek) {
+    record(150);
+
+    RecordingExtractor extractor;
+    ASSERT_TRUE(extractor.open(path));
+    ASSERT_TRUE(extractor.hasIndex());
+    EXPECT_EQ(extractor.getIndex().getEntries().size(), 5u);
+
+    const std::string clipPath = (directory / ("clip." + GetParam())).string();
+    ASSERT_TRUE(extractor.extractClip(2500000, 3500000, clipPath));
+
+    // The clip starts at the keyframe of frame 60, rebased to zero, and
+    // ends with the last frame at or before 3.5 seconds
+    AVFormatContext* clip = nullptr;
+    ASSERT_EQ(avformat_open_input(&clip, clipPath.c_str(), nullptr, nullptr), 0);
+    AVPacket* read = av_packet_alloc();
+    std::vector<int> frames;
+    while (av_read_frame(clip, read) >= 0) {
+        int frame = -1;
+        ASSERT_GE(read->size, static_cast<int>(sizeof(frame)));
+        std::memcpy(&frame, read->data, sizeof(frame));
+        if (frames.empty()) {
+            EXPECT_TRUE(read->flags & AV_PKT_FLAG_KEY);
+            EXPECT_EQ(read->pts, 0);
+        }
+        frames.push_back(frame);
+        av_packet_unref(read);
+    }
+    av_packet_free(&read);
+    avformat_close_input(&clip);
+
+    ASSERT_FALSE(frames.empty());
+    EXPECT_EQ(frames.front(), 60);
+    EXPECT_EQ(frames.back(), 105);
+    EXPECT_EQ(frames.size(), 46u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Containers, RecordingExtractorTest, ::testing::Values("mkv", "mp4"));
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../../src/core/replay_buffer.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace mirrolink;
+
+class ReplayBufferTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        packet = av_packet_alloc();
+    }
+
+    void TearDown() override {
+        av_packet_free(&packet);
+    }
+
+    // 30fps with a keyframe every second; the payload repeats the frame
+    // number so copies can be checked
+    void pushFrames(ReplayBuffer& buffer, int first, int count, int size = 1000) {
+        for (int i = first; i < first + count; ++i) {
+            payload.assign(size, static_cast<uint8_t>(i));
+            packet->data = payload.data();
+            packet->size = size;
+            packet->pts = static_cast<int64_t>(i) * 1000000 / 30;
+            packet->flags = (i % 30 == 0) ? AV_PKT_FLAG_KEY : 0;
+            buffer.push(packet);
+        }
+        packet->data = nullptr;
+        packet->size = 0;
+    }
+
+    AVPacket* packet = nullptr;
+    std::vector<uint8_t> payload;
+};
+
+TEST_F(ReplayBufferTest, StartsAtKeyframe) {
+    ReplayBuffer buffer;
+    buffer.configure(ReplayBufferConfig{1 << 20, 10});
+
+    ReplayClip clip;
+    pushFrames(buffer, 25, 5);
+    EXPECT_EQ(buffer.getStats().packets, 0u);
+    EXPECT_FALSE(buffer.snapshot(10, clip));
+
+    pushFrames(buffer, 30, 10);
+    ASSERT_TRUE(buffer.snapshot(10, clip));
+    ASSERT_EQ(clip.packets.size(), 10u);
+    EXPECT_TRUE(clip.packets.front().keyframe);
+    EXPECT_EQ(clip.data[clip.packets[3].offset], 33);
+}
+
+TEST_F(ReplayBufferTest, KeepsConfiguredDuration) {
+    ReplayBuffer buffer;
+    buffer.configure(ReplayBufferConfig{64 << 20, 2});
+    pushFrames(buffer, 0, 30 * 10);
+
+    auto stats = buffer.getStats();
+    EXPECT_GE(stats.durationUs, 2000000);
+    EXPECT_LT(stats.durationUs, 3000000);
+    EXPECT_EQ(stats.keyframes, 3u);
+
+    // Asking for one second starts at the keyframe covering it
+    ReplayClip clip;
+    ASSERT_TRUE(buffer.snapshot(1, clip));
+    EXPECT_TRUE(clip.packets.front().keyframe);
+    EXPECT_EQ(clip.packets.front().pts, 8 * 1000000);
+    EXPECT_GE(clip.durationUs(), 1000000);
+}
+
+TEST_F(ReplayBufferTest, StaysWithinMemoryBudget) {
+    ReplayBuffer buffer;
+    const size_t capacity = 100 * 1024;
+    buffer.configure(ReplayBufferConfig{capacity, 60});
+    pushFrames(buffer, 0, 30 * 20, 1500);
+
+    auto stats = buffer.getStats();
+    EXPECT_LE(stats.bytesUsed, capacity);
+    EXPECT_GT(stats.evicted, 0u);
+
+    ReplayClip clip;
+    ASSERT_TRUE(buffer.snapshot(60, clip));
+    EXPECT_TRUE(clip.packets.front().keyframe);
+    for (const auto& entry : clip.packets) {
+        const uint8_t frame = static_cast<uint8_t>((entry.pts * 30 + 500000) / 1000000);
+        EXPECT_EQ(clip.data[entry.offset], frame);
+        EXPECT_EQ(clip.data[entry.offset + entry.size - 1], frame);
+    }
+}
+
+TEST_F(ReplayBufferTest, DisabledBufferHoldsNothing) {
+    ReplayBuffer buffer;
+    pushFrames(buffer, 0, 60);
+    EXPECT_FALSE(buffer.isEnabled());
+    EXPECT_EQ(buffer.getStats().packets, 0u);
+}
+
+TEST_F(ReplayBufferTest, SnapshotStaysConsistentWhileCapturing) {
+    ReplayBuffer buffer;
+    // Small enough that the ring keeps wrapping, big enough that a clip
+    // takes several chunks to copy
+    buffer.configure(ReplayBufferConfig{8 << 20, 60});
+    pushFrames(buffer, 0, 30 * 4, 64 * 1024);
+
+    std::atomic<bool> done{false};
+    std::thread capture([&]() {
+        AVPacket* live = av_packet_alloc();
+        std::vector<uint8_t> data;
+        for (int i = 30 * 4; !done; ++i) {
+            data.assign(64 * 1024, static_cast<uint8_t>(i));
+            live->data = data.data();
+            live->size = static_cast<int>(data.size());
+            live->pts = static_cast<int64_t>(i) * 1000000 / 30;
+            live->flags = (i % 30 == 0) ? AV_PKT_FLAG_KEY : 0;
+            buffer.push(live);
+        }
+        live->data = nullptr;
+        live->size = 0;
+        av_packet_free(&live);
+    });
+
+    for (int round = 0; round < 20; ++round) {
+        ReplayClip clip;
+        if (!buffer.snapshot(60, clip)) {
+            continue;
+        }
+        ASSERT_FALSE(clip.packets.empty());
+        EXPECT_TRUE(clip.packets.front().keyframe);
+        for (size_t i = 0; i < clip.packets.size(); ++i) {
+            const auto& entry = clip.packets[i];
+            const uint8_t frame = static_cast<uint8_t>((entry.pts * 30 + 500000) / 1000000);
+            ASSERT_EQ(clip.data[entry.offset], frame);
+            ASSERT_EQ(clip.data[entry.offset + entry.size - 1], frame);
+            if (i > 0) {
+                ASSERT_EQ(static_cast<uint8_t>(frame - 1),
+                    clip.data[clip.packets[i - 1].offset]);
+            }
+        }
+    }
+    done = true;
+    capture.join();
+}
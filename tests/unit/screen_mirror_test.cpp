@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "../../src/core/screen_mirror.hpp"
+#include "../../src/utils/error.hpp"
+#include <vector>
+
+using namespace mirrolink;
+
+namespace {
+
+ScreenConfig validConfig() {
+    ScreenConfig config;
+    config.width = 1920;
+    config.height = 1080;
+    config.maxFps = 60;
+    return config;
+}
+
+} // namespace
+
+TEST(ScreenMirrorTest, RejectsInvalidConfigBeforeTouchingTheDevice) {
+    ScreenMirror mirror;
+    std::vector<ScreenConfig> configs(6, validConfig());
+    configs[0].height = 0;
+    configs[1].maxFps = 0;
+    configs[2].pipelineDepth = 0;
+    configs[3].decodeProfile = "fastest";
+    configs[4].adaptiveBitrate = true;
+    configs[4].minBitrate = configs[4].videoBitrate + 1;
+    configs[5].replaySeconds = -1;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        EXPECT_FALSE(mirror.start(configs[i])) << "config " << i;
+        EXPECT_FALSE(mirror.isActive());
+    }
+}
+
+TEST(ScreenMirrorTest, IdleSessionRefusesCaptures) {
+    ScreenMirror mirror;
+    EXPECT_FALSE(mirror.isActive());
+    EXPECT_FALSE(mirror.startRecording(::testing::TempDir() + "idle.mkv"));
+    EXPECT_FALSE(mirror.saveReplay(::testing::TempDir() + "idle_replay.mkv"));
+    EXPECT_FALSE(mirror.startLatencyProbe(LatencyProbeConfig()));
+    EXPECT_FALSE(mirror.getLatencyProbeStats().running);
+
+    auto screenshot = mirror.captureScreenshot();
+    EXPECT_THROW(screenshot.get(), utils::Error);
+    auto burst = mirror.captureBurst(3, 10);
+    EXPECT_THROW(burst.get(), utils::Error);
+
+    // Stopping a session that never started is harmless
+    mirror.stop();
+    EXPECT_FALSE(mirror.isActive());
+}
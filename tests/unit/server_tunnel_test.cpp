@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include "../../src/core/server_tunnel.hpp"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using namespace mirrolink;
+
+namespace {
+
+// Stands in for `adb forward` and the scrcpy server behind it, on an
+// ephemeral loopback port
+class FakeServer {
+public:
+    FakeServer() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+        listen(listener, 8);
+        socklen_t length = sizeof(address);
+        getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+    }
+
+    ~FakeServer() {
+        if (thread.joinable()) {
+            thread.join();
+        }
+        ::close(listener);
+    }
+
+    void run(std::function<void()> script) {
+        thread = std::thread(std::move(script));
+    }
+
+    // Next connection, or -1 if none arrives in time
+    int accept(int timeoutMs = 2000) {
+        struct pollfd pollFd{listener, POLLIN, 0};
+        if (poll(&pollFd, 1, timeoutMs) <= 0) {
+            return -1;
+        }
+        return ::accept(listener, nullptr, nullptr);
+    }
+
+    // What adb does while nothing listens on the device side
+    void acceptAndDrop(int count) {
+        for (int i = 0; i < count; ++i) {
+            const int sockfd = accept();
+            if (sockfd >= 0) {
+                ::close(sockfd);
+            }
+        }
+    }
+
+    int listener = -1;
+    uint16_t port = 0;
+    std::thread thread;
+};
+
+ServerTunnelConfig fastConfig(uint16_t port, int attempts) {
+    ServerTunnelConfig config;
+    config.port = port;
+    config.attempts = attempts;
+    config.retryDelayMs = 10;
+    return config;
+}
+
+bool readExactly(int sockfd, uint8_t* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        struct pollfd pollFd{sockfd, POLLIN, 0};
+        if (poll(&pollFd, 1, 2000) <= 0) {
+            return false;
+        }
+        const ssize_t n = read(sockfd, data + total, size - total);
+        if (n <= 0) {
+            return false;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(ServerTunnelTest, ConnectsControlBeforeTheStreamStarts) {
+    FakeServer server;
+    std::atomic<bool> controlAccepted{false};
+    server.run([&]() {
+        // Like scrcpy 2.4: video, dummy byte, control, and only then the
+        // codec header
+        const int video = server.accept();
+        if (video < 0) {
+            return;
+        }
+        const uint8_t dummy = 0;
+        write(video, &dummy, 1);
+        const int control = server.accept();
+        if (control >= 0) {
+            controlAccepted = true;
+            const uint8_t header[12] = {'h', '2', '6', '4'};
+            write(video, header, sizeof(header));
+            ::close(control);
+        }
+        ::close(video);
+    });
+
+    std::atomic<bool> keepTrying{true};
+    ServerTunnel tunnel(fastConfig(server.port, 3));
+    ASSERT_TRUE(tunnel.open(keepTrying));
+    EXPECT_EQ(tunnel.getAttempts(), 1);
+    const int video = tunnel.takeVideoSocket();
+    const int control = tunnel.takeControlSocket();
+    ASSERT_GE(video, 0);
+    ASSERT_GE(control, 0);
+
+    // The dummy byte is consumed; the stream starts at the codec header
+    uint8_t header[12] = {};
+    ASSERT_TRUE(readExactly(video, header, sizeof(header)));
+    EXPECT_EQ(header[0], 'h');
+    EXPECT_TRUE(controlAccepted);
+    ::close(video);
+    ::close(control);
+}
+
+TEST(ServerTunnelTest, RetriesUntilTheServerListens) {
+    FakeServer server;
+    server.run([&]() {
+        server.acceptAndDrop(3);
+        const int video = server.accept();
+        if (video < 0) {
+            return;
+        }
+        const uint8_t dummy = 0;
+        write(video, &dummy, 1);
+        const int control = server.accept();
+        if (control >= 0) {
+            ::close(control);
+        }
+        ::close(video);
+    });
+
+    std::atomic<bool> keepTrying{true};
+    ServerTunnel tunnel(fastConfig(server.port, 10));
+    ASSERT_TRUE(tunnel.open(keepTrying));
+    EXPECT_EQ(tunnel.getAttempts(), 4);
+}
+
+TEST(ServerTunnelTest, GivesUpWhenTheServerNeverAnswers) {
+    FakeServer server;
+    server.run([&]() {
+        server.acceptAndDrop(3);
+    });
+
+    std::atomic<bool> keepTrying{true};
+    ServerTunnel tunnel(fastConfig(server.port, 3));
+    EXPECT_FALSE(tunnel.open(keepTrying));
+    EXPECT_EQ(tunnel.getAttempts(), 3);
+    EXPECT_LT(tunnel.takeVideoSocket(), 0);
+    EXPECT_LT(tunnel.takeControlSocket(), 0);
+}
+
+TEST(ServerTunnelTest, StopsRetryingWhenCancelled) {
+    FakeServer server;
+    std::atomic<bool> keepTrying{false};
+    ServerTunnel tunnel(fastConfig(server.port, 100));
+    EXPECT_FALSE(tunnel.open(keepTrying));
+    EXPECT_EQ(tunnel.getAttempts(), 0);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../../src/utils/spsc_queue.hpp"
+#include <chrono>
+#include <thread>
+
+using namespace mirrolink;
+
+TEST(SpscQueueTest, RespectsConfiguredDepth) {
+    utils::SpscQueue<int> queue(3);
+    EXPECT_EQ(queue.capacity(), 3u);
+    EXPECT_TRUE(queue.tryPush(1));
+    EXPECT_TRUE(queue.tryPush(2));
+    EXPECT_TRUE(queue.tryPush(3));
+    EXPECT_FALSE(queue.tryPush(4));
+    EXPECT_EQ(queue.size(), 3u);
+
+    int value = 0;
+    EXPECT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(queue.tryPush(4));
+}
+
+TEST(SpscQueueTest, PopFromEmptyFails) {
+    utils::SpscQueue<int> queue(2);
+    int value = 0;
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, PreservesOrderAcrossThreads) {
+    utils::SpscQueue<int> queue(4);
+    const int count = 100000;
+
+    std::thread producer([&]() {
+        utils::Backoff backoff;
+        for (int i = 0; i < count; ++i) {
+            while (!queue.tryPush(i)) {
+                backoff.wait();
+            }
+            backoff.reset();
+        }
+    });
+
+    int expected = 0;
+    utils::Backoff backoff;
+    while (expected < count) {
+        int value = -1;
+        if (!queue.tryPop(value)) {
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+        ASSERT_EQ(value, expected);
+        expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, ParkedConsumerWakesOnNotify) {
+    utils::SpscQueue<int> queue(4);
+    utils::WakeSignal signal;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.tryPush(1);
+        signal.notify();
+    });
+
+    int value = 0;
+    while (!queue.tryPop(value)) {
+        signal.wait([&]() { return !queue.empty(); }, std::chrono::seconds(10));
+    }
+    producer.join();
+    EXPECT_EQ(value, 1);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(SpscQueueTest, DoesNotParkWhenWorkIsReady) {
+    utils::WakeSignal signal;
+    const auto start = std::chrono::steady_clock::now();
+    // Nobody will notify; ready() must keep the caller awake
+    signal.wait([]() { return true; }, std::chrono::seconds(10));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(SpscQueueTest, ParkingBackoffLosesNoWakeups) {
+    utils::SpscQueue<int> queue(2);
+    utils::WakeSignal signal;
+    const int count = 2000;
+
+    // A producer slower than the consumer parks it between most items
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.tryPush(i)) {
+                std::this_thread::yield();
+            }
+            signal.notify();
+            if (i % 16 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    utils::Backoff backoff(signal);
+    int expected = 0;
+    while (expected < count) {
+        int value = -1;
+        if (!queue.tryPop(value)) {
+            backoff.wait([&]() { return !queue.empty(); });
+            continue;
+        }
+        backoff.reset();
+        ASSERT_EQ(value, expected);
+        expected++;
+    }
+    producer.join();
+    // Every lost wakeup would cost the 100 ms park timeout
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "../../src/gui/stream_size_policy.hpp"
+
+using namespace mirrolink::gui;
+
+TEST(StreamSizePolicyTest, RoundsWindowUpToSizeSteps) {
+    struct Case {
+        int window;
+        int maxSize;
+        int expected;
+    };
+    const Case cases[] = {
+        {700, 0, 720},
+        {720, 0, 720},
+        {721, 0, 1080},
+        {2000, 0, 2560},
+        {3840, 0, 3840},
+        {5000, 0, 0},  // Bigger than every step: native
+        {2000, 1600, 1600},
+        {5000, 1600, 1600},
+    };
+    for (const auto& c : cases) {
+        StreamSizePolicy policy(c.maxSize);
+        policy.windowResized(c.window, c.window / 2, 0);
+        EXPECT_EQ(policy.initialSize(), c.expected) << "window " << c.window << ", max " << c.maxSize;
+    }
+}
+
+TEST(StreamSizePolicyTest, WaitsForTheWindowToSettle) {
+    StreamSizePolicy policy;
+    policy.windowResized(1280, 720, 0);
+    ASSERT_EQ(policy.initialSize(), 1440);
+
+    int size = 0;
+    policy.windowResized(600, 400, 100);
+    // Nothing to compare against until frames arrive
+    EXPECT_FALSE(policy.poll(1000, size));
+    policy.streamResized(1440, 810);
+
+    // Every resize restarts the 750 ms wait
+    policy.windowResized(600, 400, 1000);
+    policy.windowResized(500, 300, 1500);
+    EXPECT_FALSE(policy.poll(2000, size));
+    EXPECT_FALSE(policy.poll(2249, size));
+    ASSERT_TRUE(policy.poll(2250, size));
+    EXPECT_EQ(size, 720);
+
+    // Asked once per settled resize
+    EXPECT_FALSE(policy.poll(5000, size));
+}
+
+TEST(StreamSizePolicyTest, ShrinksOnlyWhenStreamIsTwiceTheWindow) {
+    StreamSizePolicy policy;
+    policy.windowResized(1920, 1080, 0);
+    ASSERT_EQ(policy.initialSize(), 1920);
+    policy.streamResized(1920, 1080);
+
+    int size = 0;
+    policy.windowResized(960, 540, 0);
+    EXPECT_FALSE(policy.poll(1000, size));
+
+    policy.windowResized(950, 534, 1000);
+    ASSERT_TRUE(policy.poll(1750, size));
+    EXPECT_EQ(size, 1080);
+}
+
+TEST(StreamSizePolicyTest, GrowsOnlyWhenWindowOutgrowsStreamByTenPercent) {
+    StreamSizePolicy policy;
+    policy.windowResized(1000, 600, 0);
+    ASSERT_EQ(policy.initialSize(), 1080);
+    policy.streamResized(1080, 608);
+
+    int size = 0;
+    policy.windowResized(1180, 700, 0);
+    EXPECT_FALSE(policy.poll(1000, size));
+
+    policy.windowResized(1200, 700, 1000);
+    ASSERT_TRUE(policy.poll(1750, size));
+    EXPECT_EQ(size, 1440);
+}
+
+TEST(StreamSizePolicyTest, NeverGrowsPastNative) {
+    StreamSizePolicy policy;
+    policy.windowResized(5000, 3000, 0);
+    ASSERT_EQ(policy.initialSize(), 0);
+    // The device's own resolution is smaller than the window
+    policy.streamResized(2400, 1080);
+
+    int size = 0;
+    policy.windowResized(4000, 2400, 0);
+    EXPECT_FALSE(policy.poll(1000, size));
+
+    // Shrinking from native still works
+    policy.windowResized(1000, 600, 1000);
+    ASSERT_TRUE(policy.poll(2000, size));
+    EXPECT_EQ(size, 1080);
+}